@@ -0,0 +1,433 @@
+#include "analysis.h"
+#include "decode.h"
+#include "machine_ops.h"
+
+#define ANALYSIS_MEMORY         0x1000
+
+/* entries followed at the base of a BNNN jump table */
+#define ANALYSIS_TABLE_ENTRIES  128
+
+/* lattice of the value of I at the entry of a block */
+#define I_UNSEEN    -2
+#define I_UNKNOWN   -1
+
+static const char *exit_names[] = {
+    [CHIP8_EXIT_FALL]     = "fall",
+    [CHIP8_EXIT_JUMP]     = "jump",
+    [CHIP8_EXIT_SKIP]     = "skip",
+    [CHIP8_EXIT_CALL]     = "call",
+    [CHIP8_EXIT_RETURN]   = "return",
+    [CHIP8_EXIT_COMPUTED] = "computed",
+    [CHIP8_EXIT_HALT]     = "halt",
+    [CHIP8_EXIT_LOOP]     = "loop",
+};
+
+static uint16_t analysis_opcode(const uint8_t *memory, uint16_t pc) {
+    return memory[pc] << 8 | memory[pc + 1];
+}
+
+static int analysis_skips(enum chip8_op op) {
+    return op == CHIP8_OP_SE_BYTE || op == CHIP8_OP_SNE_BYTE || op == CHIP8_OP_SE_REG ||
+           op == CHIP8_OP_SNE_REG || op == CHIP8_OP_SKP || op == CHIP8_OP_SKNP;
+}
+
+static int analysis_halts(enum chip8_op op) {
+    return op == CHIP8_OP_UNKNOWN || op == CHIP8_OP_SYS;
+}
+
+/**
+ * Addresses still to be followed; each is queued at most once
+ */
+struct analysis_work {
+    uint16_t addr[ANALYSIS_MEMORY];
+    uint8_t queued[ANALYSIS_MEMORY];
+    size_t count;
+};
+
+static void analysis_follow(struct analysis_work *w, const struct chip8_analysis *a, uint16_t addr) {
+    if (addr + 1 < ANALYSIS_MEMORY && !w->queued[addr] && !(a->bytes[addr] & CHIP8_BYTE_CODE)) {
+        w->queued[addr] = 1;
+        w->addr[w->count++] = addr;
+    }
+}
+
+/**
+ * Marks the instruction at an address as the start of a block and follows it
+ */
+static void analysis_branch(struct analysis_work *w, struct chip8_analysis *a, uint16_t addr) {
+    if (addr + 1 < ANALYSIS_MEMORY) {
+        a->bytes[addr] |= CHIP8_BYTE_LEADER;
+        analysis_follow(w, a, addr);
+    }
+}
+
+/**
+ * Finds every reachable instruction and the first instruction of every block
+ */
+static void analysis_discover(struct chip8_analysis *a, const uint8_t *memory, uint16_t entry) {
+    const uint8_t *decode = chip8_decode_table();
+    struct analysis_work w;
+
+    memset(&w, 0, sizeof(w));
+    analysis_branch(&w, a, entry);
+
+    while (w.count > 0) {
+        uint16_t pc = w.addr[--w.count];
+
+        w.queued[pc] = 0;
+
+        uint16_t opcode = analysis_opcode(memory, pc);
+        enum chip8_op op = decode[opcode];
+
+        a->bytes[pc] |= CHIP8_BYTE_CODE;
+        a->bytes[pc + 1] |= CHIP8_BYTE_OPERAND;
+        a->instructions++;
+
+        switch (op) {
+            case CHIP8_OP_RET:
+                break;
+            case CHIP8_OP_JP:
+                analysis_branch(&w, a, opcode & 0xFFF);
+                break;
+            case CHIP8_OP_CALL:
+                analysis_branch(&w, a, opcode & 0xFFF);
+                analysis_branch(&w, a, pc + 2);
+                break;
+            case CHIP8_OP_JP_V0:
+                a->bytes[pc] |= CHIP8_BYTE_COMPUTED;
+                a->computed++;
+
+                // a table of jumps is followed; any other target is beyond static analysis
+                for (uint16_t t = opcode & 0xFFF, k = 0; k < ANALYSIS_TABLE_ENTRIES && t + 1 < ANALYSIS_MEMORY &&
+                     decode[analysis_opcode(memory, t)] == CHIP8_OP_JP; t += 2, k++) {
+                    analysis_branch(&w, a, t);
+                }
+                break;
+            default:
+                if (analysis_halts(op)) {
+                    break;
+                }
+
+                if (analysis_skips(op)) {
+                    analysis_branch(&w, a, pc + 2);
+                    analysis_branch(&w, a, pc + 4);
+                } else {
+                    analysis_follow(&w, a, pc + 2);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Cuts the reachable instructions into basic blocks
+ * @return {int} The outcome of the execution
+ */
+static int analysis_blocks(struct chip8_analysis *a, const uint8_t *memory) {
+    const uint8_t *decode = chip8_decode_table();
+    size_t capacity = 0;
+
+    for (int addr = 0; addr < ANALYSIS_MEMORY; addr++) {
+        capacity += (a->bytes[addr] & CHIP8_BYTE_LEADER) != 0;
+    }
+
+    if ((a->blocks = calloc(capacity ? capacity : 1, sizeof(struct chip8_basic_block))) == NULL) {
+        return -1;
+    }
+
+    for (int addr = 0; addr < ANALYSIS_MEMORY; addr++) {
+        if (!(a->bytes[addr] & CHIP8_BYTE_LEADER)) {
+            continue;
+        }
+
+        struct chip8_basic_block *b = &a->blocks[a->block_count++];
+        uint16_t pc = addr;
+
+        b->start = addr;
+
+        for (;;) {
+            uint16_t opcode = analysis_opcode(memory, pc);
+            enum chip8_op op = decode[opcode];
+            uint16_t next = pc + 2;
+
+            b->end = next;
+
+            if (op == CHIP8_OP_JP) {
+                b->exit = (opcode & 0xFFF) == pc ? CHIP8_EXIT_LOOP : CHIP8_EXIT_JUMP;
+                b->next[b->next_count++] = opcode & 0xFFF;
+            } else if (op == CHIP8_OP_CALL) {
+                b->exit = CHIP8_EXIT_CALL;
+                b->next[b->next_count++] = opcode & 0xFFF;
+                b->next[b->next_count++] = next;
+            } else if (op == CHIP8_OP_RET) {
+                b->exit = CHIP8_EXIT_RETURN;
+            } else if (op == CHIP8_OP_JP_V0) {
+                b->exit = CHIP8_EXIT_COMPUTED;
+            } else if (analysis_halts(op) || next + 1 >= ANALYSIS_MEMORY) {
+                b->exit = CHIP8_EXIT_HALT;
+            } else if (analysis_skips(op)) {
+                b->exit = CHIP8_EXIT_SKIP;
+                b->next[b->next_count++] = next;
+                b->next[b->next_count++] = next + 2;
+            } else if (a->bytes[next] & CHIP8_BYTE_LEADER) {
+                b->exit = CHIP8_EXIT_FALL;
+                b->next[b->next_count++] = next;
+            } else {
+                pc = next;
+                continue;
+            }
+
+            break;
+        }
+    }
+
+    return 0;
+}
+
+static int32_t analysis_merge(int32_t a, int32_t b) {
+    return a == I_UNSEEN ? b : b == I_UNSEEN || a == b ? a : I_UNKNOWN;
+}
+
+static void analysis_mark(struct chip8_analysis *a, int32_t from, int len, uint8_t flag) {
+    for (int k = 0; k < len && from + k < ANALYSIS_MEMORY; k++) {
+        a->bytes[from + k] |= flag;
+    }
+}
+
+/**
+ * Runs the instructions of a block over the value of I it is entered with
+ * @param {unsigned} quirks The CHIP8_QUIRK_ flags the program runs under
+ * @param {int} mark Non-zero to record the reads and writes of the block
+ * @return {int32_t} The value of I the block leaves with
+ */
+static int32_t analysis_transfer(struct chip8_analysis *a, const uint8_t *memory,
+                                 const struct chip8_basic_block *b, int32_t i, unsigned quirks, int mark) {
+    const uint8_t *decode = chip8_decode_table();
+
+    for (uint16_t pc = b->start; pc < b->end; pc += 2) {
+        uint16_t opcode = analysis_opcode(memory, pc);
+        int x = (opcode >> 8) & 0xF;
+
+        switch (decode[opcode]) {
+            case CHIP8_OP_LD_I:
+                i = opcode & 0xFFF;
+                break;
+            case CHIP8_OP_ADD_I:
+            case CHIP8_OP_LD_F:
+                i = I_UNKNOWN;
+                break;
+            case CHIP8_OP_DRW:
+            case CHIP8_OP_LD_VX_MEM:
+                if (mark && i >= 0) {
+                    analysis_mark(a, i, decode[opcode] == CHIP8_OP_DRW ? (opcode & 0xF) : x + 1, CHIP8_BYTE_DATA);
+                }
+                if (i >= 0 && decode[opcode] == CHIP8_OP_LD_VX_MEM) {
+                    i = (i + chip8_quirk_load_i(opcode, quirks)) & 0xFFFF;
+                }
+                break;
+            case CHIP8_OP_LD_B:
+            case CHIP8_OP_LD_MEM_VX:
+                if (mark && i >= 0) {
+                    analysis_mark(a, i, decode[opcode] == CHIP8_OP_LD_B ? 3 : x + 1, CHIP8_BYTE_WRITTEN);
+                } else if (mark) {
+                    a->bytes[pc] |= CHIP8_BYTE_WILD_WRITE;
+                    a->wild_writes++;
+                }
+                if (i >= 0 && decode[opcode] == CHIP8_OP_LD_MEM_VX) {
+                    i = (i + chip8_quirk_load_i(opcode, quirks)) & 0xFFFF;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    return i;
+}
+
+/**
+ * Propagates the value of I through the graph until it settles, then records
+ * the reads and writes it places
+ * @return {int} The outcome of the execution
+ */
+static int analysis_data(struct chip8_analysis *a, const uint8_t *memory, uint16_t entry, uint16_t i, unsigned quirks) {
+    size_t n = a->block_count;
+    int32_t *in = malloc(n * sizeof(int32_t));
+    size_t *work = malloc(n * sizeof(size_t));
+    uint8_t *queued = calloc(n, 1);
+    size_t count = 0;
+    int rc = -1;
+
+    if (in == NULL || work == NULL || queued == NULL) {
+        goto done;
+    }
+
+    // blocks entered from code that cannot be followed start with I unknown
+    for (size_t k = 0; k < n; k++) {
+        in[k] = I_UNSEEN;
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        const struct chip8_basic_block *b = &a->blocks[k];
+
+        if (b->start == entry) {
+            in[k] = analysis_merge(in[k], i);
+        }
+
+        if (b->exit == CHIP8_EXIT_CALL && b->next[1] + 1 < ANALYSIS_MEMORY) {
+            in[chip8_analysis_block(a, b->next[1]) - a->blocks] = I_UNKNOWN;
+        }
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        const struct chip8_basic_block *b = &a->blocks[k];
+
+        if (b->exit == CHIP8_EXIT_COMPUTED) {
+            uint16_t t = analysis_opcode(memory, b->end - 2) & 0xFFF;
+
+            for (const struct chip8_basic_block *e; (e = chip8_analysis_block(a, t)) != NULL && e->start == t; t += 2) {
+                in[e - a->blocks] = I_UNKNOWN;
+            }
+        }
+
+        if (in[k] != I_UNSEEN) {
+            work[count++] = k;
+            queued[k] = 1;
+        }
+    }
+
+    while (count > 0) {
+        size_t k = work[--count];
+        const struct chip8_basic_block *b = &a->blocks[k];
+        int32_t out = analysis_transfer(a, memory, b, in[k], quirks, 0);
+
+        queued[k] = 0;
+
+        // a call's return address was already given up on; the callee may change I
+        int edges = b->exit == CHIP8_EXIT_CALL ? 1 : b->next_count;
+
+        for (int e = 0; e < edges; e++) {
+            const struct chip8_basic_block *s = chip8_analysis_block(a, b->next[e]);
+
+            if (s == NULL) {
+                continue;
+            }
+
+            size_t t = s - a->blocks;
+            int32_t merged = analysis_merge(in[t], out);
+
+            if (merged != in[t]) {
+                in[t] = merged;
+
+                if (!queued[t]) {
+                    work[count++] = t;
+                    queued[t] = 1;
+                }
+            }
+        }
+    }
+
+    for (size_t k = 0; k < n; k++) {
+        analysis_transfer(a, memory, &a->blocks[k], in[k] == I_UNSEEN ? I_UNKNOWN : in[k], quirks, 1);
+    }
+
+    for (int addr = 0; addr < ANALYSIS_MEMORY; addr++) {
+        uint8_t f = a->bytes[addr];
+        a->self_modifying += (f & CHIP8_BYTE_WRITTEN) && (f & (CHIP8_BYTE_CODE | CHIP8_BYTE_OPERAND));
+    }
+
+    rc = 0;
+
+done:
+    free(in);
+    free(work);
+    free(queued);
+    return rc;
+}
+
+struct chip8_analysis* chip8_analyze(const struct chip8_machine *m) {
+    struct chip8_analysis *a = calloc(1, sizeof(struct chip8_analysis));
+
+    if (a == NULL) {
+        return NULL;
+    }
+
+    analysis_discover(a, m->memory, m->pc);
+
+    if (analysis_blocks(a, m->memory) < 0 || analysis_data(a, m->memory, m->pc, m->i, chip8_quirk_flags(m->quirks)) < 0) {
+        chip8_analysis_destroy(&a);
+        return NULL;
+    }
+
+    return a;
+}
+
+int chip8_analysis_destroy(struct chip8_analysis **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    free((*p)->blocks);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+const struct chip8_basic_block* chip8_analysis_block(const struct chip8_analysis *a, uint16_t addr) {
+    size_t lo = 0, hi = a->block_count;
+
+    if (addr >= ANALYSIS_MEMORY || !(a->bytes[addr] & CHIP8_BYTE_CODE)) {
+        return NULL;
+    }
+
+    // the last block starting at or before the address
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+
+        if (a->blocks[mid].start <= addr) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    const struct chip8_basic_block *b = &a->blocks[lo];
+
+    if (b->start <= addr && addr < b->end && ((addr - b->start) & 1) == 0) {
+        return b;
+    }
+
+    // blocks entered at odd addresses overlap their neighbours
+    for (size_t k = 0; k < a->block_count; k++) {
+        b = &a->blocks[k];
+
+        if (b->start <= addr && addr < b->end && ((addr - b->start) & 1) == 0) {
+            return b;
+        }
+    }
+
+    return NULL;
+}
+
+const char* chip8_exit_name(enum chip8_exit exit) {
+    return exit <= CHIP8_EXIT_LOOP ? exit_names[exit] : "unknown";
+}
+
+static void* analysis_build(const struct chip8_rom *rom) {
+    struct chip8_machine *m = chip8_machine_create();
+    struct chip8_analysis *a = NULL;
+
+    if (m != NULL && chip8_rom_load(m, rom)) {
+        a = chip8_analyze(m);
+    }
+
+    chip8_machine_destroy(&m);
+    return a;
+}
+
+static void analysis_release(void *artifact) {
+    struct chip8_analysis *a = artifact;
+    chip8_analysis_destroy(&a);
+}
+
+const struct chip8_artifact_type chip8_artifact_analysis = { "analysis", analysis_build, analysis_release };
@@ -0,0 +1,96 @@
+#ifndef __chip8_analysis_h_
+
+#define __chip8_analysis_h_
+
+#include "machine.h"
+#include "romstore.h"
+
+/* what static analysis knows about each byte of memory */
+#define CHIP8_BYTE_CODE         0x01     /* first byte of a reachable instruction */
+#define CHIP8_BYTE_OPERAND      0x02     /* second byte of a reachable instruction */
+#define CHIP8_BYTE_LEADER       0x04     /* first instruction of a basic block */
+#define CHIP8_BYTE_DATA         0x08     /* read through I by DRW or FX65 */
+#define CHIP8_BYTE_WRITTEN      0x10     /* written through I by FX33 or FX55 */
+#define CHIP8_BYTE_COMPUTED     0x20     /* a BNNN jump */
+#define CHIP8_BYTE_WILD_WRITE   0x40     /* an FX33 or FX55 through an I that is not known */
+
+/**
+ * How control leaves a basic block
+ */
+enum chip8_exit {
+    CHIP8_EXIT_FALL = 0,             /* runs into the next block */
+    CHIP8_EXIT_JUMP,                 /* 1NNN */
+    CHIP8_EXIT_SKIP,                 /* a conditional skip; falls through or skips one instruction */
+    CHIP8_EXIT_CALL,                 /* 2NNN; comes back to the next instruction */
+    CHIP8_EXIT_RETURN,               /* 00EE */
+    CHIP8_EXIT_COMPUTED,             /* BNNN */
+    CHIP8_EXIT_HALT,                 /* an instruction chip8_execute() fails on, or the end of memory */
+    CHIP8_EXIT_LOOP                  /* a jump onto itself */
+};
+
+/**
+ * A straight-line run of reachable instructions entered only at its start
+ */
+struct chip8_basic_block {
+    uint16_t start;                  /* address of the first instruction */
+    uint16_t end;                    /* address past the last instruction */
+    enum chip8_exit exit;            /* how the last instruction leaves the block */
+    uint16_t next[2];                /* successors; a call leads to its target, then its return address */
+    uint8_t next_count;              /* number of successors */
+};
+
+/**
+ * Control-flow graph and code/data map of a program image
+ *
+ * Analysis starts at a machine's program counter and follows the semantics of
+ * chip8_execute(): jumps, calls and returns, both ways out of every skip, and
+ * through the jump table at the base of a BNNN while its entries are jumps.
+ * The value of I is tracked through the graph where it is a constant, which
+ * places sprite and table reads (data) and FX33/FX55 writes. Code that may be
+ * written is self-modifying; compiled copies of it must be invalidated, as the
+ * JIT does after every such write.
+ */
+struct chip8_analysis {
+    uint8_t bytes[0x1000];           /* CHIP8_BYTE_* flags of every address */
+    struct chip8_basic_block *blocks; /* basic blocks in address order */
+    size_t block_count;
+    size_t instructions;             /* reachable instructions */
+    size_t computed;                 /* BNNN jumps */
+    size_t wild_writes;              /* writes through an I that is not known */
+    size_t self_modifying;           /* code bytes that may be written */
+};
+
+/* the analysis of an image loaded into a freshly initialised machine, under the modern profile */
+extern const struct chip8_artifact_type chip8_artifact_analysis;
+
+/**
+ * Analyses the program in a machine's memory, from its program counter on,
+ * following I through FX55/FX65 as the machine's quirk profile moves it
+ * @param {const struct chip8_machine*} m The machine holding the program
+ * @return {struct chip8_analysis*} The analysis, NULL when out of memory
+ */
+struct chip8_analysis* chip8_analyze(const struct chip8_machine *m);
+
+/**
+ * Destroys the given analysis
+ * @param {struct chip8_analysis**} p The analysis to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_analysis_destroy(struct chip8_analysis **p);
+
+/**
+ * Finds the basic block holding the instruction at an address
+ * @param {const struct chip8_analysis*} a The analysis
+ * @param {uint16_t} addr The address of the instruction
+ * @return {const struct chip8_basic_block*} The block, NULL when the address is not reachable code
+ */
+const struct chip8_basic_block* chip8_analysis_block(const struct chip8_analysis *a, uint16_t addr);
+
+/**
+ * Gets the name of a way out of a basic block
+ * @param {enum chip8_exit} exit The way out
+ * @return {const char *} The name
+ */
+const char* chip8_exit_name(enum chip8_exit exit);
+
+#endif /* __chip8_analysis_h_ */
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include "machine.h"
+#include "decode.h"
+#include "romstore.h"
+#include "analysis.h"
+#include "jit.h"
+
+/* data bytes listed per line */
+#define LIST_BYTES  8
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-g] [-j] rom\n", name);
+    fprintf(stderr, "  -g          write the control-flow graph in graphviz dot instead of the listing\n");
+    fprintf(stderr, "  -j          also report what compiling the reachable code ahead of time takes\n");
+    fprintf(stderr, "The listing has the basic blocks, then the program with every byte classed as\n");
+    fprintf(stderr, "code, data (read through I) or unreached.\n");
+}
+
+static void print_blocks(const struct chip8_analysis *a) {
+    printf("; basic blocks\n");
+
+    for (size_t k = 0; k < a->block_count; k++) {
+        const struct chip8_basic_block *b = &a->blocks[k];
+
+        printf("; 0x%03X-0x%03X %-8s", b->start, b->end - 2, chip8_exit_name(b->exit));
+        for (int n = 0; n < b->next_count; n++) {
+            printf(" 0x%03X", b->next[n]);
+        }
+        printf("\n");
+    }
+}
+
+static void print_instruction(const struct chip8_analysis *a, const uint8_t *memory, uint16_t pc) {
+    uint16_t opcode = memory[pc] << 8 | memory[pc + 1];
+    char text[32];
+
+    if (a->bytes[pc] & CHIP8_BYTE_LEADER) {
+        printf("L%03X:\n", pc);
+    }
+
+    const char *note = a->bytes[pc] & CHIP8_BYTE_COMPUTED ? "computed jump"
+                     : a->bytes[pc] & CHIP8_BYTE_WILD_WRITE ? "writes through an unknown I"
+                     : (a->bytes[pc] | a->bytes[pc + 1]) & CHIP8_BYTE_WRITTEN ? "self-modifying"
+                     : NULL;
+
+    chip8_disassemble(opcode, text, sizeof(text));
+
+    if (note) {
+        printf("    0x%03X  %04X  %-18s ; %s\n", pc, opcode, text, note);
+    } else {
+        printf("    0x%03X  %04X  %s\n", pc, opcode, text);
+    }
+}
+
+static void print_listing(const struct chip8_analysis *a, const uint8_t *memory, size_t size) {
+    uint16_t end = CHIP8_PROGRAM_START + size;
+
+    printf("; listing\n");
+
+    for (uint16_t pc = CHIP8_PROGRAM_START; pc < end;) {
+        if (a->bytes[pc] & CHIP8_BYTE_CODE) {
+            print_instruction(a, memory, pc);
+            pc += 2;
+            continue;
+        }
+
+        // a run of bytes that are not code, split where their class changes
+        uint8_t data = a->bytes[pc] & CHIP8_BYTE_DATA;
+        uint16_t n = 0;
+
+        printf("    0x%03X  DB", pc);
+        while (n < LIST_BYTES && pc + n < end && !(a->bytes[pc + n] & CHIP8_BYTE_CODE) &&
+               (a->bytes[pc + n] & CHIP8_BYTE_DATA) == data) {
+            printf("%s0x%02X", n ? ", " : " ", memory[pc + n]);
+            n++;
+        }
+        printf("%*s ; %s\n", (LIST_BYTES - n) * 6, "", data ? "data" : "unreached");
+
+        pc += n;
+    }
+}
+
+static void print_graph(const struct chip8_analysis *a, const char *name) {
+    printf("digraph \"%s\" {\n", name);
+    printf("    node [shape=box fontname=monospace];\n");
+
+    for (size_t k = 0; k < a->block_count; k++) {
+        const struct chip8_basic_block *b = &a->blocks[k];
+
+        printf("    b%03X [label=\"0x%03X-0x%03X\\n%s\"];\n", b->start, b->start, b->end - 2, chip8_exit_name(b->exit));
+
+        for (int n = 0; n < b->next_count; n++) {
+            if (chip8_analysis_block(a, b->next[n]) != NULL) {
+                printf("    b%03X -> b%03X%s;\n", b->start, b->next[n],
+                       b->exit == CHIP8_EXIT_CALL && n == 1 ? " [style=dashed]" : "");
+            }
+        }
+    }
+
+    printf("}\n");
+}
+
+int main(int argc, char *argv[]) {
+    int graph = 0, jit = 0;
+    int a = 1;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-g") == 0) {
+            graph = 1;
+        } else if (strcmp(argv[a], "-j") == 0) {
+            jit = 1;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (a + 1 != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_romstore *store = chip8_romstore_open(argv[a]);
+    const struct chip8_rom *rom = store ? chip8_romstore_get(store, 0) : NULL;
+    struct chip8_machine *m = chip8_machine_create();
+
+    if (rom == NULL || m == NULL || !chip8_rom_load(m, rom)) {
+        fprintf(stderr, "unable to load %s\n", argv[a]);
+        chip8_machine_destroy(&m);
+        chip8_romstore_close(&store);
+        return 1;
+    }
+
+    const struct chip8_analysis *an = chip8_romstore_artifact(store, rom, &chip8_artifact_analysis);
+    int rc = 0;
+
+    if (an == NULL) {
+        fprintf(stderr, "unable to analyse %s\n", argv[a]);
+        rc = 1;
+    } else if (graph) {
+        print_graph(an, rom->name);
+    } else {
+        printf("; %s: %zu bytes, %zu instructions in %zu blocks\n", rom->name, rom->size, an->instructions, an->block_count);
+        printf("; %zu computed jumps, %zu writes through an unknown I, %zu self-modifying bytes\n",
+               an->computed, an->wild_writes, an->self_modifying);
+
+        if (jit) {
+            struct chip8_jit *j = chip8_jit_create();
+            int blocks = j ? chip8_jit_precompile(j, m, an) : 0;
+
+            printf("; ahead of time: %d jit blocks, %zu bytes\n", blocks, j ? chip8_jit_bytes(j) : 0);
+            chip8_jit_destroy(&j);
+        }
+
+        print_blocks(an);
+        print_listing(an, m->memory, rom->size);
+    }
+
+    chip8_machine_destroy(&m);
+    chip8_romstore_close(&store);
+
+    return rc;
+}
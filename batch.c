@@ -0,0 +1,293 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "batch.h"
+#include "lanes.h"
+#include "pool.h"
+
+/**
+ * The range of job groups a worker has yet to run; [head, tail)
+ */
+struct batch_queue {
+    pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+};
+
+struct batch_worker {
+    struct batch_queue queue;
+    struct batch_context *ctx;
+    struct chip8_pool *pool;         /* machines of the worker's jobs */
+    int index;
+    pthread_t thread;
+};
+
+struct batch_context {
+    const struct chip8_batch *batch;
+    const struct chip8_batch_job *jobs;
+    struct chip8_batch_result *results;
+    struct batch_worker *workers;
+    int count;
+    size_t jobs_count;
+    size_t group;                    /* jobs per group */
+};
+
+/**
+ * Takes the next group from the front of the worker's own range
+ * @return {int} 1 when a job was taken
+ */
+static int batch_take(struct batch_worker *w, size_t *group) {
+    int taken = 0;
+
+    pthread_mutex_lock(&w->queue.lock);
+    if (w->queue.head < w->queue.tail) {
+        *group = w->queue.head++;
+        taken = 1;
+    }
+    pthread_mutex_unlock(&w->queue.lock);
+
+    return taken;
+}
+
+/**
+ * Moves the back half of another worker's range into this (empty) worker's range
+ * @return {int} 1 when any work was stolen
+ */
+static int batch_steal(struct batch_worker *w) {
+    struct batch_context *ctx = w->ctx;
+
+    for (int k = 1; k < ctx->count; k++) {
+        struct batch_worker *victim = &ctx->workers[(w->index + k) % ctx->count];
+        size_t head = 0, tail = 0;
+
+        pthread_mutex_lock(&victim->queue.lock);
+        size_t left = victim->queue.tail - victim->queue.head;
+        if (left > 0) {
+            tail = victim->queue.tail;
+            head = tail - (left + 1) / 2;
+            victim->queue.tail = head;
+        }
+        pthread_mutex_unlock(&victim->queue.lock);
+
+        if (head < tail) {
+            pthread_mutex_lock(&w->queue.lock);
+            w->queue.head = head;
+            w->queue.tail = tail;
+            pthread_mutex_unlock(&w->queue.lock);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void batch_store_result(struct chip8_machine *m, struct chip8_batch_result *res, enum chip8_halt halt,
+                               int status, uint64_t cycles) {
+    res->halt = halt;
+    res->status = status;
+    res->cycles = cycles;
+    res->frame_hash = chip8_display_hash(m);
+    memcpy(res->v, m->v, sizeof(res->v));
+    res->i = m->i;
+    res->pc = m->pc;
+    res->sp = m->sp;
+    res->delay_timer = m->delay_timer;
+    res->sound_timer = m->sound_timer;
+}
+
+/**
+ * Takes the machine of a job from the worker's pool, loaded and seeded
+ * @return {struct chip8_machine*} The machine, NULL when the result records a failure
+ */
+static struct chip8_machine* batch_prepare(const struct chip8_batch *b, struct chip8_pool *pool,
+                                           const struct chip8_batch_job *job, struct chip8_batch_result *res) {
+    struct chip8_machine *m = chip8_pool_acquire(pool);
+    int loaded = m != NULL && (job->rom ? chip8_rom_load(m, job->rom) : chip8_load_memory(m, b->rom, b->rom_size));
+
+    memset(res, 0, sizeof(struct chip8_batch_result));
+
+    if (!loaded) {
+        res->halt = CHIP8_HALT_ERROR;
+        res->status = -1;
+        chip8_pool_release(pool, m);
+        return NULL;
+    }
+
+    chip8_seed(m, job->seed);
+    chip8_set_quirks(m, b->quirks);
+
+    return m;
+}
+
+static void batch_run_job(const struct chip8_batch *b, struct chip8_pool *pool, const struct chip8_batch_job *job,
+                          struct chip8_batch_result *res) {
+    struct chip8_machine *m = batch_prepare(b, pool, job, res);
+    struct chip8_run_result r;
+
+    if (m == NULL) {
+        return;
+    }
+
+    chip8_run_with(m, job->script, b->max_cycles, b->engine, &r);
+    batch_store_result(m, res, r.halt, r.status, r.cycles);
+
+    chip8_pool_release(pool, m);
+}
+
+/**
+ * Runs a group of jobs side by side as the lanes of the lockstep engine
+ */
+static void batch_run_lanes(const struct chip8_batch *b, struct chip8_pool *pool, const struct chip8_batch_job *jobs,
+                            struct chip8_batch_result *results, size_t count) {
+    struct chip8_machine *machines[CHIP8_LANES];
+    const struct chip8_script *scripts[CHIP8_LANES];
+    size_t index[CHIP8_LANES];
+    int lanes = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        struct chip8_machine *m = batch_prepare(b, pool, &jobs[k], &results[k]);
+
+        if (m != NULL) {
+            machines[lanes] = m;
+            scripts[lanes] = jobs[k].script;
+            index[lanes] = k;
+            lanes++;
+        }
+    }
+
+    if (lanes == 0) {
+        return;
+    }
+
+    struct chip8_lanes *l = malloc(sizeof(struct chip8_lanes));
+    if (l != NULL) {
+        uint64_t start[CHIP8_LANES];
+        for (int k = 0; k < lanes; k++) {
+            start[k] = machines[k]->cycles;
+        }
+
+        chip8_lanes_load(l, machines, lanes);
+        chip8_lanes_run(l, scripts, b->max_cycles);
+        chip8_lanes_store(l);
+
+        for (int k = 0; k < lanes; k++) {
+            batch_store_result(machines[k], &results[index[k]], l->halt[k], l->status[k],
+                               machines[k]->cycles - start[k]);
+        }
+
+        free(l);
+    }
+
+    for (int k = 0; k < lanes; k++) {
+        if (l == NULL) {
+            results[index[k]].halt = CHIP8_HALT_ERROR;
+            results[index[k]].status = -1;
+        }
+        chip8_pool_release(pool, machines[k]);
+    }
+}
+
+/**
+ * Runs one group of jobs
+ */
+static void batch_run_group(struct batch_context *ctx, struct chip8_pool *pool, size_t group) {
+    size_t first = group * ctx->group;
+    size_t count = ctx->jobs_count - first < ctx->group ? ctx->jobs_count - first : ctx->group;
+
+    if (ctx->batch->engine == CHIP8_ENGINE_LANES) {
+        batch_run_lanes(ctx->batch, pool, &ctx->jobs[first], &ctx->results[first], count);
+        return;
+    }
+
+    for (size_t k = first; k < first + count; k++) {
+        batch_run_job(ctx->batch, pool, &ctx->jobs[k], &ctx->results[k]);
+    }
+}
+
+static void* batch_worker_main(void *arg) {
+    struct batch_worker *w = arg;
+    struct batch_context *ctx = w->ctx;
+    size_t group;
+
+    // a group's machines go back to the pool before the next group takes them
+    w->pool = chip8_pool_create(ctx->group, NULL);
+
+    for (;;) {
+        while (batch_take(w, &group)) {
+            batch_run_group(ctx, w->pool, group);
+        }
+
+        if (!batch_steal(w)) {
+            break;
+        }
+    }
+
+    chip8_pool_destroy(&w->pool);
+
+    return NULL;
+}
+
+int chip8_batch_run(const struct chip8_batch *b, const struct chip8_batch_job *jobs, size_t count,
+                    struct chip8_batch_result *results) {
+    if (b == NULL || jobs == NULL || results == NULL) {
+        return -1;
+    }
+
+    struct batch_context ctx;
+    ctx.batch = b;
+    ctx.jobs = jobs;
+    ctx.results = results;
+    ctx.count = b->threads > 0 ? b->threads : chip8_host_threads();
+    ctx.jobs_count = count;
+
+    // the lockstep engine takes its jobs in groups that fill every lane
+    ctx.group = b->engine == CHIP8_ENGINE_LANES ? CHIP8_LANES : 1;
+    size_t groups = (count + ctx.group - 1) / ctx.group;
+
+    if ((size_t)ctx.count > groups) {
+        ctx.count = groups > 0 ? (int)groups : 1;
+    }
+
+    ctx.workers = calloc(ctx.count, sizeof(struct batch_worker));
+    if (ctx.workers == NULL) {
+        return -1;
+    }
+
+    // every worker starts with an even share and steals once it runs dry
+    for (int t = 0; t < ctx.count; t++) {
+        struct batch_worker *w = &ctx.workers[t];
+
+        pthread_mutex_init(&w->queue.lock, NULL);
+        w->queue.head = groups * t / ctx.count;
+        w->queue.tail = groups * (t + 1) / ctx.count;
+        w->ctx = &ctx;
+        w->index = t;
+    }
+
+    int started = 0;
+    for (int t = 1; t < ctx.count; t++) {
+        if (pthread_create(&ctx.workers[t].thread, NULL, batch_worker_main, &ctx.workers[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+
+    // the calling thread is worker zero; it steals whatever failed to start
+    batch_worker_main(&ctx.workers[0]);
+
+    for (int t = 1; t <= started; t++) {
+        pthread_join(ctx.workers[t].thread, NULL);
+    }
+
+    for (int t = 0; t < ctx.count; t++) {
+        pthread_mutex_destroy(&ctx.workers[t].queue.lock);
+    }
+
+    free(ctx.workers);
+
+    return 0;
+}
+
+int chip8_host_threads(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
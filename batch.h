@@ -0,0 +1,64 @@
+#ifndef __chip8_batch_h_
+
+#define __chip8_batch_h_
+
+#include "machine.h"
+#include "script.h"
+#include "runner.h"
+#include "romstore.h"
+
+/**
+ * Settings shared by every instance of a batch
+ */
+struct chip8_batch {
+    const uint8_t *rom;              /* program image loaded into every machine */
+    size_t rom_size;                 /* size of the program image */
+    uint64_t max_cycles;             /* cycle budget of each instance */
+    enum chip8_engine engine;        /* engine each instance runs with */
+    int threads;                     /* worker threads, 0 to match the host */
+    enum chip8_quirks quirks;        /* quirk profile every machine runs under */
+};
+
+/**
+ * A single instance of a batch
+ */
+struct chip8_batch_job {
+    const struct chip8_rom *rom;     /* program image, NULL for the batch's own */
+    const struct chip8_script *script; /* input script, may be NULL */
+    uint32_t seed;                   /* random number generator seed */
+};
+
+/**
+ * Final state of a single instance of a batch
+ */
+struct chip8_batch_result {
+    enum chip8_halt halt;            /* why the instance stopped */
+    int status;                      /* result of the last executed step */
+    uint64_t cycles;                 /* cycles executed */
+    uint64_t frame_hash;             /* hash of the final display */
+    uint8_t v[16];                   /* final general registers */
+    uint16_t i;                      /* final index register */
+    uint16_t pc;                     /* final program counter */
+    uint16_t sp;                     /* final stack pointer */
+    uint8_t delay_timer;             /* final delay counter */
+    uint8_t sound_timer;             /* final sound counter */
+};
+
+/**
+ * Runs every job as its own machine on a work-stealing pool of threads
+ * @param {const struct chip8_batch*} b The settings of the batch
+ * @param {const struct chip8_batch_job*} jobs The instances to run
+ * @param {size_t} count The number of instances
+ * @param {struct chip8_batch_result*} results Receives one result per instance
+ * @return {int} The outcome of the execution
+ */
+int chip8_batch_run(const struct chip8_batch *b, const struct chip8_batch_job *jobs, size_t count,
+                    struct chip8_batch_result *results);
+
+/**
+ * Gets the number of processors available on the host
+ * @return {int} The number of processors, at least 1
+ */
+int chip8_host_threads(void);
+
+#endif /* __chip8_batch_h_ */
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include "machine.h"
+#include "script.h"
+#include "runner.h"
+#include "batch.h"
+#include "romstore.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-n count] [-s seed] [-t threads] [-e engine] [-q quirks] [-p pack] roms [script...]\n", name);
+    fprintf(stderr, "  -c cycles   cycle budget of each instance (default 1000000)\n");
+    fprintf(stderr, "  -n count    instances to run without a script (default 1000)\n");
+    fprintf(stderr, "  -s seed     seed of the first instance; each next one adds 1 (default 1)\n");
+    fprintf(stderr, "  -t threads  worker threads (default: one per processor)\n");
+    fprintf(stderr, "  -e engine   switch, table, threaded, jit or lanes (default %s)\n", chip8_engine_name(CHIP8_ENGINE_DEFAULT));
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+    fprintf(stderr, "  -p pack     also write the roms into a single pack\n");
+    fprintf(stderr, "roms is a rom, a directory of roms or a pack; instances are spread evenly over\n");
+    fprintf(stderr, "the distinct roms it holds. With scripts given, one instance runs per script.\n");
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    struct chip8_batch b = { NULL, 0, 1000000, CHIP8_ENGINE_DEFAULT, 0, CHIP8_QUIRKS_MODERN };
+    const char *pack_path = NULL;
+    size_t count = 1000;
+    uint32_t seed = 1;
+    int a = 1;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (a + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(argv[a], "-c") == 0) {
+            b.max_cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-n") == 0) {
+            count = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-s") == 0) {
+            seed = strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-t") == 0) {
+            b.threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-p") == 0) {
+            pack_path = argv[++a];
+        } else if (strcmp(argv[a], "-e") == 0) {
+            int engine = chip8_engine_parse(argv[++a]);
+            if (engine < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            b.engine = engine;
+        } else if (strcmp(argv[a], "-q") == 0) {
+            int quirks = chip8_quirks_parse(argv[++a]);
+            if (quirks < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            b.quirks = quirks;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (a >= argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char *rom_path = argv[a++];
+    struct chip8_romstore *store = chip8_romstore_open(rom_path);
+    if (store == NULL) {
+        fprintf(stderr, "unable to load %s\n", rom_path);
+        return 1;
+    }
+
+    size_t roms = chip8_romstore_count(store);
+    if (pack_path && chip8_romstore_pack(store, pack_path) < 0) {
+        fprintf(stderr, "unable to write %s\n", pack_path);
+    }
+
+    int scripted = a < argc;
+    if (scripted) {
+        count = argc - a;
+    }
+
+    struct chip8_script **scripts = calloc(count, sizeof(struct chip8_script*));
+    struct chip8_batch_job *jobs = calloc(count, sizeof(struct chip8_batch_job));
+    struct chip8_batch_result *results = calloc(count, sizeof(struct chip8_batch_result));
+    int rc = 0;
+
+    if (scripts == NULL || jobs == NULL || results == NULL) {
+        fprintf(stderr, "out of memory\n");
+        rc = 1;
+        goto done;
+    }
+
+    for (size_t k = 0; k < count; k++) {
+        if (scripted && (scripts[k] = chip8_script_load(argv[a + k])) == NULL) {
+            fprintf(stderr, "unable to load script %s\n", argv[a + k]);
+            rc = 1;
+            goto done;
+        }
+
+        // contiguous runs of one rom keep the lanes of a group on the same image
+        jobs[k].rom = chip8_romstore_get(store, k * roms / count);
+        jobs[k].script = scripts[k];
+        jobs[k].seed = seed + (uint32_t)k;
+    }
+
+    double start = now_seconds();
+    chip8_batch_run(&b, jobs, count, results);
+    double elapsed = now_seconds() - start;
+
+    uint64_t total = 0;
+    printf("instance,rom,seed,halt,status,cycles,frame,pc,i,sp,dt,st,v\n");
+    for (size_t k = 0; k < count; k++) {
+        struct chip8_batch_result *r = &results[k];
+
+        printf("%zu,%s,%" PRIu32 ",%s,%d,%" PRIu64 ",%016" PRIx64 ",%04X,%04X,%02X,%02X,%02X,",
+               k, jobs[k].rom->name, jobs[k].seed, chip8_halt_name(r->halt), r->status, r->cycles, r->frame_hash,
+               r->pc, r->i, r->sp, r->delay_timer, r->sound_timer);
+        for (int v = 0; v < 16; v++) {
+            printf("%02X", r->v[v]);
+        }
+        printf("\n");
+
+        total += r->cycles;
+    }
+
+    fprintf(stderr, "%zu instances of %zu roms, %" PRIu64 " cycles in %.3fs (%.1f MIPS)\n",
+            count, roms, total, elapsed, elapsed > 0 ? total / elapsed / 1e6 : 0.0);
+
+done:
+    if (scripts) {
+        for (size_t k = 0; k < count; k++) {
+            chip8_script_destroy(&scripts[k]);
+        }
+    }
+
+    free(scripts);
+    free(jobs);
+    free(results);
+    chip8_romstore_close(&store);
+
+    return rc;
+}
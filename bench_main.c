@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include "machine.h"
+#include "decode.h"
+#include "runner.h"
+#include "script.h"
+#include "jit.h"
+#include "lanes.h"
+
+/* every machine starts from the same seed, so every engine runs the same program */
+#define BENCH_SEED          0xC8B3
+
+/* built-in input; a key is pressed every so many cycles and held for a while */
+#define BENCH_PRESS_EVERY   6000
+#define BENCH_PRESS_HOLD    2000
+
+/* cycles the jit warms its cache up for before it is measured */
+#define BENCH_JIT_WARMUP    1000000
+
+#define BENCH_MAX_BASELINE  256
+
+/* the keys the bundled games steer and fire with */
+static const uint8_t bench_keys[] = { 0x4, 0x5, 0x6, 0x1, 0x7, 0x8, 0x9, 0xC, 0xD, 0x2 };
+
+/**
+ * Measurements of one rom on one engine; also a row of the CSV output
+ */
+struct bench_result {
+    char rom[64];
+    char engine[16];
+    char quirks[16];                 /* quirk profile the machines ran under */
+    uint64_t cycles;                 /* instructions executed */
+    double seconds;                  /* best wall time over the runs */
+    double mips;                     /* millions of instructions per second */
+    uint64_t drw;                    /* DXYN instructions among them */
+    double drw_per_second;
+    size_t bytes;                    /* memory per machine, engine state included */
+    uint64_t frame_hash;             /* display hash at the end of the run */
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-r runs] [-q quirks] [-i script] [-o csv] [-b baseline] [-t percent] rom...\n", name);
+    fprintf(stderr, "  -c cycles   cycles to run each rom for (default 20000000)\n");
+    fprintf(stderr, "  -r runs     runs per rom and engine; the fastest counts (default 1)\n");
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+    fprintf(stderr, "  -i script   input script for every rom (default: a key pressed every %d cycles)\n", BENCH_PRESS_EVERY);
+    fprintf(stderr, "  -o csv      write the results as CSV\n");
+    fprintf(stderr, "  -b baseline compare against the CSV of an earlier run; exits 1 on a regression\n");
+    fprintf(stderr, "  -t percent  slowdown against the baseline counted as a regression (default 5)\n");
+    fprintf(stderr, "A baseline run under another quirk profile is compared on speed alone.\n");
+}
+
+/**
+ * Builds the built-in input script; cycles through the keys the bundled games use
+ * @return {struct chip8_script*} The script, covering the given number of cycles
+ */
+static struct chip8_script* bench_script(uint64_t cycles) {
+    struct chip8_script *s = calloc(1, sizeof(struct chip8_script));
+    size_t presses = cycles / BENCH_PRESS_EVERY + 1;
+
+    if (s == NULL || (s->events = malloc(presses * 2 * sizeof(struct chip8_script_event))) == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    for (size_t p = 0; p < presses; p++) {
+        uint8_t key = bench_keys[p % sizeof(bench_keys)];
+        uint64_t at = (p + 1) * BENCH_PRESS_EVERY;
+
+        s->events[s->count++] = (struct chip8_script_event) { at, key, 1 };
+        s->events[s->count++] = (struct chip8_script_event) { at + BENCH_PRESS_HOLD, key, 0 };
+    }
+
+    return s;
+}
+
+/**
+ * Creates a seeded machine holding the given rom, under the given quirk profile
+ * @return {struct chip8_machine*} The machine, NULL when the rom cannot be loaded
+ */
+static struct chip8_machine* bench_machine(const char *path, enum chip8_quirks quirks) {
+    struct chip8_machine *m = chip8_machine_create();
+
+    if (m == NULL || !chip8_load(m, path)) {
+        chip8_machine_destroy(&m);
+        return NULL;
+    }
+
+    chip8_seed(m, BENCH_SEED);
+    chip8_set_quirks(m, quirks);
+    return m;
+}
+
+/**
+ * Runs a rom through one engine, restarting it whenever it halts
+ * @return {int} The outcome of the execution
+ */
+static int bench_engine(const char *path, enum chip8_engine engine, enum chip8_quirks quirks, const struct chip8_script *s,
+                        uint64_t cycles, int runs, struct bench_result *res) {
+    res->seconds = 0.0;
+
+    for (int run = 0; run < runs; run++) {
+        struct chip8_machine *m = bench_machine(path, quirks);
+        struct chip8_machine *initial = bench_machine(path, quirks);
+        struct chip8_runner *rn = chip8_runner_create(engine, s);
+        uint64_t executed = 0;
+
+        if (m == NULL || initial == NULL || rn == NULL) {
+            chip8_runner_destroy(&rn);
+            chip8_machine_destroy(&m);
+            chip8_machine_destroy(&initial);
+            return -1;
+        }
+
+        double start = now_seconds();
+
+        // a restarted rom keeps the blocks compiled for it, as its memory is reloaded as it was
+        while (executed < cycles) {
+            struct chip8_run_result r;
+            chip8_runner_run(rn, m, cycles - executed, &r);
+            executed += r.cycles;
+
+            if (r.halt != CHIP8_HALT_CYCLES) {
+                memcpy(m, initial, sizeof(struct chip8_machine));
+                chip8_runner_reset(rn, m);
+            }
+        }
+
+        double elapsed = now_seconds() - start;
+
+        if (run == 0 || elapsed < res->seconds) {
+            res->seconds = elapsed;
+        }
+
+        res->cycles = executed;
+        res->frame_hash = chip8_display_hash(m);
+
+        chip8_machine_destroy(&initial);
+        chip8_machine_destroy(&m);
+    }
+
+    res->mips = res->cycles / res->seconds / 1e6;
+
+    return 0;
+}
+
+/**
+ * Counts the DXYN instructions a run executes by stepping through it once;
+ * every engine executes the same instructions, so one count serves them all
+ * @return {uint64_t} The number of DXYN instructions
+ */
+static uint64_t bench_drw(const char *path, enum chip8_quirks quirks, const struct chip8_script *s, uint64_t cycles) {
+    struct chip8_machine *m = bench_machine(path, quirks);
+    struct chip8_machine *initial = bench_machine(path, quirks);
+    const uint8_t *decode = chip8_decode_table();
+    uint64_t drw = 0;
+    size_t cursor = 0;
+
+    for (uint64_t c = 0; m && initial && c < cycles; c++) {
+        cursor = chip8_script_apply(s, cursor, m);
+
+        uint16_t opcode = m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+        int self_jump = (opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == m->pc;
+
+        drw += decode[opcode] == CHIP8_OP_DRW;
+
+        // restart exactly where the engines' runs halt
+        if (chip8_step(m) < 0 || self_jump) {
+            memcpy(m, initial, sizeof(struct chip8_machine));
+            cursor = 0;
+        }
+    }
+
+    chip8_machine_destroy(&initial);
+    chip8_machine_destroy(&m);
+
+    return drw;
+}
+
+/**
+ * Measures the memory one machine takes on an engine, engine state included
+ * @return {size_t} The size in bytes
+ */
+static size_t bench_bytes(const char *path, enum chip8_engine engine, enum chip8_quirks quirks, uint64_t cycles) {
+    size_t bytes = sizeof(struct chip8_machine);
+
+    if (engine == CHIP8_ENGINE_LANES) {
+        bytes += sizeof(struct chip8_lanes) / CHIP8_LANES;
+    }
+
+    if (engine == CHIP8_ENGINE_JIT) {
+        struct chip8_machine *m = bench_machine(path, quirks);
+        struct chip8_jit *j = chip8_jit_create();
+
+        if (m && j) {
+            chip8_jit_run(j, m, cycles < BENCH_JIT_WARMUP ? cycles : BENCH_JIT_WARMUP);
+            bytes += chip8_jit_bytes(j);
+        }
+
+        chip8_jit_destroy(&j);
+        chip8_machine_destroy(&m);
+    }
+
+    return bytes;
+}
+
+/**
+ * Loads the results of an earlier run from its CSV output
+ * @return {size_t} The number of results loaded
+ */
+static size_t bench_load_baseline(const char *path, struct bench_result *rows, size_t max) {
+    FILE *f = fopen(path, "r");
+    char line[512];
+    size_t count = 0;
+
+    if (f == NULL) {
+        return 0;
+    }
+
+    while (count < max && fgets(line, sizeof(line), f)) {
+        struct bench_result *b = &rows[count];
+        int fields = sscanf(line, "%63[^,],%15[^,],%" SCNu64 ",%lf,%lf,%" SCNu64 ",%lf,%zu,%" SCNx64 ",%15[^,\n]",
+                            b->rom, b->engine, &b->cycles, &b->seconds, &b->mips,
+                            &b->drw, &b->drw_per_second, &b->bytes, &b->frame_hash, b->quirks);
+
+        // results from before quirk profiles ran under the modern one
+        if (fields == 9) {
+            snprintf(b->quirks, sizeof(b->quirks), "%s", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+        }
+
+        if (fields >= 9) {
+            count++;
+        }
+    }
+
+    fclose(f);
+    return count;
+}
+
+static const struct bench_result* bench_find(const struct bench_result *rows, size_t count, const struct bench_result *res) {
+    for (size_t k = 0; k < count; k++) {
+        if (strcmp(rows[k].rom, res->rom) == 0 && strcmp(rows[k].engine, res->engine) == 0) {
+            return &rows[k];
+        }
+    }
+
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t cycles = 20000000;
+    int runs = 1;
+    int quirks = CHIP8_QUIRKS_MODERN;
+    double threshold = 5.0;
+    const char *script_path = NULL;
+    const char *csv_path = NULL;
+    const char *baseline_path = NULL;
+    int first = 0;
+
+    for (int a = 1; a < argc && first == 0; a++) {
+        if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) {
+            cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+            runs = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-q") == 0 && a + 1 < argc) {
+            if ((quirks = chip8_quirks_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-i") == 0 && a + 1 < argc) {
+            script_path = argv[++a];
+        } else if (strcmp(argv[a], "-o") == 0 && a + 1 < argc) {
+            csv_path = argv[++a];
+        } else if (strcmp(argv[a], "-b") == 0 && a + 1 < argc) {
+            baseline_path = argv[++a];
+        } else if (strcmp(argv[a], "-t") == 0 && a + 1 < argc) {
+            threshold = strtod(argv[++a], NULL);
+        } else if (argv[a][0] != '-') {
+            first = a;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (first == 0 || runs < 1 || cycles == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_script *s = script_path ? chip8_script_load(script_path) : bench_script(cycles);
+    if (s == NULL) {
+        fprintf(stderr, "unable to load script %s\n", script_path ? script_path : "(built-in)");
+        return 1;
+    }
+
+    static struct bench_result baseline[BENCH_MAX_BASELINE];
+    size_t baseline_count = 0;
+
+    if (baseline_path && (baseline_count = bench_load_baseline(baseline_path, baseline, BENCH_MAX_BASELINE)) == 0) {
+        fprintf(stderr, "no results in baseline %s; not comparing\n", baseline_path);
+    }
+
+    FILE *csv = NULL;
+    if (csv_path) {
+        if ((csv = fopen(csv_path, "w")) == NULL) {
+            fprintf(stderr, "unable to write %s\n", csv_path);
+            chip8_script_destroy(&s);
+            return 1;
+        }
+
+        fprintf(csv, "rom,engine,cycles,seconds,mips,drw,drw_per_second,bytes,frame_hash,quirks\n");
+    }
+
+    printf("%-16s %-9s %-7s %9s %11s %8s %-16s %9s", "rom", "engine", "quirks", "mips", "dxyn/s", "bytes", "frame", "gain");
+    if (baseline_count) {
+        printf(" %9s", "baseline");
+    }
+    printf("\n");
+
+    int failed = 0;
+
+    for (int a = first; a < argc; a++) {
+        const char *name = strrchr(argv[a], '/') ? strrchr(argv[a], '/') + 1 : argv[a];
+        uint64_t drw = bench_drw(argv[a], quirks, s, cycles);
+        // the switch engine is engine 0, so it runs first and sets the reference
+        struct bench_result reference = { 0 };
+
+        for (int e = 0; e < CHIP8_ENGINE_COUNT; e++) {
+            struct bench_result res;
+            memset(&res, 0, sizeof(res));
+            snprintf(res.rom, sizeof(res.rom), "%s", name);
+            snprintf(res.engine, sizeof(res.engine), "%s", chip8_engine_name(e));
+            snprintf(res.quirks, sizeof(res.quirks), "%s", chip8_quirks_name(quirks));
+
+            if (bench_engine(argv[a], e, quirks, s, cycles, runs, &res) < 0) {
+                fprintf(stderr, "unable to load %s\n", argv[a]);
+                failed = 1;
+                break;
+            }
+
+            res.drw = drw;
+            res.drw_per_second = drw / res.seconds;
+            res.bytes = bench_bytes(argv[a], e, quirks, cycles);
+
+            if (e == CHIP8_ENGINE_SWITCH) {
+                reference = res;
+            }
+
+            // gain over the reference switch, which every engine has to agree with
+            printf("%-16s %-9s %-7s %9.1f %11.0f %8zu %016" PRIx64 " %8.2fx", res.rom, res.engine, res.quirks,
+                   res.mips, res.drw_per_second, res.bytes, res.frame_hash, res.mips / reference.mips);
+
+            const struct bench_result *base = bench_find(baseline, baseline_count, &res);
+
+            if (base && base->cycles == res.cycles) {
+                double delta = (res.mips - base->mips) / base->mips * 100.0;
+                printf(" %+8.1f%%", delta);
+
+                if (delta < -threshold) {
+                    printf(" regressed");
+                    failed = 1;
+                }
+
+                // other profiles run other programs, as far as the display goes
+                if (strcmp(base->quirks, res.quirks) == 0 && (base->frame_hash != res.frame_hash || base->drw != res.drw)) {
+                    printf(" changed");
+                    failed = 1;
+                }
+            }
+
+            if (res.frame_hash != reference.frame_hash) {
+                printf(" mismatch");
+                failed = 1;
+            }
+
+            printf("\n");
+
+            if (csv) {
+                fprintf(csv, "%s,%s,%" PRIu64 ",%.6f,%.3f,%" PRIu64 ",%.1f,%zu,%016" PRIx64 ",%s\n",
+                        res.rom, res.engine, res.cycles, res.seconds, res.mips,
+                        res.drw, res.drw_per_second, res.bytes, res.frame_hash, res.quirks);
+            }
+        }
+    }
+
+    if (csv && fclose(csv) != 0) {
+        fprintf(stderr, "unable to write %s\n", csv_path);
+        failed = 1;
+    }
+
+    chip8_script_destroy(&s);
+
+    return failed;
+}
@@ -0,0 +1,33 @@
+#ifndef __chip8_h_
+
+#define __chip8_h_
+
+/*
+ * Embedding interface of libchip8. A host creates machines with its own
+ * allocator (chip8_machine_create_with()), loads programs straight from its
+ * buffers (chip8_load_memory()), attaches its callbacks (chip8_host_attach())
+ * and drives each machine a number of 60 Hz ticks at a time (chip8_host_run()).
+ * The library has no dependency on SDL or any other frontend.
+ */
+
+#include "machine.h"
+#include "xmachine.h"
+#include "decode.h"
+#include "analysis.h"
+#include "host.h"
+#include "pool.h"
+#include "romstore.h"
+#include "runner.h"
+#include "script.h"
+#include "inputlog.h"
+#include "scheduler.h"
+#include "snapshot.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "batch.h"
+#include "fuzz.h"
+#include "diff.h"
+#include "profile.h"
+#include "trace.h"
+
+#endif /* __chip8_h_ */
@@ -0,0 +1,168 @@
+#include <pthread.h>
+#include <stdio.h>
+#include "decode.h"
+
+static uint8_t decode_table[0x10000];
+static pthread_once_t decode_once = PTHREAD_ONCE_INIT;
+
+static const char *op_names[CHIP8_OP_COUNT] = {
+    [CHIP8_OP_UNKNOWN]   = "unknown",
+    [CHIP8_OP_SYS]       = "sys",
+    [CHIP8_OP_CLS]       = "cls",
+    [CHIP8_OP_RET]       = "ret",
+    [CHIP8_OP_JP]        = "jp",
+    [CHIP8_OP_CALL]      = "call",
+    [CHIP8_OP_SE_BYTE]   = "se_byte",
+    [CHIP8_OP_SNE_BYTE]  = "sne_byte",
+    [CHIP8_OP_SE_REG]    = "se_reg",
+    [CHIP8_OP_LD_BYTE]   = "ld_byte",
+    [CHIP8_OP_ADD_BYTE]  = "add_byte",
+    [CHIP8_OP_LD_REG]    = "ld_reg",
+    [CHIP8_OP_OR]        = "or",
+    [CHIP8_OP_AND]       = "and",
+    [CHIP8_OP_XOR]       = "xor",
+    [CHIP8_OP_ADD_REG]   = "add_reg",
+    [CHIP8_OP_SUB]       = "sub",
+    [CHIP8_OP_SHR]       = "shr",
+    [CHIP8_OP_SUBN]      = "subn",
+    [CHIP8_OP_SHL]       = "shl",
+    [CHIP8_OP_SNE_REG]   = "sne_reg",
+    [CHIP8_OP_LD_I]      = "ld_i",
+    [CHIP8_OP_JP_V0]     = "jp_v0",
+    [CHIP8_OP_RND]       = "rnd",
+    [CHIP8_OP_DRW]       = "drw",
+    [CHIP8_OP_SKP]       = "skp",
+    [CHIP8_OP_SKNP]      = "sknp",
+    [CHIP8_OP_LD_VX_DT]  = "ld_vx_dt",
+    [CHIP8_OP_LD_VX_K]   = "ld_vx_k",
+    [CHIP8_OP_LD_DT_VX]  = "ld_dt_vx",
+    [CHIP8_OP_LD_ST_VX]  = "ld_st_vx",
+    [CHIP8_OP_ADD_I]     = "add_i",
+    [CHIP8_OP_LD_F]      = "ld_f",
+    [CHIP8_OP_LD_B]      = "ld_b",
+    [CHIP8_OP_LD_MEM_VX] = "ld_mem_vx",
+    [CHIP8_OP_LD_VX_MEM] = "ld_vx_mem",
+};
+
+enum chip8_op chip8_decode(uint16_t opcode) {
+    uint8_t n  = (opcode>>0) & 0xF;
+    uint8_t nn = (opcode>>0) & 0xFF;
+
+    switch ((opcode>>12) & 0xF) {
+        case 0x0:
+            switch (nn) {
+                case 0xE0: return CHIP8_OP_CLS;
+                case 0xEE: return CHIP8_OP_RET;
+                default:   return CHIP8_OP_SYS;
+            }
+        case 0x1: return CHIP8_OP_JP;
+        case 0x2: return CHIP8_OP_CALL;
+        case 0x3: return CHIP8_OP_SE_BYTE;
+        case 0x4: return CHIP8_OP_SNE_BYTE;
+        case 0x5: return CHIP8_OP_SE_REG;
+        case 0x6: return CHIP8_OP_LD_BYTE;
+        case 0x7: return CHIP8_OP_ADD_BYTE;
+        case 0x8:
+            switch (n) {
+                case 0x0: return CHIP8_OP_LD_REG;
+                case 0x1: return CHIP8_OP_OR;
+                case 0x2: return CHIP8_OP_AND;
+                case 0x3: return CHIP8_OP_XOR;
+                case 0x4: return CHIP8_OP_ADD_REG;
+                case 0x5: return CHIP8_OP_SUB;
+                case 0x6: return CHIP8_OP_SHR;
+                case 0x7: return CHIP8_OP_SUBN;
+                case 0xE: return CHIP8_OP_SHL;
+                default:  return CHIP8_OP_UNKNOWN;
+            }
+        case 0x9: return CHIP8_OP_SNE_REG;
+        case 0xA: return CHIP8_OP_LD_I;
+        case 0xB: return CHIP8_OP_JP_V0;
+        case 0xC: return CHIP8_OP_RND;
+        case 0xD: return CHIP8_OP_DRW;
+        case 0xE:
+            switch (nn) {
+                case 0x9E: return CHIP8_OP_SKP;
+                case 0xA1: return CHIP8_OP_SKNP;
+                default:   return CHIP8_OP_UNKNOWN;
+            }
+        case 0xF:
+            switch (nn) {
+                case 0x07: return CHIP8_OP_LD_VX_DT;
+                case 0x0A: return CHIP8_OP_LD_VX_K;
+                case 0x15: return CHIP8_OP_LD_DT_VX;
+                case 0x18: return CHIP8_OP_LD_ST_VX;
+                case 0x1E: return CHIP8_OP_ADD_I;
+                case 0x29: return CHIP8_OP_LD_F;
+                case 0x33: return CHIP8_OP_LD_B;
+                case 0x55: return CHIP8_OP_LD_MEM_VX;
+                case 0x65: return CHIP8_OP_LD_VX_MEM;
+                default:   return CHIP8_OP_UNKNOWN;
+            }
+    }
+
+    return CHIP8_OP_UNKNOWN;
+}
+
+static void chip8_decode_init(void) {
+    for (uint32_t opcode = 0; opcode < 0x10000; opcode++) {
+        decode_table[opcode] = chip8_decode(opcode);
+    }
+}
+
+const uint8_t* chip8_decode_table(void) {
+    pthread_once(&decode_once, chip8_decode_init);
+    return decode_table;
+}
+
+const char* chip8_op_name(enum chip8_op op) {
+    if (op >= CHIP8_OP_COUNT) {
+        return op_names[CHIP8_OP_UNKNOWN];
+    }
+
+    return op_names[op];
+}
+
+int chip8_disassemble(uint16_t opcode, char *buf, size_t size) {
+    unsigned x = (opcode >> 8) & 0xF, y = (opcode >> 4) & 0xF, n = opcode & 0xF;
+    unsigned nn = opcode & 0xFF, nnn = opcode & 0xFFF;
+
+    switch (chip8_decode(opcode)) {
+        case CHIP8_OP_SYS:       return snprintf(buf, size, "SYS 0x%03X", nnn);
+        case CHIP8_OP_CLS:       return snprintf(buf, size, "CLS");
+        case CHIP8_OP_RET:       return snprintf(buf, size, "RET");
+        case CHIP8_OP_JP:        return snprintf(buf, size, "JP 0x%03X", nnn);
+        case CHIP8_OP_CALL:      return snprintf(buf, size, "CALL 0x%03X", nnn);
+        case CHIP8_OP_SE_BYTE:   return snprintf(buf, size, "SE V%X, 0x%02X", x, nn);
+        case CHIP8_OP_SNE_BYTE:  return snprintf(buf, size, "SNE V%X, 0x%02X", x, nn);
+        case CHIP8_OP_SE_REG:    return snprintf(buf, size, "SE V%X, V%X", x, y);
+        case CHIP8_OP_LD_BYTE:   return snprintf(buf, size, "LD V%X, 0x%02X", x, nn);
+        case CHIP8_OP_ADD_BYTE:  return snprintf(buf, size, "ADD V%X, 0x%02X", x, nn);
+        case CHIP8_OP_LD_REG:    return snprintf(buf, size, "LD V%X, V%X", x, y);
+        case CHIP8_OP_OR:        return snprintf(buf, size, "OR V%X, V%X", x, y);
+        case CHIP8_OP_AND:       return snprintf(buf, size, "AND V%X, V%X", x, y);
+        case CHIP8_OP_XOR:       return snprintf(buf, size, "XOR V%X, V%X", x, y);
+        case CHIP8_OP_ADD_REG:   return snprintf(buf, size, "ADD V%X, V%X", x, y);
+        case CHIP8_OP_SUB:       return snprintf(buf, size, "SUB V%X, V%X", x, y);
+        case CHIP8_OP_SHR:       return snprintf(buf, size, "SHR V%X", x);
+        case CHIP8_OP_SUBN:      return snprintf(buf, size, "SUBN V%X, V%X", x, y);
+        case CHIP8_OP_SHL:       return snprintf(buf, size, "SHL V%X", x);
+        case CHIP8_OP_SNE_REG:   return snprintf(buf, size, "SNE V%X, V%X", x, y);
+        case CHIP8_OP_LD_I:      return snprintf(buf, size, "LD I, 0x%03X", nnn);
+        case CHIP8_OP_JP_V0:     return snprintf(buf, size, "JP V0, 0x%03X", nnn);
+        case CHIP8_OP_RND:       return snprintf(buf, size, "RND V%X, 0x%02X", x, nn);
+        case CHIP8_OP_DRW:       return snprintf(buf, size, "DRW V%X, V%X, %u", x, y, n);
+        case CHIP8_OP_SKP:       return snprintf(buf, size, "SKP V%X", x);
+        case CHIP8_OP_SKNP:      return snprintf(buf, size, "SKNP V%X", x);
+        case CHIP8_OP_LD_VX_DT:  return snprintf(buf, size, "LD V%X, DT", x);
+        case CHIP8_OP_LD_VX_K:   return snprintf(buf, size, "LD V%X, K", x);
+        case CHIP8_OP_LD_DT_VX:  return snprintf(buf, size, "LD DT, V%X", x);
+        case CHIP8_OP_LD_ST_VX:  return snprintf(buf, size, "LD ST, V%X", x);
+        case CHIP8_OP_ADD_I:     return snprintf(buf, size, "ADD I, V%X", x);
+        case CHIP8_OP_LD_F:      return snprintf(buf, size, "LD F, V%X", x);
+        case CHIP8_OP_LD_B:      return snprintf(buf, size, "LD B, V%X", x);
+        case CHIP8_OP_LD_MEM_VX: return snprintf(buf, size, "LD [I], V%X", x);
+        case CHIP8_OP_LD_VX_MEM: return snprintf(buf, size, "LD V%X, [I]", x);
+        default:                 return snprintf(buf, size, "DW 0x%04X", opcode);
+    }
+}
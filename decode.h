@@ -0,0 +1,80 @@
+#ifndef __chip8_decode_h_
+
+#define __chip8_decode_h_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Instruction classes; every 16-bit opcode decodes to exactly one of these
+ */
+enum chip8_op {
+    CHIP8_OP_UNKNOWN = 0,            /* not a valid instruction */
+    CHIP8_OP_SYS,                    /* 0NNN call RCA 1802 program */
+    CHIP8_OP_CLS,                    /* 00E0 */
+    CHIP8_OP_RET,                    /* 00EE */
+    CHIP8_OP_JP,                     /* 1NNN */
+    CHIP8_OP_CALL,                   /* 2NNN */
+    CHIP8_OP_SE_BYTE,                /* 3XNN */
+    CHIP8_OP_SNE_BYTE,               /* 4XNN */
+    CHIP8_OP_SE_REG,                 /* 5XY0 */
+    CHIP8_OP_LD_BYTE,                /* 6XNN */
+    CHIP8_OP_ADD_BYTE,               /* 7XNN */
+    CHIP8_OP_LD_REG,                 /* 8XY0 */
+    CHIP8_OP_OR,                     /* 8XY1 */
+    CHIP8_OP_AND,                    /* 8XY2 */
+    CHIP8_OP_XOR,                    /* 8XY3 */
+    CHIP8_OP_ADD_REG,                /* 8XY4 */
+    CHIP8_OP_SUB,                    /* 8XY5 */
+    CHIP8_OP_SHR,                    /* 8XY6 */
+    CHIP8_OP_SUBN,                   /* 8XY7 */
+    CHIP8_OP_SHL,                    /* 8XYE */
+    CHIP8_OP_SNE_REG,                /* 9XY0 */
+    CHIP8_OP_LD_I,                   /* ANNN */
+    CHIP8_OP_JP_V0,                  /* BNNN */
+    CHIP8_OP_RND,                    /* CXNN */
+    CHIP8_OP_DRW,                    /* DXYN */
+    CHIP8_OP_SKP,                    /* EX9E */
+    CHIP8_OP_SKNP,                   /* EXA1 */
+    CHIP8_OP_LD_VX_DT,               /* FX07 */
+    CHIP8_OP_LD_VX_K,                /* FX0A */
+    CHIP8_OP_LD_DT_VX,               /* FX15 */
+    CHIP8_OP_LD_ST_VX,               /* FX18 */
+    CHIP8_OP_ADD_I,                  /* FX1E */
+    CHIP8_OP_LD_F,                   /* FX29 */
+    CHIP8_OP_LD_B,                   /* FX33 */
+    CHIP8_OP_LD_MEM_VX,              /* FX55 */
+    CHIP8_OP_LD_VX_MEM,              /* FX65 */
+    CHIP8_OP_COUNT
+};
+
+/**
+ * Decodes an opcode into its instruction class, following chip8_execute()
+ * @param {uint16_t} opcode The opcode to decode
+ * @return {enum chip8_op} The instruction class of the opcode
+ */
+enum chip8_op chip8_decode(uint16_t opcode);
+
+/**
+ * Gets the precomputed decode table holding the class of all 64K opcodes
+ * @return {const uint8_t *} The table, indexed by opcode
+ */
+const uint8_t* chip8_decode_table(void);
+
+/**
+ * Gets the mnemonic of an instruction class
+ * @param {enum chip8_op} op The instruction class
+ * @return {const char *} The mnemonic
+ */
+const char* chip8_op_name(enum chip8_op op);
+
+/**
+ * Writes an opcode out in assembler syntax, such as "DRW V0, V1, 5"
+ * @param {uint16_t} opcode The opcode to disassemble
+ * @param {char *} buf Receives the text, NUL terminated
+ * @param {size_t} size The size of the buffer
+ * @return {int} The length of the text, as snprintf() counts it
+ */
+int chip8_disassemble(uint16_t opcode, char *buf, size_t size);
+
+#endif /* __chip8_decode_h_ */
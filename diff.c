@@ -0,0 +1,351 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "diff.h"
+#include "jit.h"
+#include "machine_ops.h"
+
+static const char *field_names[] = {
+    "v", "i", "pc", "sp", "timers", "memory", "display", "cycles", "status", "rng"
+};
+
+/**
+ * One of the two machines of a job, with the state of its run
+ */
+struct diff_side {
+    struct chip8_machine m;
+    int status;                      /* outcome of the last executed step */
+    size_t cursor;                   /* next script event to apply */
+};
+
+/**
+ * Everything a job steps; copied whole to go back to the last agreed state
+ */
+struct diff_pair {
+    struct diff_side ref;            /* stepped through chip8_execute() */
+    struct diff_side alt;            /* run through the engine */
+    struct chip8_diff_step trace[CHIP8_DIFF_TRACE]; /* ring of the reference's instructions */
+    uint64_t steps;                  /* instructions recorded into the ring */
+};
+
+struct diff_context {
+    const struct chip8_diff *diff;
+    const struct chip8_batch_job *jobs;
+    struct chip8_diff_result *results;
+    size_t count;
+    atomic_size_t next;              /* next job to hand out */
+};
+
+struct diff_worker {
+    struct diff_context *ctx;
+    pthread_t thread;
+};
+
+static uint64_t diff_memory_hash(const struct chip8_machine *m) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t k = 0; k < sizeof(m->memory); k++) {
+        hash ^= m->memory[k];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static void diff_capture(const struct diff_side *side, struct chip8_diff_state *st) {
+    const struct chip8_machine *m = &side->m;
+
+    memcpy(st->v, m->v, sizeof(st->v));
+    st->i = m->i;
+    st->pc = m->pc;
+    st->sp = m->sp;
+    st->delay_timer = m->delay_timer;
+    st->sound_timer = m->sound_timer;
+    st->status = side->status;
+    st->cycles = m->cycles;
+    st->rng = m->rng;
+    st->memory_hash = diff_memory_hash(m);
+    st->display_hash = chip8_display_hash(m);
+}
+
+/**
+ * Compares the two machines of a job
+ * @return {unsigned} The chip8_diff_field bits that differ, 0 when they agree
+ */
+static unsigned diff_compare(const struct diff_pair *p) {
+    const struct chip8_machine *a = &p->ref.m, *b = &p->alt.m;
+    unsigned fields = 0;
+
+    fields |= memcmp(a->v, b->v, sizeof(a->v)) ? CHIP8_DIFF_V : 0;
+    fields |= a->i != b->i ? CHIP8_DIFF_I : 0;
+    fields |= a->pc != b->pc ? CHIP8_DIFF_PC : 0;
+    fields |= a->sp != b->sp ? CHIP8_DIFF_SP : 0;
+    fields |= a->delay_timer != b->delay_timer || a->sound_timer != b->sound_timer ? CHIP8_DIFF_TIMERS : 0;
+    fields |= memcmp(a->memory, b->memory, sizeof(a->memory)) || memcmp(a->stack, b->stack, sizeof(a->stack))
+              ? CHIP8_DIFF_MEMORY : 0;
+    fields |= memcmp(a->display, b->display, sizeof(a->display)) ? CHIP8_DIFF_DISPLAY : 0;
+    fields |= a->cycles != b->cycles ? CHIP8_DIFF_CYCLES : 0;
+    fields |= p->ref.status != p->alt.status ? CHIP8_DIFF_STATUS : 0;
+    fields |= a->rng != b->rng ? CHIP8_DIFF_RNG : 0;
+
+    return fields;
+}
+
+/**
+ * Applies the script events due at the current cycle to both machines
+ * @return {uint64_t} The cycle of the next event, UINT64_MAX when there is none
+ */
+static uint64_t diff_apply(struct diff_pair *p, const struct chip8_script *s) {
+    p->ref.cursor = chip8_script_apply(s, p->ref.cursor, &p->ref.m);
+    p->alt.cursor = chip8_script_apply(s, p->alt.cursor, &p->alt.m);
+
+    return s && p->ref.cursor < s->count ? s->events[p->ref.cursor].cycle : UINT64_MAX;
+}
+
+/**
+ * Steps the reference up to count cycles, recording every instruction
+ * @return {enum chip8_fault} The fault it stopped in front of, CHIP8_FAULT_NONE otherwise
+ */
+static enum chip8_fault diff_step_reference(struct diff_pair *p, uint64_t count) {
+    struct chip8_machine *m = &p->ref.m;
+
+    for (uint64_t k = 0; k < count && p->ref.status >= 0; k++) {
+        enum chip8_fault f = chip8_fault_check(m);
+
+        // unknown and system opcodes fail the same way on every engine
+        if (f != CHIP8_FAULT_NONE && f != CHIP8_FAULT_UNKNOWN && f != CHIP8_FAULT_SYS) {
+            return f;
+        }
+
+        uint16_t pc = m->pc;
+        uint16_t opcode = chip8_fetch(m);
+        struct chip8_diff_step *step = &p->trace[p->steps++ % CHIP8_DIFF_TRACE];
+
+        step->cycle = m->cycles;
+        step->pc = pc;
+        step->opcode = opcode;
+
+        p->ref.status = chip8_execute(m, opcode);
+    }
+
+    return CHIP8_FAULT_NONE;
+}
+
+/**
+ * Runs the engine until its machine reaches the given cycle or fails; idle
+ * loops, which the run loops stop at, are run through an instruction at a time
+ */
+static void diff_run_engine(struct diff_pair *p, enum chip8_engine engine, struct chip8_jit *jit, uint64_t target) {
+    struct chip8_machine *m = &p->alt.m;
+
+    while (m->cycles < target && p->alt.status >= 0) {
+        uint64_t before = m->cycles;
+        int rc = chip8_run_engine(m, engine, jit, target - m->cycles);
+
+        p->alt.status = rc < 0 ? rc : 0;
+
+        if (rc == 0 && m->cycles == before) {
+            break;
+        }
+    }
+}
+
+/**
+ * Records both states of a job into its result
+ */
+static void diff_record(const struct diff_pair *p, unsigned fields, struct chip8_diff_result *res) {
+    res->fields = fields;
+    res->cycles = p->ref.m.cycles;
+    diff_capture(&p->ref, &res->reference);
+    diff_capture(&p->alt, &res->engine);
+
+    // the ring is unrolled oldest first
+    uint64_t first = p->steps > CHIP8_DIFF_TRACE ? p->steps - CHIP8_DIFF_TRACE : 0;
+
+    res->trace_count = (size_t)(p->steps - first);
+    for (uint64_t k = first; k < p->steps; k++) {
+        res->trace[k - first] = p->trace[k % CHIP8_DIFF_TRACE];
+    }
+}
+
+/**
+ * Goes back to the last agreed state and steps both machines an instruction
+ * at a time up to where they were found to differ, to name the first
+ * instruction after which they do
+ */
+static void diff_narrow(struct diff_pair *p, const struct diff_pair *agreed, const struct chip8_script *s,
+                        enum chip8_engine engine, struct chip8_jit *jit, uint64_t until,
+                        struct chip8_diff_result *res) {
+    *p = *agreed;
+    res->agreed = agreed->ref.m.cycles;
+
+    // the engine's memory was rewritten under any blocks it compiled
+    if (jit != NULL) {
+        chip8_jit_flush(jit);
+    }
+
+    while (p->ref.m.cycles < until && p->ref.status >= 0) {
+        diff_apply(p, s);
+
+        if (diff_step_reference(p, 1) != CHIP8_FAULT_NONE) {
+            break;
+        }
+
+        diff_run_engine(p, engine, jit, p->ref.m.cycles);
+
+        unsigned fields = diff_compare(p);
+
+        if (fields != 0) {
+            diff_record(p, fields, res);
+            res->exact = 1;
+            return;
+        }
+
+        res->agreed = p->ref.m.cycles;
+    }
+
+    // run in smaller steps the engine agrees; the divergence depends on where its runs stop
+    res->agreed = agreed->ref.m.cycles;
+}
+
+static int diff_load(struct chip8_machine *m, const struct chip8_diff *d, const struct chip8_batch_job *job) {
+    chip8_machine_init(m, NULL);
+
+    if (!(job->rom ? chip8_rom_load(m, job->rom) : chip8_load_memory(m, d->rom, d->rom_size))) {
+        return -1;
+    }
+
+    chip8_seed(m, job->seed);
+    chip8_set_quirks(m, d->quirks);
+
+    return chip8_set_ipf(m, d->ipf);
+}
+
+static void diff_run_job(const struct chip8_diff *d, struct diff_pair *p, struct diff_pair *agreed,
+                         struct chip8_jit *jit, const struct chip8_batch_job *job, struct chip8_diff_result *res) {
+    memset(res, 0, sizeof(struct chip8_diff_result));
+    memset(p, 0, sizeof(struct diff_pair));
+
+    if (diff_load(&p->ref.m, d, job) < 0 || diff_load(&p->alt.m, d, job) < 0) {
+        res->reference.status = res->engine.status = -1;
+        return;
+    }
+
+    if (jit != NULL) {
+        chip8_jit_flush(jit);
+    }
+
+    uint32_t interval = d->interval > 0 ? d->interval : 1;
+    *agreed = *p;
+
+    while (p->ref.m.cycles < d->max_cycles && p->ref.status >= 0 && res->fault == CHIP8_FAULT_NONE) {
+        uint64_t start = p->ref.m.cycles;
+        uint64_t stop = d->max_cycles - start < interval ? d->max_cycles : start + interval;
+        uint64_t next = diff_apply(p, job->script);
+
+        // key transitions land between runs, so both machines see them at the same cycle
+        if (next < stop) {
+            stop = next;
+        }
+
+        res->fault = diff_step_reference(p, stop - start);
+        diff_run_engine(p, d->engine, jit, p->ref.m.cycles);
+
+        unsigned fields = diff_compare(p);
+
+        if (fields != 0) {
+            res->diverged = 1;
+            diff_record(p, fields, res);
+            diff_narrow(p, agreed, job->script, d->engine, jit, res->cycles, res);
+            return;
+        }
+
+        *agreed = *p;
+    }
+
+    res->agreed = p->ref.m.cycles;
+    diff_record(p, 0, res);
+}
+
+static void* diff_worker_main(void *arg) {
+    struct diff_worker *w = arg;
+    struct diff_context *ctx = w->ctx;
+    const struct chip8_diff *d = ctx->diff;
+
+    // both the running pair and the last agreed one are too large for a thread's stack
+    struct diff_pair *pairs = malloc(2 * sizeof(struct diff_pair));
+    struct chip8_jit *jit = d->engine == CHIP8_ENGINE_JIT ? chip8_jit_create() : NULL;
+    int ready = pairs != NULL && (d->engine != CHIP8_ENGINE_JIT || jit != NULL);
+
+    for (size_t k; (k = atomic_fetch_add(&ctx->next, 1)) < ctx->count;) {
+        if (ready) {
+            diff_run_job(d, &pairs[0], &pairs[1], jit, &ctx->jobs[k], &ctx->results[k]);
+        } else {
+            memset(&ctx->results[k], 0, sizeof(struct chip8_diff_result));
+            ctx->results[k].reference.status = ctx->results[k].engine.status = -1;
+        }
+    }
+
+    chip8_jit_destroy(&jit);
+    free(pairs);
+
+    return NULL;
+}
+
+int chip8_diff_run(const struct chip8_diff *d, const struct chip8_batch_job *jobs, size_t count,
+                   struct chip8_diff_result *results) {
+    if (d == NULL || jobs == NULL || results == NULL || d->engine >= CHIP8_ENGINE_COUNT) {
+        return -1;
+    }
+
+    struct diff_context ctx;
+    ctx.diff = d;
+    ctx.jobs = jobs;
+    ctx.results = results;
+    ctx.count = count;
+    atomic_init(&ctx.next, 0);
+
+    int threads = d->threads > 0 ? d->threads : chip8_host_threads();
+
+    if ((size_t)threads > count) {
+        threads = count > 0 ? (int)count : 1;
+    }
+
+    struct diff_worker *workers = calloc(threads, sizeof(struct diff_worker));
+    if (workers == NULL) {
+        return -1;
+    }
+
+    // jobs are handed out one at a time, so long runs do not hold up the rest
+    int started = 0;
+    for (int t = 0; t < threads; t++) {
+        workers[t].ctx = &ctx;
+    }
+
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[t].thread, NULL, diff_worker_main, &workers[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+
+    // the calling thread is worker zero, and takes on whatever failed to start
+    diff_worker_main(&workers[0]);
+
+    for (int t = 1; t <= started; t++) {
+        pthread_join(workers[t].thread, NULL);
+    }
+
+    free(workers);
+
+    return 0;
+}
+
+const char* chip8_diff_field_name(enum chip8_diff_field f) {
+    for (size_t k = 0; k < sizeof(field_names) / sizeof(field_names[0]); k++) {
+        if ((unsigned)f == 1u << k) {
+            return field_names[k];
+        }
+    }
+
+    return "unknown";
+}
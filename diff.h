@@ -0,0 +1,114 @@
+#ifndef __chip8_diff_h_
+
+#define __chip8_diff_h_
+
+#include "machine.h"
+#include "runner.h"
+#include "batch.h"
+#include "fuzz.h"
+
+/**
+ * Parts of the machine state the differential harness compares, one bit each
+ */
+enum chip8_diff_field {
+    CHIP8_DIFF_V       = 0x001,      /* general registers */
+    CHIP8_DIFF_I       = 0x002,      /* index register */
+    CHIP8_DIFF_PC      = 0x004,      /* program counter */
+    CHIP8_DIFF_SP      = 0x008,      /* stack pointer */
+    CHIP8_DIFF_TIMERS  = 0x010,      /* delay and sound timers */
+    CHIP8_DIFF_MEMORY  = 0x020,      /* memory, the stack included */
+    CHIP8_DIFF_DISPLAY = 0x040,      /* display memory */
+    CHIP8_DIFF_CYCLES  = 0x080,      /* cycle count; one engine halted early */
+    CHIP8_DIFF_STATUS  = 0x100,      /* outcome of the last executed step */
+    CHIP8_DIFF_RNG     = 0x200       /* random number generator state */
+};
+
+/* instructions of the reference kept leading up to a divergence */
+#define CHIP8_DIFF_TRACE    32
+
+/**
+ * Settings of a differential run
+ */
+struct chip8_diff {
+    const uint8_t *rom;              /* program image of jobs without their own */
+    size_t rom_size;                 /* size of the program image */
+    uint64_t max_cycles;             /* cycle budget of each job */
+    uint32_t interval;               /* cycles between comparisons */
+    enum chip8_engine engine;        /* engine checked against chip8_execute() */
+    enum chip8_quirks quirks;        /* quirk profile both machines run under */
+    uint16_t ipf;                    /* instructions per timer tick of both machines */
+    int threads;                     /* worker threads, 0 to match the host */
+};
+
+/**
+ * Compared state of one machine
+ */
+struct chip8_diff_state {
+    uint8_t v[16];
+    uint16_t i;
+    uint16_t pc;
+    uint16_t sp;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    int status;                      /* outcome of the last executed step */
+    uint64_t cycles;
+    uint32_t rng;
+    uint64_t memory_hash;            /* FNV-1a of memory */
+    uint64_t display_hash;           /* chip8_display_hash() */
+};
+
+/**
+ * An instruction the reference executed
+ */
+struct chip8_diff_step {
+    uint64_t cycle;                  /* cycle count after the instruction's fetch */
+    uint16_t pc;
+    uint16_t opcode;
+};
+
+/**
+ * Outcome of one job of a differential run
+ */
+struct chip8_diff_result {
+    int diverged;                    /* the engine disagreed with the reference */
+    int exact;                       /* the divergence was narrowed to a single instruction */
+    enum chip8_fault fault;          /* fault the reference stopped in front of, if any */
+    unsigned fields;                 /* chip8_diff_field bits that differed */
+    uint64_t cycles;                 /* cycles the reference ran */
+    uint64_t agreed;                 /* cycle count of the last state both agreed on */
+    struct chip8_diff_state reference; /* states at the divergence, or at the end */
+    struct chip8_diff_state engine;
+    struct chip8_diff_step trace[CHIP8_DIFF_TRACE]; /* the reference's last instructions, oldest first */
+    size_t trace_count;
+};
+
+/**
+ * Runs every job on two machines in lockstep: one stepped through the
+ * reference chip8_execute() switch, the other run through the engine, both
+ * with the same program, seed, input script, quirk profile and ipf. Their
+ * states are compared every interval cycles. At the first disagreement both
+ * machines go back to the last state they agreed on and step one instruction
+ * at a time, so the result names the first instruction after which they
+ * differ.
+ *
+ * A job also stops in front of any instruction chip8_fault_check() finds
+ * undefined (stack, memory, key or program counter faults), as the engines
+ * are free to disagree past one. Jobs are spread over the worker threads.
+ *
+ * @param {const struct chip8_diff*} d The settings of the run
+ * @param {const struct chip8_batch_job*} jobs The programs, seeds and scripts to run
+ * @param {size_t} count The number of jobs
+ * @param {struct chip8_diff_result*} results Receives one result per job
+ * @return {int} The outcome of the execution
+ */
+int chip8_diff_run(const struct chip8_diff *d, const struct chip8_batch_job *jobs, size_t count,
+                   struct chip8_diff_result *results);
+
+/**
+ * Gets the name of a compared field
+ * @param {enum chip8_diff_field} f The field, a single bit
+ * @return {const char *} The name
+ */
+const char* chip8_diff_field_name(enum chip8_diff_field f);
+
+#endif /* __chip8_diff_h_ */
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <time.h>
+#include "machine.h"
+#include "script.h"
+#include "inputlog.h"
+#include "runner.h"
+#include "romstore.h"
+#include "decode.h"
+#include "diff.h"
+
+/**
+ * A script or input log every job of a rom and seed runs with
+ */
+struct diff_input {
+    const char *path;
+    struct chip8_script *script;
+    int logged;                      /* read from an input log, which also fixes the seed */
+    uint32_t seed;
+    enum chip8_quirks quirks;        /* the log's quirk profile */
+    uint16_t ipf;                    /* the log's instructions per tick */
+};
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-k interval] [-n seeds] [-s seed] [-t threads] [-e engine] [-q quirks] [-f ipf] roms [input...]\n", name);
+    fprintf(stderr, "  -c cycles   cycle budget of each job (default 1000000)\n");
+    fprintf(stderr, "  -k interval cycles between state comparisons (default 1000)\n");
+    fprintf(stderr, "  -n seeds    jobs per rom and input, each with the next seed (default 1)\n");
+    fprintf(stderr, "  -s seed     seed of the first job (default 1)\n");
+    fprintf(stderr, "  -t threads  worker threads (default: one per processor)\n");
+    fprintf(stderr, "  -e engine   table, threaded, jit, lanes or all (default all)\n");
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+    fprintf(stderr, "  -f ipf      instructions per 60 Hz timer tick (default %d)\n", CHIP8_DEFAULT_IPF);
+    fprintf(stderr, "roms is a rom, a directory of roms or a pack. Each input is an input script or a\n");
+    fprintf(stderr, "binary input log, and runs against every rom; a log brings its own seed, and its\n");
+    fprintf(stderr, "quirks and ipf unless -q or -f is given. Every engine is run against the\n");
+    fprintf(stderr, "chip8_execute() switch. Exits 1 on any divergence.\n");
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Turns the key transitions of an input log into a script, one event for
+ * every key whose state changes at a cycle
+ * @return {struct chip8_script*} The script, NULL on failure
+ */
+static struct chip8_script* log_to_script(struct chip8_input_log *l) {
+    struct chip8_script *s = calloc(1, sizeof(struct chip8_script));
+    struct chip8_machine *m = calloc(1, sizeof(struct chip8_machine));
+    size_t capacity = 0;
+
+    if (s == NULL || m == NULL) {
+        free(m);
+        free(s);
+        return NULL;
+    }
+
+    for (uint64_t next = chip8_input_log_apply(l, m); ; next = chip8_input_log_apply(l, m)) {
+        for (int k = 0; k < 16; k++) {
+            if (m->key[k] == m->v[k]) {
+                continue;
+            }
+
+            if (s->count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                struct chip8_script_event *events = realloc(s->events, capacity * sizeof(struct chip8_script_event));
+
+                if (events == NULL) {
+                    free(m);
+                    chip8_script_destroy(&s);
+                    return NULL;
+                }
+
+                s->events = events;
+            }
+
+            s->events[s->count].cycle = m->cycles;
+            s->events[s->count].key = k;
+            s->events[s->count].down = m->key[k];
+            s->count++;
+
+            // v[] of the scratch machine holds the key states seen so far
+            m->v[k] = m->key[k];
+        }
+
+        if (next == UINT64_MAX) {
+            break;
+        }
+
+        m->cycles = next;
+    }
+
+    free(m);
+    return s;
+}
+
+static int load_input(struct diff_input *in, const char *path) {
+    struct chip8_input_log *l = chip8_input_log_open(path);
+
+    in->path = path;
+
+    if (l != NULL) {
+        in->logged = 1;
+        in->seed = chip8_input_log_seed(l);
+        in->quirks = chip8_input_log_quirks(l);
+        in->ipf = chip8_input_log_ipf(l);
+        in->script = log_to_script(l);
+        chip8_input_log_close(&l);
+    } else {
+        in->script = chip8_script_load(path);
+    }
+
+    return in->script ? 0 : -1;
+}
+
+static void print_state(const char *label, const struct chip8_diff_state *st) {
+    printf("  %-9s pc %04X i %04X sp %02X dt %02X st %02X status %d cycles %" PRIu64 " rng %08" PRIX32 "\n",
+           label, st->pc, st->i, st->sp, st->delay_timer, st->sound_timer, st->status, st->cycles, st->rng);
+    printf("  %-9s v", "");
+    for (int v = 0; v < 16; v++) {
+        printf(" %02X", st->v[v]);
+    }
+    printf("  memory %016" PRIx64 " display %016" PRIx64 "\n", st->memory_hash, st->display_hash);
+}
+
+static void print_divergence(enum chip8_engine engine, const struct chip8_batch_job *job, const char *input,
+                             const struct chip8_diff_result *r) {
+    printf("%s diverged on %s, seed %" PRIu32 "%s%s: ", chip8_engine_name(engine), job->rom->name, job->seed,
+           input ? ", input " : "", input ? input : "");
+
+    if (r->exact) {
+        printf("after the instruction at cycle %" PRIu64 "\n", r->cycles);
+    } else {
+        printf("between cycles %" PRIu64 " and %" PRIu64 "\n", r->agreed, r->cycles);
+    }
+
+    printf("  differs  ");
+    for (unsigned f = 1; f <= CHIP8_DIFF_RNG; f <<= 1) {
+        if (r->fields & f) {
+            printf(" %s", chip8_diff_field_name(f));
+        }
+    }
+    printf("\n");
+
+    print_state("reference", &r->reference);
+    print_state(chip8_engine_name(engine), &r->engine);
+
+    for (size_t k = 0; k < r->trace_count; k++) {
+        const struct chip8_diff_step *step = &r->trace[k];
+        printf("  %12" PRIu64 "  %03X  %04X  %s\n", step->cycle, step->pc, step->opcode,
+               chip8_op_name(chip8_decode(step->opcode)));
+    }
+}
+
+int main(int argc, char *argv[]) {
+    struct chip8_diff d = { NULL, 0, 1000000, 1000, CHIP8_ENGINE_JIT, CHIP8_QUIRKS_MODERN, CHIP8_DEFAULT_IPF, 0 };
+    size_t seeds = 1;
+    uint32_t seed = 1;
+    int engine = -1;
+    int quirks = -1;
+    uint16_t ipf = 0;
+    int a = 1;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (a + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(argv[a], "-c") == 0) {
+            d.max_cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-k") == 0) {
+            d.interval = strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-n") == 0) {
+            seeds = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-s") == 0) {
+            seed = strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-t") == 0) {
+            d.threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-e") == 0) {
+            if (strcmp(argv[++a], "all") != 0 && ((engine = chip8_engine_parse(argv[a])) < 0 || engine == CHIP8_ENGINE_SWITCH)) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-q") == 0) {
+            if ((quirks = chip8_quirks_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-f") == 0) {
+            if ((ipf = (uint16_t)strtoul(argv[++a], NULL, 0)) == 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (a >= argc || seeds == 0 || d.interval == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const char *rom_path = argv[a++];
+    struct chip8_romstore *store = chip8_romstore_open(rom_path);
+    if (store == NULL) {
+        fprintf(stderr, "unable to load %s\n", rom_path);
+        return 1;
+    }
+
+    size_t roms = chip8_romstore_count(store);
+    size_t inputs = argc - a;
+    size_t groups = inputs ? inputs : 1;
+    size_t per_input = roms * seeds;
+    size_t count = groups * per_input;
+
+    struct diff_input *in = calloc(inputs ? inputs : 1, sizeof(struct diff_input));
+    struct chip8_batch_job *jobs = calloc(count, sizeof(struct chip8_batch_job));
+    struct chip8_diff_result *results = calloc(count, sizeof(struct chip8_diff_result));
+    size_t diverged = 0;
+    int rc = 0;
+
+    if (in == NULL || jobs == NULL || results == NULL) {
+        fprintf(stderr, "out of memory\n");
+        rc = 1;
+        goto done;
+    }
+
+    for (size_t k = 0; k < inputs; k++) {
+        if (load_input(&in[k], argv[a + k]) < 0) {
+            fprintf(stderr, "unable to load input %s\n", argv[a + k]);
+            rc = 1;
+            goto done;
+        }
+    }
+
+    // the jobs of one input run together, under the quirks and ipf it brings
+    for (size_t k = 0; k < count; k++) {
+        const struct diff_input *input = inputs ? &in[k / per_input] : NULL;
+        uint32_t n = (uint32_t)(k % seeds);
+
+        jobs[k].rom = chip8_romstore_get(store, k % per_input / seeds);
+        jobs[k].script = input ? input->script : NULL;
+        jobs[k].seed = input && input->logged ? input->seed + n : seed + n;
+    }
+
+    for (int e = CHIP8_ENGINE_SWITCH + 1; e < CHIP8_ENGINE_COUNT; e++) {
+        if (engine >= 0 && e != engine) {
+            continue;
+        }
+
+        d.engine = e;
+
+        double start = now_seconds();
+        for (size_t g = 0; g < groups; g++) {
+            const struct diff_input *input = inputs ? &in[g] : NULL;
+
+            d.quirks = input && input->logged ? input->quirks : CHIP8_QUIRKS_MODERN;
+            d.ipf = input && input->logged ? input->ipf : CHIP8_DEFAULT_IPF;
+
+            if (quirks >= 0) {
+                d.quirks = quirks;
+            }
+
+            if (ipf) {
+                d.ipf = ipf;
+            }
+
+            if (chip8_diff_run(&d, jobs + g * per_input, per_input, results + g * per_input) < 0) {
+                fprintf(stderr, "unable to run %s\n", chip8_engine_name(e));
+                rc = 1;
+                goto done;
+            }
+        }
+        double elapsed = now_seconds() - start;
+
+        uint64_t total = 0;
+        size_t faulted = 0, failed = 0;
+
+        for (size_t k = 0; k < count; k++) {
+            const struct chip8_diff_result *r = &results[k];
+
+            total += r->cycles;
+            faulted += r->fault != CHIP8_FAULT_NONE;
+            failed += r->reference.status < 0;
+
+            if (r->diverged) {
+                diverged++;
+                print_divergence(e, &jobs[k], inputs ? in[k / per_input].path : NULL, r);
+            }
+        }
+
+        fprintf(stderr, "%-8s %zu jobs of %zu roms, %" PRIu64 " cycles in %.3fs (%.1f MIPS), %zu stopped at a fault, "
+                "%zu halted on an error\n", chip8_engine_name(e), count, roms, total, elapsed,
+                elapsed > 0 ? total / elapsed / 1e6 : 0.0, faulted, failed);
+    }
+
+    if (diverged > 0) {
+        fprintf(stderr, "%zu divergences\n", diverged);
+        rc = 1;
+    }
+
+done:
+    if (in) {
+        for (size_t k = 0; k < inputs; k++) {
+            chip8_script_destroy(&in[k].script);
+        }
+    }
+
+    free(in);
+    free(jobs);
+    free(results);
+    chip8_romstore_close(&store);
+
+    return rc;
+}
@@ -0,0 +1,54 @@
+#ifndef __chip8_dispatch_h_
+
+#define __chip8_dispatch_h_
+
+#include "machine.h"
+
+/* returned by the run loops when the program jumped onto itself */
+#define CHIP8_RUN_LOOP  1
+
+/**
+ * Executes the given opcode through the precomputed decode and handler tables
+ * @param {struct chip8_machine*} m The machine to execute the opcode on
+ * @param {uint16_t} opcode The opcode to execute
+ * @return {int} The outcome of the execution
+ */
+int chip8_execute_table(struct chip8_machine *m, uint16_t opcode);
+
+/**
+ * Executes the given opcode through computed-goto dispatch, where supported
+ * @param {struct chip8_machine*} m The machine to execute the opcode on
+ * @param {uint16_t} opcode The opcode to execute
+ * @return {int} The outcome of the execution
+ */
+int chip8_execute_threaded(struct chip8_machine *m, uint16_t opcode);
+
+/**
+ * Runs up to count cycles through the reference chip8_execute() switch
+ *
+ * All run loops stop after a failing opcode (returning its outcome) or after
+ * executing a jump onto itself (returning CHIP8_RUN_LOOP).
+ *
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run_switch(struct chip8_machine *m, uint64_t count);
+
+/**
+ * Runs up to count cycles through the decode and handler tables
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run_table(struct chip8_machine *m, uint64_t count);
+
+/**
+ * Runs up to count cycles as threaded code, each handler dispatching the next
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run_threaded(struct chip8_machine *m, uint64_t count);
+
+#endif /* __chip8_dispatch_h_ */
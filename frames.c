@@ -0,0 +1,30 @@
+#include "frames.h"
+
+void chip8_frames_init(struct chip8_frames *f) {
+    memset(f->buffers, 0, sizeof(f->buffers));
+    f->back = 0;
+    f->front = 1;
+    atomic_init(&f->middle, 2);
+}
+
+void chip8_frames_publish(struct chip8_frames *f, const struct chip8_machine *m) {
+    struct chip8_frame *frame = &f->buffers[f->back];
+
+    memcpy(frame->display, m->display, sizeof(frame->display));
+    frame->cycles = m->cycles;
+
+    // release the frame contents along with the index
+    uint8_t prev = atomic_exchange_explicit(&f->middle, f->back | CHIP8_FRAME_FRESH, memory_order_acq_rel);
+    f->back = prev & 0x3;
+}
+
+const struct chip8_frame* chip8_frames_acquire(struct chip8_frames *f) {
+    if (!(atomic_load_explicit(&f->middle, memory_order_relaxed) & CHIP8_FRAME_FRESH)) {
+        return NULL;
+    }
+
+    uint8_t prev = atomic_exchange_explicit(&f->middle, f->front, memory_order_acq_rel);
+    f->front = prev & 0x3;
+
+    return &f->buffers[f->front];
+}
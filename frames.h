@@ -0,0 +1,55 @@
+#ifndef __chip8_frames_h_
+
+#define __chip8_frames_h_
+
+#include <stdatomic.h>
+#include "machine.h"
+
+/**
+ * A finished frame, as handed from the emulation thread to the renderer
+ */
+struct chip8_frame {
+    uint64_t display[VIDEO_HEIGHT];  /* display rows, packed as in the machine */
+    uint64_t cycles;                 /* machine cycle count when the frame was published */
+};
+
+/**
+ * Lock-free triple buffer of frames between one producer and one consumer
+ *
+ * The producer always owns a back buffer and the consumer a front buffer; the
+ * third sits in the middle. Publishing swaps the back buffer into the middle
+ * and acquiring swaps the middle out to the front, each with one atomic
+ * exchange, so neither side ever waits for the other. Frames the consumer
+ * does not pick up in time are replaced by newer ones.
+ */
+struct chip8_frames {
+    struct chip8_frame buffers[3];
+    _Atomic uint8_t middle;          /* index of the middle buffer, plus CHIP8_FRAME_FRESH */
+    uint8_t back;                    /* owned by the producer */
+    uint8_t front;                   /* owned by the consumer */
+};
+
+/* set on the middle index while it holds a frame the consumer has not seen */
+#define CHIP8_FRAME_FRESH   0x4
+
+/**
+ * Initialises an empty triple buffer
+ * @param {struct chip8_frames*} f The buffer to initialise
+ */
+void chip8_frames_init(struct chip8_frames *f);
+
+/**
+ * Copies the machine's display into the back frame and publishes it
+ * @param {struct chip8_frames*} f The buffer to publish to
+ * @param {const struct chip8_machine*} m The machine to take the frame from
+ */
+void chip8_frames_publish(struct chip8_frames *f, const struct chip8_machine *m);
+
+/**
+ * Takes the newest published frame, if there is one the consumer has not seen
+ * @param {struct chip8_frames*} f The buffer to read from
+ * @return {const struct chip8_frame*} The new frame, NULL when nothing changed
+ */
+const struct chip8_frame* chip8_frames_acquire(struct chip8_frames *f);
+
+#endif /* __chip8_frames_h_ */
@@ -0,0 +1,498 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include "fuzz.h"
+#include "machine_ops.h"
+#include "batch.h"
+#include "pool.h"
+#include "scheduler.h"
+
+/* edges are hashed into a map of this many bits */
+#define FUZZ_MAP_SIZE       0x10000
+#define FUZZ_MAP_WORDS      (FUZZ_MAP_SIZE / 64)
+
+/* cases a worker runs between folding its counts into the shared ones */
+#define FUZZ_SYNC           256
+
+/* longest a key stays down when a mutation presses one */
+#define FUZZ_HOLD_CYCLES    3000
+
+static const char *fault_names[CHIP8_FAULT_COUNT] = {
+    [CHIP8_FAULT_NONE]            = "none",
+    [CHIP8_FAULT_STACK_OVERFLOW]  = "stack_overflow",
+    [CHIP8_FAULT_STACK_UNDERFLOW] = "stack_underflow",
+    [CHIP8_FAULT_MEMORY]          = "memory",
+    [CHIP8_FAULT_KEY]             = "key",
+    [CHIP8_FAULT_PC]              = "pc",
+    [CHIP8_FAULT_UNKNOWN]         = "unknown_opcode",
+    [CHIP8_FAULT_SYS]             = "sys",
+};
+
+/**
+ * A case of the corpus
+ */
+struct fuzz_case {
+    struct chip8_script_event events[CHIP8_FUZZ_EVENTS]; /* ordered by cycle */
+    size_t event_count;
+    struct chip8_fuzz_patch patches[CHIP8_FUZZ_PATCHES];
+    size_t patch_count;
+    uint32_t seed;
+};
+
+struct fuzz_context {
+    const struct chip8_fuzz *fuzz;
+    pthread_mutex_t lock;            /* guards everything up to the atomics */
+    uint64_t coverage[FUZZ_MAP_WORDS]; /* every edge any case has taken */
+    struct fuzz_case *corpus;
+    size_t corpus_count;
+    size_t corpus_capacity;
+    uint8_t seen[CHIP8_FAULT_COUNT][0x10000 / 8]; /* faults reported, by kind and address */
+    struct chip8_fuzz_stats stats;
+
+    atomic_uint_fast64_t executions; /* cases started; counts against the budget */
+    atomic_int stop;
+    atomic_int running;              /* workers yet to finish */
+};
+
+struct fuzz_worker {
+    struct fuzz_context *ctx;
+    struct chip8_pool *pool;         /* holds the one machine the worker runs */
+    uint64_t rng;                    /* xorshift64 state of the mutations */
+    uint64_t coverage[FUZZ_MAP_WORDS]; /* the worker's copy of the shared coverage */
+    uint64_t trace[FUZZ_MAP_WORDS];  /* edges the current case took */
+    uint64_t instructions;           /* not yet folded into the shared counts */
+    uint64_t faults[CHIP8_FAULT_COUNT];
+    uint8_t image[CHIP8_PROGRAM_MAX];
+    pthread_t thread;
+};
+
+enum chip8_fault chip8_fault_check(const struct chip8_machine *m) {
+    if ((size_t)m->pc + 1 >= sizeof(m->memory)) {
+        return CHIP8_FAULT_PC;
+    }
+
+    uint16_t opcode = m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+    unsigned end;
+
+    switch (chip8_decode_table()[opcode]) {
+        case CHIP8_OP_UNKNOWN:
+            return CHIP8_FAULT_UNKNOWN;
+        case CHIP8_OP_SYS:
+            return CHIP8_FAULT_SYS;
+        case CHIP8_OP_CALL:
+            // the stack grows from stack[1]; stack[0] is never written
+            return (size_t)m->sp + 1 >= sizeof(m->stack) / sizeof(m->stack[0]) ? CHIP8_FAULT_STACK_OVERFLOW : CHIP8_FAULT_NONE;
+        case CHIP8_OP_RET:
+            return m->sp == 0 ? CHIP8_FAULT_STACK_UNDERFLOW : CHIP8_FAULT_NONE;
+        case CHIP8_OP_SKP:
+        case CHIP8_OP_SKNP:
+            return m->v[OP_X(opcode)] >= sizeof(m->key) ? CHIP8_FAULT_KEY : CHIP8_FAULT_NONE;
+        case CHIP8_OP_DRW:
+            end = m->i + OP_N(opcode);
+            break;
+        case CHIP8_OP_LD_B:
+            end = m->i + 3;
+            break;
+        case CHIP8_OP_LD_MEM_VX:
+        case CHIP8_OP_LD_VX_MEM:
+            end = m->i + OP_X(opcode) + 1;
+            break;
+        default:
+            return CHIP8_FAULT_NONE;
+    }
+
+    return end > sizeof(m->memory) ? CHIP8_FAULT_MEMORY : CHIP8_FAULT_NONE;
+}
+
+const char* chip8_fault_name(enum chip8_fault f) {
+    return f < CHIP8_FAULT_COUNT ? fault_names[f] : "unknown";
+}
+
+static uint64_t fuzz_random(struct fuzz_worker *w) {
+    w->rng ^= w->rng << 13;
+    w->rng ^= w->rng >> 7;
+    w->rng ^= w->rng << 17;
+    return w->rng;
+}
+
+static uint32_t fuzz_below(struct fuzz_worker *w, uint64_t bound) {
+    return (uint32_t)(fuzz_random(w) % bound);
+}
+
+/**
+ * Inserts a key transition, keeping the events in cycle order
+ */
+static void fuzz_insert(struct fuzz_case *c, uint64_t cycle, uint8_t key, uint8_t down) {
+    size_t k = c->event_count++;
+
+    for (; k > 0 && c->events[k - 1].cycle > cycle; k--) {
+        c->events[k] = c->events[k - 1];
+    }
+
+    c->events[k].cycle = cycle;
+    c->events[k].key = key;
+    c->events[k].down = down;
+}
+
+static void fuzz_remove(struct fuzz_case *c, size_t k) {
+    memmove(&c->events[k], &c->events[k + 1], (c->event_count - k - 1) * sizeof(struct chip8_script_event));
+    c->event_count--;
+}
+
+/**
+ * Applies a few random mutations to a case
+ */
+static void fuzz_mutate(struct fuzz_worker *w, struct fuzz_case *c) {
+    const struct chip8_fuzz *f = w->ctx->fuzz;
+    int rounds = 1 + fuzz_below(w, 4);
+
+    for (int r = 0; r < rounds; r++) {
+        size_t e = c->event_count ? fuzz_below(w, c->event_count) : 0;
+
+        switch (fuzz_below(w, f->mutate_rom ? 8 : 6)) {
+            case 0:
+                // a press and its release
+                if (c->event_count + 2 <= CHIP8_FUZZ_EVENTS) {
+                    uint64_t cycle = fuzz_below(w, f->max_cycles);
+                    uint8_t key = fuzz_below(w, 16);
+
+                    fuzz_insert(c, cycle, key, 1);
+                    fuzz_insert(c, cycle + 1 + fuzz_below(w, FUZZ_HOLD_CYCLES), key, 0);
+                }
+                break;
+            case 1:
+                if (c->event_count > 0) {
+                    fuzz_remove(c, e);
+                }
+                break;
+            case 2:
+                if (c->event_count > 0) {
+                    struct chip8_script_event moved = c->events[e];
+                    int64_t cycle = (int64_t)moved.cycle + (int64_t)fuzz_below(w, 2 * FUZZ_HOLD_CYCLES) - FUZZ_HOLD_CYCLES;
+
+                    fuzz_remove(c, e);
+                    fuzz_insert(c, cycle > 0 ? (uint64_t)cycle : 0, moved.key, moved.down);
+                }
+                break;
+            case 3:
+                if (c->event_count > 0) {
+                    c->events[e].down ^= 1;
+                }
+                break;
+            case 4:
+                if (c->event_count > 0) {
+                    c->events[e].key = fuzz_below(w, 16);
+                }
+                break;
+            case 5:
+                c->seed = (uint32_t)fuzz_random(w);
+                break;
+            case 6:
+                if (c->patch_count < CHIP8_FUZZ_PATCHES) {
+                    struct chip8_fuzz_patch *p = &c->patches[c->patch_count++];
+                    uint16_t offset = fuzz_below(w, f->rom_size);
+
+                    // half of the patches flip a bit, the rest write a random byte
+                    p->addr = CHIP8_PROGRAM_START + offset;
+                    p->value = fuzz_below(w, 2) ? f->rom[offset] ^ (1u << fuzz_below(w, 8)) : fuzz_below(w, 256);
+                }
+                break;
+            case 7:
+                if (c->patch_count > 0) {
+                    size_t k = fuzz_below(w, c->patch_count);
+                    c->patches[k] = c->patches[--c->patch_count];
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * Runs a case until its cycle budget runs out, it stops on a jump onto itself
+ * or it runs into a fault, tracing the edges it takes
+ * @return {enum chip8_fault} The fault the case ran into
+ */
+static enum chip8_fault fuzz_execute(struct fuzz_worker *w, const struct fuzz_case *c, struct chip8_fuzz_finding *out) {
+    const struct chip8_fuzz *f = w->ctx->fuzz;
+    struct chip8_machine *m = chip8_pool_acquire(w->pool);
+    enum chip8_fault fault = CHIP8_FAULT_NONE;
+
+    if (m == NULL) {
+        return CHIP8_FAULT_NONE;
+    }
+
+    memcpy(w->image, f->rom, f->rom_size);
+    for (size_t p = 0; p < c->patch_count; p++) {
+        w->image[c->patches[p].addr - CHIP8_PROGRAM_START] = c->patches[p].value;
+    }
+
+    chip8_load_memory(m, w->image, f->rom_size);
+    chip8_seed(m, c->seed);
+    memset(w->trace, 0, sizeof(w->trace));
+
+    struct chip8_script script = { (struct chip8_script_event*)c->events, c->event_count };
+    size_t cursor = 0;
+    uint16_t prev = 0;
+
+    while (m->cycles < f->max_cycles) {
+        if (cursor < script.count && script.events[cursor].cycle <= m->cycles) {
+            cursor = chip8_script_apply(&script, cursor, m);
+        }
+
+        if ((fault = chip8_fault_check(m)) != CHIP8_FAULT_NONE) {
+            break;
+        }
+
+        uint32_t edge = ((prev * 0x9E3779B1u) ^ m->pc) * 0x85EBCA6Bu >> 16;
+        w->trace[edge >> 6] |= 1ull << (edge & 63);
+        prev = m->pc;
+
+        if (chip8_at_self_jump(m)) {
+            break;
+        }
+
+        // a backstop; the check above rejects what chip8_execute() would
+        int rc = chip8_step(m);
+        if (rc < 0) {
+            fault = rc == -2 ? CHIP8_FAULT_SYS : CHIP8_FAULT_UNKNOWN;
+            break;
+        }
+    }
+
+    if (fault != CHIP8_FAULT_NONE) {
+        out->fault = fault;
+        out->pc = m->pc;
+        out->opcode = fault == CHIP8_FAULT_PC ? 0 : m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+        out->cycle = m->cycles;
+    }
+
+    w->instructions += m->cycles;
+    chip8_pool_release(w->pool, m);
+
+    return fault;
+}
+
+/**
+ * Keeps a case that took edges no case took before it
+ */
+static void fuzz_keep(struct fuzz_worker *w, const struct fuzz_case *c) {
+    struct fuzz_context *ctx = w->ctx;
+    size_t edges = 0;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    for (int k = 0; k < FUZZ_MAP_WORDS; k++) {
+        uint64_t fresh = w->trace[k] & ~ctx->coverage[k];
+
+        edges += __builtin_popcountll(fresh);
+        ctx->coverage[k] |= fresh;
+    }
+
+    // another worker may have got there first
+    if (edges > 0 && ctx->corpus_count == ctx->corpus_capacity) {
+        size_t grown = ctx->corpus_capacity * 2;
+        struct fuzz_case *corpus = realloc(ctx->corpus, grown * sizeof(struct fuzz_case));
+
+        if (corpus != NULL) {
+            ctx->corpus = corpus;
+            ctx->corpus_capacity = grown;
+        }
+    }
+
+    if (edges > 0 && ctx->corpus_count < ctx->corpus_capacity) {
+        ctx->corpus[ctx->corpus_count++] = *c;
+    }
+
+    ctx->stats.edges += edges;
+    memcpy(w->coverage, ctx->coverage, sizeof(w->coverage));
+
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+/**
+ * Reports a fault unless it was already found at the same address
+ */
+static void fuzz_report(struct fuzz_worker *w, const struct fuzz_case *c, struct chip8_fuzz_finding *found) {
+    struct fuzz_context *ctx = w->ctx;
+    uint8_t *seen = &ctx->seen[found->fault][found->pc >> 3];
+    uint8_t bit = 1u << (found->pc & 7);
+
+    w->faults[found->fault]++;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    if (!(*seen & bit)) {
+        struct chip8_script script = { (struct chip8_script_event*)c->events, c->event_count };
+
+        *seen |= bit;
+        ctx->stats.findings++;
+
+        found->seed = c->seed;
+        found->script = &script;
+        found->patches = c->patches;
+        found->patch_count = c->patch_count;
+
+        if (ctx->fuzz->found != NULL) {
+            ctx->fuzz->found(ctx->fuzz->ctx, found);
+        }
+    }
+
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+/**
+ * Folds a worker's counts into the shared ones and refreshes its coverage
+ */
+static void fuzz_sync(struct fuzz_worker *w) {
+    struct fuzz_context *ctx = w->ctx;
+
+    pthread_mutex_lock(&ctx->lock);
+
+    ctx->stats.instructions += w->instructions;
+    for (int k = 0; k < CHIP8_FAULT_COUNT; k++) {
+        ctx->stats.faults[k] += w->faults[k];
+    }
+    memcpy(w->coverage, ctx->coverage, sizeof(w->coverage));
+
+    pthread_mutex_unlock(&ctx->lock);
+
+    w->instructions = 0;
+    memset(w->faults, 0, sizeof(w->faults));
+}
+
+static void* fuzz_worker_main(void *arg) {
+    struct fuzz_worker *w = arg;
+    struct fuzz_context *ctx = w->ctx;
+    uint64_t limit = ctx->fuzz->max_executions;
+    struct fuzz_case c;
+
+    for (uint64_t n = 1; !atomic_load(&ctx->stop); n++) {
+        if (atomic_fetch_add(&ctx->executions, 1) >= limit && limit) {
+            break;
+        }
+
+        pthread_mutex_lock(&ctx->lock);
+        c = ctx->corpus[fuzz_below(w, ctx->corpus_count)];
+        pthread_mutex_unlock(&ctx->lock);
+
+        fuzz_mutate(w, &c);
+
+        struct chip8_fuzz_finding found;
+        if (fuzz_execute(w, &c, &found) != CHIP8_FAULT_NONE) {
+            fuzz_report(w, &c, &found);
+        }
+
+        for (int k = 0; k < FUZZ_MAP_WORDS; k++) {
+            if (w->trace[k] & ~w->coverage[k]) {
+                fuzz_keep(w, &c);
+                break;
+            }
+        }
+
+        if (n % FUZZ_SYNC == 0) {
+            fuzz_sync(w);
+        }
+    }
+
+    fuzz_sync(w);
+    atomic_fetch_sub(&ctx->running, 1);
+
+    return NULL;
+}
+
+/**
+ * Copies the shared progress out
+ */
+static void fuzz_stats(struct fuzz_context *ctx, uint64_t start, struct chip8_fuzz_stats *st) {
+    uint64_t limit = ctx->fuzz->max_executions;
+    uint64_t executions = atomic_load(&ctx->executions);
+
+    pthread_mutex_lock(&ctx->lock);
+    *st = ctx->stats;
+    st->corpus = ctx->corpus_count;
+    pthread_mutex_unlock(&ctx->lock);
+
+    // every worker overshoots the budget by one when it runs out
+    st->executions = limit && executions > limit ? limit : executions;
+    st->seconds = (chip8_now() - start) / 1e9;
+}
+
+int chip8_fuzz_run(const struct chip8_fuzz *f, struct chip8_fuzz_stats *st) {
+    if (f == NULL || f->rom == NULL || f->rom_size == 0 || f->rom_size > CHIP8_PROGRAM_MAX || f->max_cycles == 0) {
+        return -1;
+    }
+
+    struct fuzz_context *ctx = calloc(1, sizeof(struct fuzz_context));
+    int count = f->threads > 0 ? f->threads : chip8_host_threads();
+    struct fuzz_worker *workers = calloc(count, sizeof(struct fuzz_worker));
+
+    if (ctx == NULL || workers == NULL || (ctx->corpus = calloc(16, sizeof(struct fuzz_case))) == NULL) {
+        free(workers);
+        free(ctx);
+        return -1;
+    }
+
+    // the corpus starts from the program with no input at all
+    ctx->fuzz = f;
+    ctx->corpus_capacity = 16;
+    ctx->corpus[ctx->corpus_count++].seed = f->seed;
+    pthread_mutex_init(&ctx->lock, NULL);
+
+    uint64_t start = chip8_now();
+    uint64_t reported = start;
+    int started = 0;
+
+    for (int t = 0; t < count; t++) {
+        struct fuzz_worker *w = &workers[t];
+
+        w->ctx = ctx;
+        w->rng = ((uint64_t)f->seed << 32 | (uint32_t)t) * 0x9E3779B97F4A7C15ull + 1;
+
+        if ((w->pool = chip8_pool_create(1, NULL)) == NULL) {
+            break;
+        }
+
+        atomic_fetch_add(&ctx->running, 1);
+        if (pthread_create(&w->thread, NULL, fuzz_worker_main, w) != 0) {
+            atomic_fetch_sub(&ctx->running, 1);
+            chip8_pool_destroy(&w->pool);
+            break;
+        }
+
+        started++;
+    }
+
+    // the calling thread keeps time and reports progress
+    while (atomic_load(&ctx->running) > 0) {
+        uint64_t now = chip8_now();
+
+        if (f->seconds > 0 && now - start >= f->seconds * 1e9) {
+            atomic_store(&ctx->stop, 1);
+        }
+
+        if (f->progress != NULL && now - reported >= 1000000000ull) {
+            struct chip8_fuzz_stats progress;
+
+            fuzz_stats(ctx, start, &progress);
+            f->progress(f->ctx, &progress);
+            reported = now;
+        }
+
+        chip8_sleep(10000000);
+    }
+
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t].thread, NULL);
+        chip8_pool_destroy(&workers[t].pool);
+    }
+
+    if (st != NULL) {
+        fuzz_stats(ctx, start, st);
+    }
+
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx->corpus);
+    free(ctx);
+    free(workers);
+
+    return started > 0 ? 0 : -1;
+}
@@ -0,0 +1,108 @@
+#ifndef __chip8_fuzz_h_
+
+#define __chip8_fuzz_h_
+
+#include "machine.h"
+#include "script.h"
+
+/**
+ * Faults chip8_execute() lets through unchecked, or reports only by its return
+ */
+enum chip8_fault {
+    CHIP8_FAULT_NONE = 0,
+    CHIP8_FAULT_STACK_OVERFLOW,      /* 2NNN with every level of stack[16] in use */
+    CHIP8_FAULT_STACK_UNDERFLOW,     /* 00EE with nothing on the stack */
+    CHIP8_FAULT_MEMORY,              /* FX33, FX55, FX65 or DXYN reaching past memory through I */
+    CHIP8_FAULT_KEY,                 /* EX9E or EXA1 reading key[16] with VX above 0xF */
+    CHIP8_FAULT_PC,                  /* the program counter ran off the end of memory */
+    CHIP8_FAULT_UNKNOWN,             /* an opcode chip8_execute() rejects with -1 */
+    CHIP8_FAULT_SYS,                 /* a 0NNN, which chip8_execute() refuses with -2 */
+    CHIP8_FAULT_COUNT
+};
+
+/* most key transitions and program byte patches a fuzzed case holds */
+#define CHIP8_FUZZ_EVENTS   64
+#define CHIP8_FUZZ_PATCHES  16
+
+/**
+ * A program byte replaced before a case runs
+ */
+struct chip8_fuzz_patch {
+    uint16_t addr;
+    uint8_t value;
+};
+
+/**
+ * A case that ran into a fault, with everything needed to replay it
+ */
+struct chip8_fuzz_finding {
+    enum chip8_fault fault;
+    uint16_t pc;                     /* address of the faulting instruction */
+    uint16_t opcode;                 /* the faulting instruction, 0 for CHIP8_FAULT_PC */
+    uint64_t cycle;                  /* cycle the fault was caught at */
+    uint32_t seed;                   /* random number generator seed of the case */
+    const struct chip8_script *script; /* key transitions of the case */
+    const struct chip8_fuzz_patch *patches; /* program bytes the case replaced */
+    size_t patch_count;
+};
+
+/**
+ * Progress of a fuzzing run
+ */
+struct chip8_fuzz_stats {
+    uint64_t executions;             /* cases run */
+    uint64_t instructions;           /* instructions executed over every case */
+    size_t edges;                    /* distinct control-flow edges covered */
+    size_t corpus;                   /* cases kept for reaching new edges */
+    size_t findings;                 /* distinct faults, by kind and address */
+    uint64_t faults[CHIP8_FAULT_COUNT]; /* cases that ran into each kind of fault */
+    double seconds;                  /* time spent so far */
+};
+
+/**
+ * Settings of a fuzzing run
+ */
+struct chip8_fuzz {
+    const uint8_t *rom;              /* program image every case starts from */
+    size_t rom_size;                 /* size of the program image */
+    uint64_t max_cycles;             /* cycle budget of each case */
+    uint64_t max_executions;         /* stop after this many cases, 0 for no limit */
+    double seconds;                  /* stop after this long, 0 for no limit */
+    int threads;                     /* worker threads, 0 to match the host */
+    int mutate_rom;                  /* patch program bytes as well as the input */
+    uint32_t seed;                   /* seeds the mutations and the first case */
+
+    /* called once per distinct fault, by kind and address, one call at a time */
+    void (*found)(void *ctx, const struct chip8_fuzz_finding *f);
+    /* called about once a second from the thread that started the run */
+    void (*progress)(void *ctx, const struct chip8_fuzz_stats *st);
+    void *ctx;                       /* handed to both callbacks */
+};
+
+/**
+ * Checks the instruction at the program counter for faults before it runs
+ * @param {const struct chip8_machine*} m The machine about to step
+ * @return {enum chip8_fault} The fault, CHIP8_FAULT_NONE when the instruction is safe to run
+ */
+enum chip8_fault chip8_fault_check(const struct chip8_machine *m);
+
+/**
+ * Gets the name of a kind of fault
+ * @param {enum chip8_fault} f The kind of fault
+ * @return {const char *} The name
+ */
+const char* chip8_fault_name(enum chip8_fault f);
+
+/**
+ * Fuzzes a program on every worker thread: cases of key transitions, random
+ * seeds and, optionally, program byte patches are mutated from a shared corpus
+ * of cases that reached control-flow edges nothing before them did. Every step
+ * is checked with chip8_fault_check(); a case stops at its first fault, before
+ * the faulting instruction runs.
+ * @param {const struct chip8_fuzz*} f The settings of the run
+ * @param {struct chip8_fuzz_stats*} st Receives the final progress, may be NULL
+ * @return {int} The outcome of the execution
+ */
+int chip8_fuzz_run(const struct chip8_fuzz *f, struct chip8_fuzz_stats *st);
+
+#endif /* __chip8_fuzz_h_ */
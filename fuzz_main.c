@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "machine.h"
+#include "romstore.h"
+#include "fuzz.h"
+
+struct fuzz_output {
+    const char *dir;                 /* where reproducers go, NULL for none */
+    const struct chip8_rom *rom;
+    int quiet;
+};
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-d seconds] [-n cases] [-t threads] [-s seed] [-m] [-o dir] [-q] rom\n", name);
+    fprintf(stderr, "  -c cycles   cycle budget of each case (default 100000)\n");
+    fprintf(stderr, "  -d seconds  stop after this long; 0 for no limit (default 10)\n");
+    fprintf(stderr, "  -n cases    stop after this many cases (default: no limit)\n");
+    fprintf(stderr, "  -t threads  worker threads (default: one per processor)\n");
+    fprintf(stderr, "  -s seed     seed of the mutations (default 1)\n");
+    fprintf(stderr, "  -m          patch program bytes as well as the input\n");
+    fprintf(stderr, "  -o dir      write a reproducer into dir for every distinct fault\n");
+    fprintf(stderr, "  -q          no progress reports\n");
+    fprintf(stderr, "Reproducers are input scripts for chip8_headless -i, with a patched rom next to\n");
+    fprintf(stderr, "them when the case patched any bytes. Exits 1 when any fault was found.\n");
+}
+
+/**
+ * Writes a case out as an input script, and its program when it was patched
+ * @return {int} The outcome of the execution
+ */
+static int write_reproducer(const struct fuzz_output *out, const struct chip8_fuzz_finding *f,
+                            char *script_path, char *rom_path, size_t size) {
+    const char *name = chip8_fault_name(f->fault);
+
+    snprintf(script_path, size, "%s/%s-%03X.txt", out->dir, name, f->pc);
+    snprintf(rom_path, size, "%s/%s-%03X.ch8", out->dir, name, f->pc);
+
+    FILE *s = fopen(script_path, "w");
+    if (!s) {
+        return -1;
+    }
+
+    fprintf(s, "# %s at 0x%03X, opcode %04X, cycle %" PRIu64 ", seed %" PRIu32 "\n",
+            name, f->pc, f->opcode, f->cycle, f->seed);
+    for (size_t e = 0; e < f->script->count; e++) {
+        const struct chip8_script_event *ev = &f->script->events[e];
+        fprintf(s, "%" PRIu64 " %X %s\n", ev->cycle, ev->key, ev->down ? "down" : "up");
+    }
+
+    int rc = fclose(s) == 0 ? 0 : -1;
+
+    if (rc == 0 && f->patch_count > 0) {
+        uint8_t image[CHIP8_PROGRAM_MAX];
+        FILE *r = fopen(rom_path, "wb");
+
+        memcpy(image, out->rom->data, out->rom->size);
+        for (size_t p = 0; p < f->patch_count; p++) {
+            image[f->patches[p].addr - CHIP8_PROGRAM_START] = f->patches[p].value;
+        }
+
+        rc = r && fwrite(image, out->rom->size, 1, r) == 1 ? 0 : -1;
+        if (r && fclose(r) != 0) {
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
+static void found(void *ctx, const struct chip8_fuzz_finding *f) {
+    const struct fuzz_output *out = ctx;
+    char script_path[4096], rom_path[4096];
+
+    printf("%s at 0x%03X, opcode %04X, cycle %" PRIu64 ", seed %" PRIu32 ", %zu key events, %zu patches\n",
+           chip8_fault_name(f->fault), f->pc, f->opcode, f->cycle, f->seed, f->script->count, f->patch_count);
+
+    if (out->dir == NULL) {
+        return;
+    }
+
+    if (write_reproducer(out, f, script_path, rom_path, sizeof(script_path)) < 0) {
+        fprintf(stderr, "unable to write a reproducer into %s\n", out->dir);
+        return;
+    }
+
+    printf("  chip8_headless -s %" PRIu32 " -c %" PRIu64 " -i %s %s\n",
+           f->seed, f->cycle, script_path, f->patch_count ? rom_path : out->rom->name);
+}
+
+static void progress(void *ctx, const struct chip8_fuzz_stats *st) {
+    const struct fuzz_output *out = ctx;
+
+    if (out->quiet) {
+        return;
+    }
+
+    fprintf(stderr, "%5.0fs: %" PRIu64 " cases (%.0f/s), %.1f MIPS, %zu edges, corpus %zu, %zu faults\n",
+            st->seconds, st->executions, st->executions / st->seconds, st->instructions / st->seconds / 1e6,
+            st->edges, st->corpus, st->findings);
+}
+
+int main(int argc, char *argv[]) {
+    struct chip8_fuzz f = { NULL, 0, 100000, 0, 10.0, 0, 0, 1, found, progress, NULL };
+    struct fuzz_output out = { NULL, NULL, 0 };
+    int a = 1;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (strcmp(argv[a], "-m") == 0) {
+            f.mutate_rom = 1;
+            continue;
+        }
+
+        if (strcmp(argv[a], "-q") == 0) {
+            out.quiet = 1;
+            continue;
+        }
+
+        if (a + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(argv[a], "-c") == 0) {
+            f.max_cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-d") == 0) {
+            f.seconds = strtod(argv[++a], NULL);
+        } else if (strcmp(argv[a], "-n") == 0) {
+            f.max_executions = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-t") == 0) {
+            f.threads = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-s") == 0) {
+            f.seed = strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-o") == 0) {
+            out.dir = argv[++a];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (a + 1 != argc || f.max_cycles == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_romstore *store = chip8_romstore_open(argv[a]);
+    out.rom = store ? chip8_romstore_get(store, 0) : NULL;
+
+    if (out.rom == NULL) {
+        fprintf(stderr, "unable to load %s\n", argv[a]);
+        chip8_romstore_close(&store);
+        return 1;
+    }
+
+    f.rom = out.rom->data;
+    f.rom_size = out.rom->size;
+    f.ctx = &out;
+
+    struct chip8_fuzz_stats st;
+    if (chip8_fuzz_run(&f, &st) < 0) {
+        fprintf(stderr, "unable to fuzz %s\n", argv[a]);
+        chip8_romstore_close(&store);
+        return 1;
+    }
+
+    fprintf(stderr, "%" PRIu64 " cases, %" PRIu64 " instructions in %.3fs (%.0f cases/s, %.1f MIPS)\n",
+            st.executions, st.instructions, st.seconds, st.executions / st.seconds, st.instructions / st.seconds / 1e6);
+    fprintf(stderr, "%zu edges, corpus of %zu, %zu distinct faults\n", st.edges, st.corpus, st.findings);
+
+    for (int k = CHIP8_FAULT_NONE + 1; k < CHIP8_FAULT_COUNT; k++) {
+        if (st.faults[k] > 0) {
+            fprintf(stderr, "  %-16s %" PRIu64 " cases\n", chip8_fault_name(k), st.faults[k]);
+        }
+    }
+
+    chip8_romstore_close(&store);
+
+    return st.findings > 0 ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "machine.h"
+#include "script.h"
+#include "runner.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "scheduler.h"
+#include "profile.h"
+#include "trace.h"
+
+#define REWIND_BUFFER_SIZE      (4 * 1024 * 1024)
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-i script | -p log] [-w log] [-e engine] [-q quirks] [-s seed] [-f ipf] [-x speed] [-r ticks] [-a ticks] [-P profile] [-T trace] [-d] rom\n", name);
+    fprintf(stderr, "  -c cycles   maximum number of cycles to run (default 1000000)\n");
+    fprintf(stderr, "  -i script   input script of \"<cycle> <key> <down|up>\" lines\n");
+    fprintf(stderr, "  -p log      replay a binary input log; takes the seed, quirks and ipf from the log unless -s, -q or -f is given\n");
+    fprintf(stderr, "  -w log      write the input script, seed, quirks and ipf out as a binary input log\n");
+    fprintf(stderr, "  -e engine   switch, table, threaded, jit or lanes (default %s)\n", chip8_engine_name(CHIP8_ENGINE_DEFAULT));
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+    fprintf(stderr, "  -s seed     random number generator seed (default: from the clock)\n");
+    fprintf(stderr, "  -f ipf      instructions per 60 Hz timer tick (default %d)\n", CHIP8_DEFAULT_IPF);
+    fprintf(stderr, "  -x speed    pace the run against the clock at this speed multiplier (default: uncapped)\n");
+    fprintf(stderr, "  -r ticks    record a rewind history, one state per tick, and step back this many at the end\n");
+    fprintf(stderr, "  -a ticks    run this many ticks ahead after every tick, as the frontend does, and roll back\n");
+    fprintf(stderr, "  -P profile  write an execution profile, as JSON for a .json path and CSV otherwise\n");
+    fprintf(stderr, "  -T trace    record every executed instruction into a binary trace; read it with chip8_trace\n");
+    fprintf(stderr, "  -d          dump the final display\n");
+}
+
+static void dump_display(struct chip8_machine *m) {
+    for (int y = 0; y < VIDEO_HEIGHT; y++) {
+        for (int x = 0; x < VIDEO_WIDTH; x++) {
+            putchar(chip8_display_pixel(m, x, y) ? '#' : '.');
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * Writes an input script out as a binary input log
+ * @return {int} The outcome of the execution
+ */
+static int write_log(const char *path, const struct chip8_script *s, const struct chip8_machine *m) {
+    struct chip8_input_recorder *rec = chip8_input_recorder_open(path, m);
+    int rc = rec ? 0 : -1;
+
+    for (size_t e = 0; s && rc == 0 && e < s->count; e++) {
+        rc = chip8_input_recorder_key(rec, s->events[e].cycle, s->events[e].key, s->events[e].down);
+    }
+
+    if (chip8_input_recorder_close(&rec) < 0) {
+        rc = -1;
+    }
+
+    return rc;
+}
+
+static void count_frame(void *ctx, const struct chip8_machine *m) {
+    (void)m;
+    (*(uint64_t*)ctx)++;
+}
+
+/**
+ * Runs the machine a timer tick at a time, paced against the clock unless the
+ * speed is uncapped, recording every tick into a rewind history when stepping
+ * back is asked for and running ahead after every tick when that is
+ * @return {int} The outcome of the execution
+ */
+static int run_ticks(struct chip8_machine *m, const struct chip8_script *s, uint64_t max_cycles,
+                     enum chip8_engine engine, double speed, long rewind_ticks, long ahead_ticks,
+                     struct chip8_run_result *r) {
+    struct chip8_rewind *rw = NULL;
+    struct chip8_runahead *ra = NULL;
+    uint64_t shown = 0;
+
+    // one run state for every tick keeps the compiled blocks and the script cursor
+    struct chip8_runner *rn = chip8_runner_create(engine, s);
+
+    if (rn == NULL) {
+        return -1;
+    }
+
+    if (rewind_ticks >= 0 && (rw = chip8_rewind_create(max_cycles / m->ipf + 1, REWIND_BUFFER_SIZE)) == NULL) {
+        chip8_runner_destroy(&rn);
+        return -1;
+    }
+
+    if (ahead_ticks > 0 && (ra = chip8_runahead_create(ahead_ticks)) == NULL) {
+        chip8_rewind_destroy(&rw);
+        chip8_runner_destroy(&rn);
+        return -1;
+    }
+
+    struct chip8_scheduler sched;
+    chip8_scheduler_init(&sched, speed, chip8_now());
+
+    uint64_t start = m->cycles;
+    chip8_rewind_push(rw, m);
+
+    // no tick is due yet when the loop first tests the result
+    *r = (struct chip8_run_result){ .halt = CHIP8_HALT_CYCLES };
+
+    do {
+        uint32_t due = chip8_scheduler_due(&sched, chip8_now());
+
+        if (due == 0) {
+            chip8_sleep(chip8_scheduler_wait(&sched, chip8_now()));
+            continue;
+        }
+
+        for (uint32_t t = 0; t < due; t++) {
+            uint64_t left = max_cycles - (m->cycles - start);
+            chip8_runner_run(rn, m, left < m->ipf ? left : m->ipf, r);
+            chip8_rewind_push(rw, m);
+
+            if (ra && chip8_runahead_run(ra, m, count_frame, &shown) < 0) {
+                chip8_runahead_destroy(&ra);
+                chip8_rewind_destroy(&rw);
+                chip8_runner_destroy(&rn);
+                return -1;
+            }
+
+            if (r->halt != CHIP8_HALT_CYCLES || m->cycles - start >= max_cycles) {
+                break;
+            }
+        }
+    } while (r->halt == CHIP8_HALT_CYCLES && m->cycles - start < max_cycles);
+
+    if (rw != NULL) {
+        struct chip8_rewind_stats st;
+        chip8_rewind_stats(rw, &st);
+
+        printf("rewind: %zu ticks, %zu bytes, %.0f bytes/s of emulated time\n",
+               st.frames, st.bytes, st.bytes_per_frame * CHIP8_TIMER_HZ);
+
+        while (rewind_ticks-- > 0 && chip8_rewind_step_back(rw, m) == 0) {
+        }
+    }
+
+    if (ra != NULL) {
+        printf("runahead: %" PRIu64 " frames shown, %.1f us per pass\n", shown, chip8_runahead_pass_ns(ra) / 1e3);
+    }
+
+    r->cycles = m->cycles - start;
+
+    chip8_runahead_destroy(&ra);
+    chip8_rewind_destroy(&rw);
+    chip8_runner_destroy(&rn);
+
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t max_cycles = 1000000;
+    const char *script_path = NULL;
+    const char *log_path = NULL;
+    const char *record_path = NULL;
+    const char *rom_path = NULL;
+    const char *profile_path = NULL;
+    const char *trace_path = NULL;
+    int engine = CHIP8_ENGINE_DEFAULT;
+    int quirks = -1;
+    int dump = 0;
+    long rewind_ticks = -1;
+    long ahead_ticks = 0;
+    double speed = CHIP8_SPEED_UNCAPPED;
+    uint16_t ipf = 0;
+    int seeded = 0;
+    uint32_t seed = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) {
+            max_cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-i") == 0 && a + 1 < argc) {
+            script_path = argv[++a];
+        } else if (strcmp(argv[a], "-p") == 0 && a + 1 < argc) {
+            log_path = argv[++a];
+        } else if (strcmp(argv[a], "-w") == 0 && a + 1 < argc) {
+            record_path = argv[++a];
+        } else if (strcmp(argv[a], "-e") == 0 && a + 1 < argc) {
+            if ((engine = chip8_engine_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-q") == 0 && a + 1 < argc) {
+            if ((quirks = chip8_quirks_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+            seed = strtoul(argv[++a], NULL, 0);
+            seeded = 1;
+        } else if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+            rewind_ticks = strtol(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-a") == 0 && a + 1 < argc) {
+            ahead_ticks = strtol(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+            if ((ipf = (uint16_t)strtoul(argv[++a], NULL, 0)) == 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-x") == 0 && a + 1 < argc) {
+            speed = strtod(argv[++a], NULL);
+        } else if (strcmp(argv[a], "-P") == 0 && a + 1 < argc) {
+            profile_path = argv[++a];
+        } else if (strcmp(argv[a], "-T") == 0 && a + 1 < argc) {
+            trace_path = argv[++a];
+        } else if (strcmp(argv[a], "-d") == 0) {
+            dump = 1;
+        } else if (argv[a][0] != '-' && rom_path == NULL) {
+            rom_path = argv[a];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (rom_path == NULL || (log_path && (script_path || rewind_ticks >= 0 || ahead_ticks > 0 || speed > CHIP8_SPEED_UNCAPPED))) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_machine *m = chip8_machine_create();
+    if (m == NULL || !chip8_load(m, rom_path)) {
+        fprintf(stderr, "unable to load %s\n", rom_path);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    struct chip8_input_log *l = NULL;
+    if (log_path && (l = chip8_input_log_open(log_path)) == NULL) {
+        fprintf(stderr, "unable to open input log %s\n", log_path);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    // a log brings the machine it was recorded on; the options given win
+    if (seeded) {
+        chip8_seed(m, seed);
+    } else if (l) {
+        chip8_seed(m, chip8_input_log_seed(l));
+    }
+
+    if (quirks < 0) {
+        quirks = l ? (int)chip8_input_log_quirks(l) : CHIP8_QUIRKS_MODERN;
+    }
+
+    chip8_set_quirks(m, quirks);
+    chip8_set_ipf(m, ipf ? ipf : l ? chip8_input_log_ipf(l) : CHIP8_DEFAULT_IPF);
+
+    struct chip8_script *s = NULL;
+    if (script_path && (s = chip8_script_load(script_path)) == NULL) {
+        fprintf(stderr, "unable to load script %s\n", script_path);
+        chip8_input_log_close(&l);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    if (record_path && write_log(record_path, s, m) < 0) {
+        fprintf(stderr, "unable to write input log %s\n", record_path);
+    }
+
+    struct chip8_profile *p = NULL;
+    if (profile_path && (p = chip8_profile_create()) != NULL && chip8_profile_attach(m, p) < 0) {
+        fprintf(stderr, "built without CHIP8_PROFILE; not profiling\n");
+        chip8_profile_destroy(&p);
+    }
+
+    struct chip8_trace *t = NULL;
+    if (trace_path) {
+        if ((t = chip8_trace_create(trace_path, 0)) == NULL) {
+            fprintf(stderr, "unable to write trace %s\n", trace_path);
+        } else if (chip8_trace_attach(m, t) < 0) {
+            fprintf(stderr, "built without CHIP8_TRACE; not tracing\n");
+            chip8_trace_destroy(&t);
+            remove(trace_path);
+        }
+    }
+
+    struct chip8_run_result r;
+
+    if (l) {
+        chip8_run_log(m, l, max_cycles, engine, &r);
+    } else if (rewind_ticks < 0 && ahead_ticks <= 0 && speed <= CHIP8_SPEED_UNCAPPED) {
+        chip8_run_with(m, s, max_cycles, engine, &r);
+    } else if (run_ticks(m, s, max_cycles, engine, speed, rewind_ticks, ahead_ticks, &r) < 0) {
+        fprintf(stderr, "unable to create the rewind history or run ahead\n");
+        chip8_trace_destroy(&t);
+        chip8_profile_destroy(&p);
+        chip8_script_destroy(&s);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    printf("halt: %s\n", chip8_halt_name(r.halt));
+    printf("status: %d\n", r.status);
+    printf("cycles: %" PRIu64 "\n", r.cycles);
+    chip8_print(m);
+
+    printf("v:");
+    for (int i = 0; i < 16; i++) {
+        printf(" %02X", m->v[i]);
+    }
+    printf("\n");
+
+    printf("frame: %016" PRIx64 "\n", chip8_display_hash(m));
+
+    if (dump) {
+        dump_display(m);
+    }
+
+    if (p) {
+        struct chip8_profile_rates pr;
+        chip8_profile_rates(p, &pr);
+
+        printf("profile: %.0f cycles/s, hottest 0x%03X\n", pr.cycles_per_second, pr.hottest);
+
+        if (chip8_profile_save(p, profile_path) < 0) {
+            fprintf(stderr, "unable to write profile %s\n", profile_path);
+        }
+    }
+
+    if (t) {
+        struct chip8_trace_stats ts;
+
+        if (chip8_trace_finish(t) < 0) {
+            fprintf(stderr, "unable to write trace %s\n", trace_path);
+        }
+
+        chip8_trace_stats(t, &ts);
+        printf("trace: %" PRIu64 " records, %" PRIu64 " bytes (%.2f per record), %" PRIu64 " stalls\n",
+               ts.records, ts.bytes, ts.records ? (double)ts.bytes / ts.records : 0.0, ts.stalls);
+    }
+
+    chip8_trace_destroy(&t);
+    chip8_profile_destroy(&p);
+    chip8_input_log_close(&l);
+    chip8_script_destroy(&s);
+    chip8_machine_destroy(&m);
+
+    return r.halt == CHIP8_HALT_ERROR ? 1 : 0;
+}
@@ -0,0 +1,40 @@
+#include "host.h"
+#include "scheduler.h"
+
+int chip8_host_attach(struct chip8_machine *m, const struct chip8_host *h) {
+    if (m == NULL) {
+        return -1;
+    }
+
+    m->host = h;
+    return 0;
+}
+
+int chip8_host_run(struct chip8_machine *m, uint32_t ticks, struct chip8_run_result *r) {
+    if (m == NULL || r == NULL) {
+        return -1;
+    }
+
+    const struct chip8_host *h = m->host;
+
+    if (h != NULL && h->keys != NULL) {
+        uint16_t mask = h->keys(h->ctx);
+
+        for (int k = 0; k < 16; k++) {
+            m->key[k] = (mask >> k) & 1;
+        }
+    }
+
+    chip8_scheduler_run(m, ticks, r);
+
+    if (h != NULL && h->draw != NULL && m->dirty_rows) {
+        h->draw(h->ctx, m->display, m->dirty_rows);
+        m->dirty_rows = 0;
+    }
+
+    if (h != NULL && h->sound != NULL) {
+        h->sound(h->ctx, m->sound_timer);
+    }
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef __chip8_host_h_
+
+#define __chip8_host_h_
+
+#include "machine.h"
+#include "runner.h"
+
+/**
+ * Callbacks through which an embedding host drives a machine; any of them may
+ * be NULL. Every callback gets the host's ctx as its first argument.
+ */
+struct chip8_host {
+    /* shows the display; rows has a bit set for every row changed since the last call */
+    void (*draw)(void *ctx, const uint64_t *display, uint32_t rows);
+
+    /* reports the keys held down, one bit per key */
+    uint16_t (*keys)(void *ctx);
+
+    /* reports the sound timer; the tone plays while it is above zero */
+    void (*sound)(void *ctx, uint8_t sound_timer);
+
+    /* supplies the numbers CXNN draws from in place of the machine's generator */
+    uint32_t (*random)(void *ctx);
+
+    void *ctx;
+};
+
+/**
+ * Attaches host callbacks to a machine
+ * @param {struct chip8_machine*} m The machine to attach to
+ * @param {const struct chip8_host*} h The callbacks, NULL to detach; must outlive the machine
+ * @return {int} The outcome of the execution
+ */
+int chip8_host_attach(struct chip8_machine *m, const struct chip8_host *h);
+
+/**
+ * Runs the machine for some 60 Hz timer ticks on behalf of its host: takes the
+ * keys from the host, runs the ticks and hands the host any changed display
+ * rows and the sound timer
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint32_t} ticks The number of timer ticks to run
+ * @param {struct chip8_run_result*} r Receives why and after how many cycles the run stopped
+ * @return {int} The outcome of the execution
+ */
+int chip8_host_run(struct chip8_machine *m, uint32_t ticks, struct chip8_run_result *r);
+
+#endif /* __chip8_host_h_ */
@@ -0,0 +1,216 @@
+#include "inputlog.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct chip8_input_recorder {
+    FILE *f;
+    uint64_t cycle;                  /* cycle of the last transition written */
+};
+
+struct chip8_input_log {
+    const uint8_t *data;             /* the mapped file */
+    size_t size;
+    uint32_t seed;
+    uint8_t quirks;                  /* enum chip8_quirks */
+    uint16_t ipf;
+
+    size_t pos;                      /* offset of the record after the pending one */
+    uint64_t next_cycle;             /* cycle of the pending transition, UINT64_MAX at the end */
+    uint8_t next_event;              /* key and state of the pending transition */
+};
+
+struct chip8_input_recorder* chip8_input_recorder_open(const char *path, const struct chip8_machine *m) {
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        return NULL;
+    }
+
+    struct chip8_input_recorder *rec = calloc(1, sizeof(struct chip8_input_recorder));
+
+    if (rec == NULL) {
+        fclose(f);
+        return NULL;
+    }
+
+    uint32_t seed = m->rng;
+    uint8_t header[CHIP8_INPUT_LOG_HEADER] = {
+        CHIP8_INPUT_LOG_MAGIC[0], CHIP8_INPUT_LOG_MAGIC[1], CHIP8_INPUT_LOG_MAGIC[2], CHIP8_INPUT_LOG_MAGIC[3],
+        CHIP8_INPUT_LOG_VERSION, m->quirks, m->ipf & 0xFF, m->ipf >> 8,
+        seed & 0xFF, (seed >> 8) & 0xFF, (seed >> 16) & 0xFF, (seed >> 24) & 0xFF
+    };
+
+    rec->f = f;
+
+    if (fwrite(header, sizeof(header), 1, f) != 1) {
+        chip8_input_recorder_close(&rec);
+        return NULL;
+    }
+
+    return rec;
+}
+
+int chip8_input_recorder_key(struct chip8_input_recorder *rec, uint64_t cycle, uint8_t key, uint8_t down) {
+    if (rec == NULL || cycle < rec->cycle || key > 0xF) {
+        return -1;
+    }
+
+    uint8_t record[11];
+    uint64_t delta = cycle - rec->cycle;
+    size_t n = 0;
+
+    while (delta >= 0x80) {
+        record[n++] = (uint8_t)(delta | 0x80);
+        delta >>= 7;
+    }
+
+    record[n++] = (uint8_t)delta;
+    record[n++] = key | (down ? 0x10 : 0x00);
+
+    rec->cycle = cycle;
+
+    return fwrite(record, n, 1, rec->f) == 1 ? 0 : -1;
+}
+
+int chip8_input_recorder_keys(struct chip8_input_recorder *rec, uint64_t cycle, const uint8_t *before, const uint8_t *after) {
+    for (uint8_t k = 0; k < 16; k++) {
+        if (before[k] != after[k] && chip8_input_recorder_key(rec, cycle, k, after[k]) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int chip8_input_recorder_close(struct chip8_input_recorder **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    int rc = fclose((*p)->f) == 0 ? 0 : -1;
+
+    free(*p);
+    *p = NULL;
+    return rc;
+}
+
+/**
+ * Decodes the record at the cursor into the pending transition
+ * @param {struct chip8_input_log*} l The log to advance
+ */
+static void chip8_input_log_advance(struct chip8_input_log *l) {
+    uint64_t delta = 0;
+    int shift = 0;
+
+    while (l->pos < l->size && shift < 64) {
+        uint8_t b = l->data[l->pos++];
+        delta |= (uint64_t)(b & 0x7F) << shift;
+        shift += 7;
+
+        if (!(b & 0x80)) {
+            if (l->pos < l->size) {
+                l->next_event = l->data[l->pos++];
+                l->next_cycle += delta;
+                return;
+            }
+
+            break;
+        }
+    }
+
+    // a truncated record ends the log, as a recorder killed mid-write leaves it
+    l->pos = l->size;
+    l->next_cycle = UINT64_MAX;
+}
+
+struct chip8_input_log* chip8_input_log_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < CHIP8_INPUT_LOG_HEADER) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    const uint8_t *h = (const uint8_t*)data;
+    struct chip8_input_log *l = NULL;
+
+    if (memcmp(h, CHIP8_INPUT_LOG_MAGIC, 4) != 0 || h[4] < 1 || h[4] > CHIP8_INPUT_LOG_VERSION || h[5] >= CHIP8_QUIRKS_COUNT ||
+        (l = calloc(1, sizeof(struct chip8_input_log))) == NULL) {
+        munmap(data, st.st_size);
+        return NULL;
+    }
+
+    // the log is replayed front to back exactly once per run
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+    l->data = h;
+    l->size = st.st_size;
+    l->seed = h[8] | h[9] << 8 | h[10] << 16 | (uint32_t)h[11] << 24;
+    l->quirks = h[5];
+    l->ipf = h[6] | h[7] << 8;
+
+    if (l->ipf == 0) {
+        l->ipf = CHIP8_DEFAULT_IPF;
+    }
+
+    chip8_input_log_reset(l);
+
+    return l;
+}
+
+int chip8_input_log_close(struct chip8_input_log **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    munmap((void*)(*p)->data, (*p)->size);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+uint32_t chip8_input_log_seed(const struct chip8_input_log *l) {
+    return l->seed;
+}
+
+enum chip8_quirks chip8_input_log_quirks(const struct chip8_input_log *l) {
+    return (enum chip8_quirks)l->quirks;
+}
+
+uint16_t chip8_input_log_ipf(const struct chip8_input_log *l) {
+    return l->ipf;
+}
+
+uint64_t chip8_input_log_apply(struct chip8_input_log *l, struct chip8_machine *m) {
+    if (l == NULL) {
+        return UINT64_MAX;
+    }
+
+    while (l->next_cycle <= m->cycles) {
+        m->key[l->next_event & 0x0F] = (l->next_event >> 4) & 1;
+        chip8_input_log_advance(l);
+    }
+
+    return l->next_cycle;
+}
+
+void chip8_input_log_reset(struct chip8_input_log *l) {
+    l->pos = CHIP8_INPUT_LOG_HEADER;
+    l->next_cycle = 0;
+    chip8_input_log_advance(l);
+}
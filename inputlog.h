@@ -0,0 +1,123 @@
+#ifndef __chip8_inputlog_h_
+
+#define __chip8_inputlog_h_
+
+#include "machine.h"
+
+/*
+ Input log format; all integers little endian
+ +--------+---------+--------+-----+------+
+ | "C8IN" | version | quirks | ipf | seed |  header, 12 bytes
+ | 4      | 1       | 1      | 2   | 4    |
+ +--------+---------+--------+-----+------+
+ The quirk profile and instructions per tick shape the run as much as the
+ seed does; version 1 logs left those bytes zero and ran modern at the
+ default ipf.
+ followed by one record per key transition, in cycle order:
+ +-------------------------+--------------------+
+ | cycles since last event | key | down << 4    |
+ | LEB128                  | 1                  |
+ +-------------------------+--------------------+
+ A transition at cycle c applies before the instruction that makes the
+ machine's cycle count c + 1, as with input scripts.
+*/
+
+#define CHIP8_INPUT_LOG_MAGIC     "C8IN"
+#define CHIP8_INPUT_LOG_VERSION   2
+#define CHIP8_INPUT_LOG_HEADER    12
+
+/**
+ * Writer of an input log
+ */
+struct chip8_input_recorder;
+
+/**
+ * Read-only input log mapped into memory, with a cursor into its transitions
+ */
+struct chip8_input_log;
+
+/**
+ * Creates an input log and writes its header
+ * @param {const char *} path The path of the log to create
+ * @param {const struct chip8_machine*} m The machine about to be recorded; its seed, quirk profile and ipf go into the header
+ * @return {struct chip8_input_recorder*} The new recorder, NULL on failure
+ */
+struct chip8_input_recorder* chip8_input_recorder_open(const char *path, const struct chip8_machine *m);
+
+/**
+ * Appends a key transition to the log
+ * @param {struct chip8_input_recorder*} rec The recorder to append to
+ * @param {uint64_t} cycle The machine cycle of the transition; never less than the last
+ * @param {uint8_t} key The key index (0x0 - 0xF)
+ * @param {uint8_t} down 1 when pressed, 0 when released
+ * @return {int} The outcome of the execution
+ */
+int chip8_input_recorder_key(struct chip8_input_recorder *rec, uint64_t cycle, uint8_t key, uint8_t down);
+
+/**
+ * Appends a record for every key whose state differs between two key arrays
+ * @param {struct chip8_input_recorder*} rec The recorder to append to
+ * @param {uint64_t} cycle The machine cycle of the transitions
+ * @param {const uint8_t *} before The key states before
+ * @param {const uint8_t *} after The key states after
+ * @return {int} The outcome of the execution
+ */
+int chip8_input_recorder_keys(struct chip8_input_recorder *rec, uint64_t cycle, const uint8_t *before, const uint8_t *after);
+
+/**
+ * Flushes and closes the log
+ * @param {struct chip8_input_recorder**} p The recorder to close
+ * @return {int} The outcome of the execution
+ */
+int chip8_input_recorder_close(struct chip8_input_recorder **p);
+
+/**
+ * Maps an input log into memory, validating its header
+ * @param {const char *} path The path of the log to open
+ * @return {struct chip8_input_log*} The opened log, NULL on failure
+ */
+struct chip8_input_log* chip8_input_log_open(const char *path);
+
+/**
+ * Unmaps and closes the log
+ * @param {struct chip8_input_log**} p The log to close
+ * @return {int} The outcome of the execution
+ */
+int chip8_input_log_close(struct chip8_input_log **p);
+
+/**
+ * Reads the seed of the recorded machine
+ * @param {const struct chip8_input_log*} l The log to read
+ * @return {uint32_t} The seed to pass to chip8_seed()
+ */
+uint32_t chip8_input_log_seed(const struct chip8_input_log *l);
+
+/**
+ * Reads the quirk profile of the recorded machine
+ * @param {const struct chip8_input_log*} l The log to read
+ * @return {enum chip8_quirks} The profile to pass to chip8_set_quirks()
+ */
+enum chip8_quirks chip8_input_log_quirks(const struct chip8_input_log *l);
+
+/**
+ * Reads the instructions per timer tick of the recorded machine
+ * @param {const struct chip8_input_log*} l The log to read
+ * @return {uint16_t} The ipf to pass to chip8_set_ipf()
+ */
+uint16_t chip8_input_log_ipf(const struct chip8_input_log *l);
+
+/**
+ * Applies every transition due at or before the machine's current cycle
+ * @param {struct chip8_input_log*} l The log to apply
+ * @param {struct chip8_machine*} m The machine to apply the transitions to
+ * @return {uint64_t} The cycle of the next pending transition, UINT64_MAX when there is none
+ */
+uint64_t chip8_input_log_apply(struct chip8_input_log *l, struct chip8_machine *m);
+
+/**
+ * Moves the cursor back to the first transition
+ * @param {struct chip8_input_log*} l The log to rewind
+ */
+void chip8_input_log_reset(struct chip8_input_log *l);
+
+#endif /* __chip8_inputlog_h_ */
@@ -3,19 +3,54 @@
 SDL_Window *window;
 SDL_Renderer *renderer;
 SDL_Texture *texture;
-SDL_AudioSpec spec, obtained;
+SDL_Texture *heatmap;                /* pc heatmap, one texel per address */
+SDL_AudioSpec spec;
 
-uint8_t audio_buffer[AUDIO_BUFFER_SIZE];
+/* written by the SDL thread, read by the emulation thread */
+_Atomic uint16_t key_mask;           /* one bit per chip8 key */
+_Atomic uint8_t rewind_held;
+
+uint64_t drawn[VIDEO_HEIGHT];        /* the rows the texture currently shows */
+uint32_t stale_rows;                 /* rows the texture has never been given */
+uint8_t frame_pending;               /* the texture changed since the last present */
+Uint32 refresh_ms;                   /* the display's refresh period */
+Uint32 last_present;
+
+/* the audio device plays continuously; the tone is gated on sample counts */
+_Atomic uint64_t samples_played;     /* frames handed to the device so far */
+_Atomic uint64_t tone_until;         /* frame at which the tone stops */
+uint32_t phase;                      /* square wave phase, carried across callbacks */
+uint8_t last_sound_timer;
+
+/* profile summaries handed over by the emulation thread, about once a second */
+SDL_mutex *profile_lock;
+char profile_title[128];
+uint8_t profile_heat[0x1000];
+uint8_t profile_fresh;               /* a summary arrived since the SDL thread last looked */
+uint8_t profile_has_heat;
+uint8_t heatmap_shown;               /* toggled with F1 */
 
 void audio_callback(void *userdata, uint8_t *stream, int len) {
-    for (int i = 0; i < len; i += BYTES_PER_SAMPLE * CHANNELS) {
-        float time = (float)i / (BYTES_PER_SAMPLE * CHANNELS) / (float)SAMPLE_RATE;
-        int sample = AMPLITUDE * sin(2 * M_PI * FREQUENCY * time);
+    const uint32_t step = (uint32_t)(((uint64_t)FREQUENCY << 32) / SAMPLE_RATE);
+    int frames = len / (BYTES_PER_SAMPLE * CHANNELS);
+    int16_t *out = (int16_t*)stream;
+
+    uint64_t played = atomic_load(&samples_played);
+    uint64_t until = atomic_load(&tone_until);
+    int tone = until > played ? (until - played < (uint64_t)frames ? (int)(until - played) : frames) : 0;
+
+    for (int i = 0; i < tone; i++) {
+        int16_t sample = phase & 0x80000000u ? AMPLITUDE : -AMPLITUDE;
+        phase += step;
 
         for (int channel = 0; channel < CHANNELS; ++channel) {
-            *(int16_t*)&stream[i + channel * BYTES_PER_SAMPLE] = sample;
+            *out++ = sample;
         }
     }
+
+    memset(out, 0, (frames - tone) * BYTES_PER_SAMPLE * CHANNELS);
+
+    atomic_store(&samples_played, played + frames);
 }
 
 int interface_init(void) {
@@ -42,6 +77,17 @@ int interface_init(void) {
             VIDEO_HEIGHT
     );
 
+    heatmap = SDL_CreateTexture(
+            renderer,
+            SDL_PIXELFORMAT_RGBA8888,
+            SDL_TEXTUREACCESS_STREAMING,
+            64,
+            0x1000 / 64
+    );
+
+    SDL_SetTextureBlendMode(heatmap, SDL_BLENDMODE_BLEND);
+    profile_lock = SDL_CreateMutex();
+
     spec.freq = SAMPLE_RATE;
     spec.format = AUDIO_S16SYS;
     spec.channels = CHANNELS;
@@ -49,75 +95,203 @@ int interface_init(void) {
     spec.callback = audio_callback;
     spec.userdata = NULL;
 
-    SDL_OpenAudio(&spec, &obtained);
-    SDL_PauseAudio(1);
+    // present no more often than the display can show a frame
+    SDL_DisplayMode mode;
+    int refresh = SDL_GetWindowDisplayMode(window, &mode) == 0 && mode.refresh_rate > 0 ? mode.refresh_rate : 60;
+    refresh_ms = 1000 / refresh;
+    stale_rows = 0xFFFFFFFF;
+    frame_pending = 1;
+
+    // without an obtained spec SDL converts from exactly this format
+    SDL_OpenAudio(&spec, NULL);
+    SDL_PauseAudio(0);
 
     return 0;
 }
 
 int interface_destroy(void) {
+    SDL_DestroyMutex(profile_lock);
     SDL_Quit();
     return 0;
 }
 
-int interface_draw(struct chip8_machine *m) {
-    if (m->draw_flag) {
-        m->draw_flag = 0;
+/**
+ * Picks up the newest profile summary; retitles the window and repaints the heatmap
+ */
+static void update_profile(void) {
+    SDL_LockMutex(profile_lock);
+
+    if (profile_fresh) {
+        SDL_SetWindowTitle(window, profile_title);
+
+        void *pixels;
+        int pitch;
+
+        if (profile_has_heat && SDL_LockTexture(heatmap, NULL, &pixels, &pitch) == 0) {
+            for (int pc = 0; pc < 0x1000; pc++) {
+                uint32_t *texel = (uint32_t*)((uint8_t*)pixels + (pc / 64) * pitch) + pc % 64;
+                uint8_t heat = profile_heat[pc];
+
+                // cold addresses stay clear; hot ones go from blue to red
+                *texel = (uint32_t)heat << 24 | (uint32_t)(255 - heat) << 8 | (heat ? 0xC0 : 0x00);
+            }
+
+            SDL_UnlockTexture(heatmap);
+            frame_pending |= heatmap_shown;
+        }
+
+        profile_fresh = 0;
+    }
+
+    SDL_UnlockMutex(profile_lock);
+}
+
+int interface_draw(const struct chip8_frame *f) {
+    uint32_t rows = 0;
+
+    update_profile();
+
+    if (f != NULL) {
+        rows = stale_rows;
+        stale_rows = 0;
+
+        for (int y = 0; y < VIDEO_HEIGHT; y++) {
+            rows |= (uint32_t)(f->display[y] != drawn[y]) << y;
+        }
+    }
+
+    if (rows) {
+        // a locked texture is write-only, so every row of the span is rewritten
+        int first = __builtin_ctz(rows);
+        int last = 31 - __builtin_clz(rows);
+        SDL_Rect span = { 0, first, VIDEO_WIDTH, last - first + 1 };
+        void *pixels;
+        int pitch;
+
+        if (SDL_LockTexture(texture, &span, &pixels, &pitch) == 0) {
+            for (int y = first; y <= last; y++) {
+                uint32_t *line = (uint32_t*)((uint8_t*)pixels + (y - first) * pitch);
+                uint64_t row = f->display[y];
+
+                for (int x = 0; x < VIDEO_WIDTH; x++) {
+                    line[x] = (row >> (63 - x)) & 1 ? 0xFFFFFFFF : 0x00000000;
+                }
 
-        uint32_t pixels[VIDEO_WIDTH * VIDEO_HEIGHT];
-        for (int i = 0; i < VIDEO_WIDTH * VIDEO_HEIGHT; i++) {
-            pixels[i] = m->display[i] ? 0xFFFFFFFF : 0x00000000;
+                drawn[y] = row;
+            }
 
+            SDL_UnlockTexture(texture);
         }
 
-        SDL_UpdateTexture(texture, NULL, pixels, VIDEO_WIDTH * sizeof(uint32_t));
+        frame_pending = 1;
     }
 
-    SDL_RenderCopy(renderer, texture, NULL, NULL);
-    SDL_RenderPresent(renderer);
+    Uint32 now = SDL_GetTicks();
+
+    if (frame_pending && now - last_present >= refresh_ms) {
+        SDL_RenderCopy(renderer, texture, NULL, NULL);
+
+        if (heatmap_shown) {
+            SDL_RenderCopy(renderer, heatmap, NULL, NULL);
+        }
 
-    /* TODO: come back to audio processing */
-    /*
-    const int status = SDL_GetAudioStatus();
-    if (m->beep_flag == 1 && status != SDL_AUDIO_PLAYING) {
-        SDL_PauseAudio(0);
+        SDL_RenderPresent(renderer);
 
-    } else if (m->beep_flag == 0 && status == SDL_AUDIO_PLAYING) {
-        SDL_PauseAudio(1);
+        frame_pending = 0;
+        last_present = now;
     }
-    */
 
     return 0;
 }
 
-int interface_capture_events(struct chip8_machine *m) {
+/**
+ * Publishes the state of one chip8 key to the emulation thread
+ */
+static void set_key(int key, int down) {
+    if (down) {
+        atomic_fetch_or(&key_mask, (uint16_t)(1u << key));
+    } else {
+        atomic_fetch_and(&key_mask, (uint16_t)~(1u << key));
+    }
+}
+
+int interface_capture_events(void) {
     SDL_Event event;
     while (SDL_PollEvent(&event)) {
         switch (event.type) {
             case SDL_QUIT: return -1; break;
+            case SDL_WINDOWEVENT: frame_pending = 1; break;
             case SDL_KEYDOWN:
             case SDL_KEYUP:
                 switch (event.key.keysym.sym) {
-                    case SDLK_1: m->key[0x1] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_2: m->key[0x2] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_3: m->key[0x3] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_4: m->key[0xC] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_q: m->key[0x4] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_w: m->key[0x5] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_e: m->key[0x6] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_r: m->key[0xD] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_a: m->key[0x7] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_s: m->key[0x8] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_d: m->key[0x9] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_f: m->key[0xE] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_z: m->key[0xA] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_x: m->key[0x0] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_c: m->key[0xB] = event.type == SDL_KEYDOWN; break;
-                    case SDLK_v: m->key[0xF] = event.type == SDL_KEYDOWN; break;
+                    case SDLK_1: set_key(0x1, event.type == SDL_KEYDOWN); break;
+                    case SDLK_2: set_key(0x2, event.type == SDL_KEYDOWN); break;
+                    case SDLK_3: set_key(0x3, event.type == SDL_KEYDOWN); break;
+                    case SDLK_4: set_key(0xC, event.type == SDL_KEYDOWN); break;
+                    case SDLK_q: set_key(0x4, event.type == SDL_KEYDOWN); break;
+                    case SDLK_w: set_key(0x5, event.type == SDL_KEYDOWN); break;
+                    case SDLK_e: set_key(0x6, event.type == SDL_KEYDOWN); break;
+                    case SDLK_r: set_key(0xD, event.type == SDL_KEYDOWN); break;
+                    case SDLK_a: set_key(0x7, event.type == SDL_KEYDOWN); break;
+                    case SDLK_s: set_key(0x8, event.type == SDL_KEYDOWN); break;
+                    case SDLK_d: set_key(0x9, event.type == SDL_KEYDOWN); break;
+                    case SDLK_f: set_key(0xE, event.type == SDL_KEYDOWN); break;
+                    case SDLK_z: set_key(0xA, event.type == SDL_KEYDOWN); break;
+                    case SDLK_x: set_key(0x0, event.type == SDL_KEYDOWN); break;
+                    case SDLK_c: set_key(0xB, event.type == SDL_KEYDOWN); break;
+                    case SDLK_v: set_key(0xF, event.type == SDL_KEYDOWN); break;
+                    case SDLK_BACKSPACE: atomic_store(&rewind_held, event.type == SDL_KEYDOWN); break;
+                    case SDLK_F1:
+                        if (event.type == SDL_KEYDOWN && !event.key.repeat) {
+                            heatmap_shown = !heatmap_shown;
+                            frame_pending = 1;
+                        }
+                        break;
                 }
                 break;
         }
     }
 
     return 0;
-}
\ No newline at end of file
+}
+uint16_t interface_keys(void) {
+    return atomic_load(&key_mask);
+}
+
+int interface_rewinding(void) {
+    return atomic_load(&rewind_held);
+}
+
+void interface_sound(uint8_t sound_timer, double speed) {
+    // the tone lasts one emulated 60 Hz tick per timer unit from the moment
+    // the timer is loaded; a timer counting down on its own needs no update.
+    // Uncapped, emulated time has no length in samples, so the tone simply
+    // follows the timer
+    if (sound_timer > last_sound_timer || (sound_timer == 0 && last_sound_timer != 0)) {
+        uint64_t now = atomic_load(&samples_played);
+        uint64_t length = sound_timer ? UINT64_MAX - now : 0;
+
+        if (speed > CHIP8_SPEED_UNCAPPED) {
+            length = (uint64_t)(sound_timer * SAMPLE_RATE / (CHIP8_TIMER_HZ * speed));
+        }
+
+        atomic_store(&tone_until, now + length);
+    }
+
+    last_sound_timer = sound_timer;
+}
+
+void interface_profile(const char *title, const uint8_t *heat) {
+    SDL_LockMutex(profile_lock);
+
+    snprintf(profile_title, sizeof(profile_title), "%s", title);
+
+    if (heat != NULL) {
+        memcpy(profile_heat, heat, sizeof(profile_heat));
+    }
+
+    profile_has_heat = heat != NULL;
+    profile_fresh = 1;
+
+    SDL_UnlockMutex(profile_lock);
+}
@@ -6,22 +6,33 @@
 #include <ncurses.h>
 #include <unistd.h>
 #include <math.h>
+#include <stdatomic.h>
+#include <SDL2/SDL.h>
 #include "machine.h"
+#include "frames.h"
+#include "scheduler.h"
 
 #define AMPLITUDE           28000
 #define FREQUENCY           440
 #define SAMPLE_RATE         44100
-#define SAMPLES             44100
+#define SAMPLES             512              /* frames per audio buffer; about 12 ms */
 #define CHANNELS            2
 #define BYTES_PER_SAMPLE    2
-#define AUDIO_BUFFER_SIZE   (SAMPLES * BYTES_PER_SAMPLE * CHANNELS)
 
 int interface_init(void);
 
 int interface_destroy(void);
 
-int interface_draw(struct chip8_machine *m);
+int interface_draw(const struct chip8_frame *f);
 
-int interface_capture_events(struct chip8_machine *m);
+int interface_capture_events(void);
+
+uint16_t interface_keys(void);
+
+int interface_rewinding(void);
+
+void interface_sound(uint8_t sound_timer, double speed);
+
+void interface_profile(const char *title, const uint8_t *heat);
 
 #endif /* __chip8_interface_h_ */
\ No newline at end of file
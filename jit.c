@@ -0,0 +1,349 @@
+#include "jit.h"
+#include "machine_ops.h"
+#include "dispatch.h"
+
+#define JIT_MEMORY      0x1000
+#define JIT_MAX_INSNS   64
+#define JIT_PAGE_SHIFT  6
+#define JIT_PAGES       (JIT_MEMORY >> JIT_PAGE_SHIFT)
+
+/**
+ * A pre-decoded instruction; the handler bound to its opcode
+ */
+struct chip8_insn {
+    chip8_handler fn;
+    uint16_t opcode;
+    uint8_t skips;                   /* leaves the block when the skip is taken */
+};
+
+/**
+ * A compiled run of instructions starting at one address
+ */
+struct chip8_block {
+    uint16_t start;                  /* address of the first instruction */
+    uint16_t end;                    /* address past the last instruction */
+    uint16_t count;                  /* number of instructions */
+    uint8_t writes;                  /* last instruction writes memory at I */
+    uint8_t self_jump;               /* last instruction jumps onto itself */
+    uint8_t timed;                   /* reads or writes a timer */
+    struct chip8_insn insns[];
+};
+
+struct chip8_jit {
+    struct chip8_block *blocks[JIT_MEMORY];
+    uint8_t code_pages[JIT_PAGES];   /* pages holding compiled code */
+    uint8_t quirks;                  /* profile the blocks were compiled for */
+};
+
+/**
+ * Tests whether an instruction class is a conditional skip
+ * @param {enum chip8_op} op The instruction class
+ * @return {int} 1 when the instruction may skip the next one
+ */
+static int chip8_jit_skips(enum chip8_op op) {
+    switch (op) {
+        case CHIP8_OP_SE_BYTE:
+        case CHIP8_OP_SNE_BYTE:
+        case CHIP8_OP_SE_REG:
+        case CHIP8_OP_SNE_REG:
+        case CHIP8_OP_SKP:
+        case CHIP8_OP_SKNP:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Tests whether an instruction class has to end a block
+ * @param {enum chip8_op} op The instruction class
+ * @return {int} 1 when the instruction ends the block
+ */
+static int chip8_jit_ends_block(enum chip8_op op) {
+    switch (op) {
+        case CHIP8_OP_RET:
+        case CHIP8_OP_JP:
+        case CHIP8_OP_CALL:
+        case CHIP8_OP_JP_V0:
+        case CHIP8_OP_DRW:
+        case CHIP8_OP_LD_VX_K:
+        case CHIP8_OP_LD_B:
+        case CHIP8_OP_LD_MEM_VX:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * Compiles the block starting at the given address
+ * @return {struct chip8_block*} The block, NULL when nothing could be compiled
+ */
+static struct chip8_block* chip8_jit_compile(struct chip8_jit *j, const struct chip8_machine *m, uint16_t start) {
+    const uint8_t *decode = chip8_decode_table();
+    const chip8_handler *handlers = chip8_handlers(m->quirks);
+    struct chip8_insn insns[JIT_MAX_INSNS];
+    uint16_t count = 0;
+    uint16_t pc = start;
+    uint8_t timed = 0;
+    enum chip8_op op = CHIP8_OP_UNKNOWN;
+
+    while (count < JIT_MAX_INSNS && pc + 1 < JIT_MEMORY) {
+        uint16_t opcode = m->memory[pc] << 8 | m->memory[pc + 1];
+        op = decode[opcode];
+
+        // invalid opcodes are left to the reference interpreter
+        if (op == CHIP8_OP_UNKNOWN || op == CHIP8_OP_SYS) {
+            break;
+        }
+
+        timed |= op == CHIP8_OP_LD_VX_DT || op == CHIP8_OP_LD_DT_VX || op == CHIP8_OP_LD_ST_VX;
+
+        insns[count].fn = handlers[op];
+        insns[count].opcode = opcode;
+        insns[count].skips = chip8_jit_skips(op);
+        count++;
+        pc += 2;
+
+        if (chip8_jit_ends_block(op)) {
+            break;
+        }
+    }
+
+    if (count == 0) {
+        return NULL;
+    }
+
+    struct chip8_block *b = malloc(sizeof(struct chip8_block) + count * sizeof(struct chip8_insn));
+    if (b == NULL) {
+        return NULL;
+    }
+
+    uint16_t last = insns[count - 1].opcode;
+
+    b->start = start;
+    b->end = pc;
+    b->count = count;
+    b->writes = op == CHIP8_OP_LD_B || op == CHIP8_OP_LD_MEM_VX;
+    b->self_jump = op == CHIP8_OP_JP && OP_NNN(last) == pc - 2;
+    b->timed = timed;
+    memcpy(b->insns, insns, count * sizeof(struct chip8_insn));
+
+    for (uint16_t p = start >> JIT_PAGE_SHIFT; p <= (pc - 1) >> JIT_PAGE_SHIFT; p++) {
+        j->code_pages[p] = 1;
+    }
+
+    j->blocks[start] = b;
+    return b;
+}
+
+struct chip8_jit* chip8_jit_create(void) {
+    return calloc(1, sizeof(struct chip8_jit));
+}
+
+int chip8_jit_destroy(struct chip8_jit **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    chip8_jit_flush(*p);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+/**
+ * Drops the blocks compiled for another quirk profile than the machine's
+ */
+static void chip8_jit_profile(struct chip8_jit *j, const struct chip8_machine *m) {
+    if (j->quirks != m->quirks) {
+        chip8_jit_flush(j);
+        j->quirks = m->quirks;
+    }
+}
+
+int chip8_jit_precompile(struct chip8_jit *j, const struct chip8_machine *m, const struct chip8_analysis *a) {
+    int compiled = 0;
+
+    chip8_jit_profile(j, m);
+
+    for (int addr = 0; addr < JIT_MEMORY; addr++) {
+        if (!(a->bytes[addr] & CHIP8_BYTE_LEADER)) {
+            continue;
+        }
+
+        // jit blocks stop short of some basic blocks' ends; carry on where they do
+        for (uint16_t pc = addr; pc + 1 < JIT_MEMORY && (a->bytes[pc] & CHIP8_BYTE_CODE) && j->blocks[pc] == NULL;) {
+            struct chip8_block *b = chip8_jit_compile(j, m, pc);
+
+            if (b == NULL) {
+                break;
+            }
+
+            compiled++;
+            pc = b->end;
+        }
+    }
+
+    return compiled;
+}
+
+void chip8_jit_invalidate(struct chip8_jit *j, uint16_t addr, uint16_t len) {
+    uint32_t end = (uint32_t)addr + len;
+
+    if (addr >= JIT_MEMORY || len == 0) {
+        return;
+    }
+
+    if (end > JIT_MEMORY) {
+        end = JIT_MEMORY;
+    }
+
+    uint8_t touched = 0;
+    for (uint32_t p = addr >> JIT_PAGE_SHIFT; p <= (end - 1) >> JIT_PAGE_SHIFT; p++) {
+        touched |= j->code_pages[p];
+    }
+
+    if (!touched) {
+        return;
+    }
+
+    // only blocks starting within one maximal block of the range can reach it
+    uint32_t from = addr > JIT_MAX_INSNS * 2 ? addr - JIT_MAX_INSNS * 2 : 0;
+    for (uint32_t a = from; a < end; a++) {
+        struct chip8_block *b = j->blocks[a];
+
+        if (b && b->end > addr) {
+            free(b);
+            j->blocks[a] = NULL;
+        }
+    }
+}
+
+void chip8_jit_flush(struct chip8_jit *j) {
+    // every block starts on a page it marked, so a small program flushes quickly
+    for (int p = 0; p < JIT_PAGES; p++) {
+        if (!j->code_pages[p]) {
+            continue;
+        }
+
+        for (int a = p << JIT_PAGE_SHIFT; a < (p + 1) << JIT_PAGE_SHIFT; a++) {
+            free(j->blocks[a]);
+            j->blocks[a] = NULL;
+        }
+    }
+
+    memset(j->code_pages, 0, sizeof(j->code_pages));
+}
+
+size_t chip8_jit_bytes(const struct chip8_jit *j) {
+    size_t bytes = sizeof(struct chip8_jit);
+
+    for (int a = 0; a < JIT_MEMORY; a++) {
+        if (j->blocks[a]) {
+            bytes += sizeof(struct chip8_block) + j->blocks[a]->count * sizeof(struct chip8_insn);
+        }
+    }
+
+    return bytes;
+}
+
+/**
+ * Drops the blocks over the memory an FX33 or FX55 just wrote
+ * @param {struct chip8_jit*} j The block cache of the machine
+ * @param {const struct chip8_machine*} m The machine, with I as the instruction left it
+ * @param {uint16_t} opcode The FX33 or FX55 executed
+ */
+static void jit_written(struct chip8_jit *j, const struct chip8_machine *m, uint16_t opcode) {
+    uint16_t len = (opcode & 0xFF) == 0x33 ? 3 : OP_X(opcode) + 1;
+    uint16_t moved = (opcode & 0xFF) == 0x55 ? chip8_quirk_load_i(opcode, chip8_quirk_flags(m->quirks)) : 0;
+
+    // FX55 may have moved I past what it wrote
+    chip8_jit_invalidate(j, m->i - moved, len);
+}
+
+int chip8_jit_run(struct chip8_jit *j, struct chip8_machine *m, uint64_t count) {
+    uint64_t end = m->cycles + count;
+
+    chip8_jit_profile(j, m);
+
+    while (m->cycles < end) {
+        struct chip8_block *b = m->pc < JIT_MEMORY ? j->blocks[m->pc] : NULL;
+
+        if (b == NULL && (m->pc + 1 >= JIT_MEMORY || (b = chip8_jit_compile(j, m, m->pc)) == NULL)) {
+            // uncompilable code runs through the reference interpreter
+            int self_jump = chip8_at_self_jump(m);
+            uint16_t opcode = m->pc + 1 < JIT_MEMORY ? m->memory[m->pc] << 8 | m->memory[m->pc + 1] : 0;
+            int rc = chip8_step(m);
+
+            if (rc < 0) {
+                return rc;
+            }
+
+            if ((opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055) {
+                jit_written(j, m, opcode);
+            }
+
+            if (self_jump) {
+                return CHIP8_RUN_LOOP;
+            }
+
+            continue;
+        }
+
+        uint64_t left = end - m->cycles;
+        uint16_t n = left < b->count ? (uint16_t)left : b->count;
+        uint16_t k = 0;
+        int rc = 0;
+
+        // a taken skip is a side exit out of the block
+        if (b->timed) {
+            while (k < n) {
+                const struct chip8_insn *in = &b->insns[k++];
+
+                chip8_cycle(m);
+                CHIP8_PROFILE_HIT(m, in->opcode);
+                CHIP8_TRACE_HIT(m, m->cycles, in->opcode);
+                rc = in->fn(m, in->opcode);
+
+                if (in->skips && m->pc != b->start + 2 * k) {
+                    break;
+                }
+            }
+        } else {
+            while (k < n) {
+                const struct chip8_insn *in = &b->insns[k++];
+
+                CHIP8_PROFILE_HIT(m, in->opcode);
+                CHIP8_TRACE_HIT(m, m->cycles + k, in->opcode);
+                rc = in->fn(m, in->opcode);
+
+                if (in->skips && m->pc != b->start + 2 * k) {
+                    break;
+                }
+            }
+
+            // nothing in the block observes the timers, so they advance at once
+            chip8_cycles(m, k);
+        }
+
+        if (k < b->count) {
+            continue;
+        }
+
+        if (rc < 0) {
+            return rc;
+        }
+
+        if (b->self_jump) {
+            return CHIP8_RUN_LOOP;
+        }
+
+        // self-modifying code; this may well free the block just run
+        if (b->writes) {
+            jit_written(j, m, b->insns[k - 1].opcode);
+        }
+    }
+
+    return 0;
+}
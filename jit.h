@@ -0,0 +1,75 @@
+#ifndef __chip8_jit_h_
+
+#define __chip8_jit_h_
+
+#include "machine.h"
+#include "analysis.h"
+
+/**
+ * Basic-block recompiler state; a cache of compiled blocks keyed by address
+ *
+ * Blocks are straight-line runs of pre-decoded instructions, each bound to its
+ * handler, starting at a program counter and ending at the first jump, skip,
+ * call, return, draw or memory write. A cache belongs to the memory image of
+ * a single machine: anything other than FX33/FX55 writing into that memory
+ * (loading a program, restoring state) must be followed by chip8_jit_flush(),
+ * or by chip8_jit_invalidate() over the pages a snapshot restore rewrote.
+ */
+struct chip8_jit;
+
+/**
+ * Creates a new, empty block cache
+ * @return {struct chip8_jit*} The newly created cache
+ */
+struct chip8_jit* chip8_jit_create(void);
+
+/**
+ * Destroys the given block cache
+ * @param {struct chip8_jit**} p The cache to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_jit_destroy(struct chip8_jit **p);
+
+/**
+ * Compiles ahead of time every block that static analysis found reachable, so
+ * a run starts without paying for compiling them. Blocks are compiled from the
+ * machine's memory as it is now, exactly as chip8_jit_run() would compile them.
+ * @param {struct chip8_jit*} j The block cache of the machine
+ * @param {const struct chip8_machine*} m The machine the analysis was made of
+ * @param {const struct chip8_analysis*} a The analysis of the machine's program
+ * @return {int} The number of blocks compiled
+ */
+int chip8_jit_precompile(struct chip8_jit *j, const struct chip8_machine *m, const struct chip8_analysis *a);
+
+/**
+ * Drops every compiled block that overlaps the given memory range
+ * @param {struct chip8_jit*} j The cache to invalidate
+ * @param {uint16_t} addr The first address written
+ * @param {uint16_t} len The number of bytes written
+ */
+void chip8_jit_invalidate(struct chip8_jit *j, uint16_t addr, uint16_t len);
+
+/**
+ * Drops every compiled block
+ * @param {struct chip8_jit*} j The cache to flush
+ */
+void chip8_jit_flush(struct chip8_jit *j);
+
+/**
+ * Measures the memory held by a block cache, compiled blocks included
+ * @param {const struct chip8_jit*} j The cache to measure
+ * @return {size_t} The size of the cache in bytes
+ */
+size_t chip8_jit_bytes(const struct chip8_jit *j);
+
+/**
+ * Runs up to count cycles through compiled blocks, falling back to chip8_step()
+ * for code that cannot be compiled. Follows the contract of chip8_run_switch().
+ * @param {struct chip8_jit*} j The block cache of the machine
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution
+ */
+int chip8_jit_run(struct chip8_jit *j, struct chip8_machine *m, uint64_t count);
+
+#endif /* __chip8_jit_h_ */
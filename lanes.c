@@ -0,0 +1,746 @@
+#include "lanes.h"
+#include "machine_ops.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Progress of a lockstep run that carries over between chunks
+ */
+struct lanes_run {
+    const struct chip8_script *const *scripts;
+    size_t cursor[CHIP8_LANES];      /* next event of each lane's script */
+    uint64_t next_event[CHIP8_LANES]; /* cycle of that event */
+    uint32_t active;                 /* lanes that have not halted */
+    uint32_t shared;                 /* lanes whose memory is still the common image */
+    int scripted;                    /* any lane has a script */
+};
+
+/**
+ * Lists the instruction classes a quirk profile makes behave otherwise than
+ * the lane forms, which follow the modern profile
+ * @param {enum chip8_quirks} q The quirk profile
+ * @return {uint64_t} A bitmask of enum chip8_op
+ */
+static uint64_t lanes_quirky(enum chip8_quirks q) {
+    unsigned flags = chip8_quirk_flags(q);
+    uint64_t ops = 0;
+
+    if (flags & CHIP8_QUIRK_SHIFT_VY) {
+        ops |= 1ULL << CHIP8_OP_SHR | 1ULL << CHIP8_OP_SHL;
+    }
+
+    if (flags & (CHIP8_QUIRK_LOAD_I_X1 | CHIP8_QUIRK_LOAD_I_X)) {
+        ops |= 1ULL << CHIP8_OP_LD_MEM_VX | 1ULL << CHIP8_OP_LD_VX_MEM;
+    }
+
+    if (flags & CHIP8_QUIRK_JUMP_VX) {
+        ops |= 1ULL << CHIP8_OP_JP_V0;
+    }
+
+    if (flags & CHIP8_QUIRK_CLIP) {
+        ops |= 1ULL << CHIP8_OP_DRW;
+    }
+
+    if (flags & CHIP8_QUIRK_VF_RESET) {
+        ops |= 1ULL << CHIP8_OP_OR | 1ULL << CHIP8_OP_AND | 1ULL << CHIP8_OP_XOR;
+    }
+
+    return ops;
+}
+
+int chip8_lanes_load(struct chip8_lanes *l, struct chip8_machine **machines, int count) {
+    if (l == NULL || machines == NULL || count < 1 || count > CHIP8_LANES) {
+        return -1;
+    }
+
+    memset(l, 0, sizeof(struct chip8_lanes));
+    l->count = count;
+
+    for (int k = 0; k < count; k++) {
+        struct chip8_machine *m = machines[k];
+
+        for (int r = 0; r < 16; r++) {
+            l->v[r][k] = m->v[r];
+        }
+
+        l->i[k] = m->i;
+        l->pc[k] = m->pc;
+        l->delay_timer[k] = m->delay_timer;
+        l->sound_timer[k] = m->sound_timer;
+        l->tick_left[k] = m->tick_left;
+        l->ipf[k] = m->ipf;
+        l->cycles[k] = m->cycles;
+        l->m[k] = m;
+        l->quirky |= lanes_quirky(m->quirks);
+    }
+
+    return 0;
+}
+
+/**
+ * Copies the registers of one lane into its machine
+ */
+static void lanes_store_lane(struct chip8_lanes *l, int k) {
+    struct chip8_machine *m = l->m[k];
+
+    for (int r = 0; r < 16; r++) {
+        m->v[r] = l->v[r][k];
+    }
+
+    m->i = l->i[k];
+    m->pc = l->pc[k];
+    m->delay_timer = l->delay_timer[k];
+    m->sound_timer = l->sound_timer[k];
+    m->tick_left = l->tick_left[k];
+    m->cycles = l->cycles[k];
+}
+
+/**
+ * Copies the registers of one machine back into its lane
+ */
+static void lanes_load_lane(struct chip8_lanes *l, int k) {
+    struct chip8_machine *m = l->m[k];
+
+    for (int r = 0; r < 16; r++) {
+        l->v[r][k] = m->v[r];
+    }
+
+    l->i[k] = m->i;
+    l->pc[k] = m->pc;
+    l->delay_timer[k] = m->delay_timer;
+    l->sound_timer[k] = m->sound_timer;
+    l->tick_left[k] = m->tick_left;
+}
+
+void chip8_lanes_store(struct chip8_lanes *l) {
+    for (int k = 0; k < l->count; k++) {
+        lanes_store_lane(l, k);
+    }
+}
+
+static inline uint16_t lanes_opcode(const struct chip8_lanes *l, int k) {
+    const uint8_t *memory = l->m[k]->memory;
+    return memory[l->pc[k]] << 8 | memory[l->pc[k] + 1];
+}
+
+#if defined(__SSE2__)
+
+/**
+ * Finds the lanes sitting at the given address
+ * @return {uint32_t} A bitmask of the lanes whose program counter is pc
+ */
+static inline uint32_t lanes_at(const struct chip8_lanes *l, uint16_t pc) {
+    __m128i target = _mm_set1_epi16(pc);
+    __m128i lo = _mm_cmpeq_epi16(_mm_load_si128((const __m128i*)&l->pc[0]), target);
+    __m128i hi = _mm_cmpeq_epi16(_mm_load_si128((const __m128i*)&l->pc[8]), target);
+
+    return _mm_movemask_epi8(_mm_packs_epi16(lo, hi)) & ((1u << l->count) - 1);
+}
+
+#else
+
+static inline uint32_t lanes_at(const struct chip8_lanes *l, uint16_t pc) {
+    uint32_t mask = 0;
+
+    for (int k = 0; k < l->count; k++) {
+        mask |= (uint32_t)(l->pc[k] == pc) << k;
+    }
+
+    return mask;
+}
+
+#endif
+
+#if defined(__SSE2__)
+
+/**
+ * Expands a bitmask of lanes into a vector of 0x00/0xFF bytes
+ */
+static inline __m128i lanes_mask8(uint32_t mask) {
+    const __m128i bits = _mm_set_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01,
+                                      (char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+    __m128i spread = _mm_set_epi64x((int64_t)(0x0101010101010101ULL * ((mask >> 8) & 0xFF)),
+                                    (int64_t)(0x0101010101010101ULL * (mask & 0xFF)));
+
+    return _mm_cmpeq_epi8(_mm_and_si128(spread, bits), bits);
+}
+
+/**
+ * Progresses the timers and remaining budgets of the masked lanes, as chip8_step() does
+ * @return {uint32_t} A bitmask of the lanes whose budget ran out
+ */
+static uint32_t lanes_tick(struct chip8_lanes *l, uint32_t mask, uint32_t *left) {
+    __m128i m8 = lanes_mask8(mask);
+    __m128i one = _mm_set1_epi8(1);
+    __m128i m16lo = _mm_unpacklo_epi8(m8, m8);
+    __m128i m16hi = _mm_unpackhi_epi8(m8, m8);
+
+    // count down to the next timer tick; lanes reaching zero tick and start over
+    __m128i *tl = (__m128i*)l->tick_left;
+    __m128i tlo = _mm_add_epi16(_mm_load_si128(&tl[0]), m16lo);
+    __m128i thi = _mm_add_epi16(_mm_load_si128(&tl[1]), m16hi);
+    __m128i zlo = _mm_cmpeq_epi16(tlo, _mm_setzero_si128());
+    __m128i zhi = _mm_cmpeq_epi16(thi, _mm_setzero_si128());
+    const __m128i *ipf = (const __m128i*)l->ipf;
+
+    _mm_store_si128(&tl[0], _mm_or_si128(_mm_and_si128(zlo, _mm_load_si128(&ipf[0])), _mm_andnot_si128(zlo, tlo)));
+    _mm_store_si128(&tl[1], _mm_or_si128(_mm_and_si128(zhi, _mm_load_si128(&ipf[1])), _mm_andnot_si128(zhi, thi)));
+
+    __m128i t8 = _mm_packs_epi16(zlo, zhi);
+    __m128i dt = _mm_load_si128((const __m128i*)l->delay_timer);
+    __m128i st = _mm_load_si128((const __m128i*)l->sound_timer);
+
+    // the beep starts on lanes whose sound timer runs down to zero now
+    uint32_t beeps = _mm_movemask_epi8(_mm_and_si128(t8, _mm_cmpeq_epi8(st, one))) & mask;
+    for (; beeps; beeps &= beeps - 1) {
+        l->m[__builtin_ctz(beeps)]->beep_flag = 1;
+    }
+
+    _mm_store_si128((__m128i*)l->delay_timer, _mm_sub_epi8(dt, _mm_and_si128(t8, _mm_min_epu8(dt, one))));
+    _mm_store_si128((__m128i*)l->sound_timer, _mm_sub_epi8(st, _mm_and_si128(t8, _mm_min_epu8(st, one))));
+
+    __m128i m32[4] = {
+        _mm_unpacklo_epi16(m16lo, m16lo), _mm_unpackhi_epi16(m16lo, m16lo),
+        _mm_unpacklo_epi16(m16hi, m16hi), _mm_unpackhi_epi16(m16hi, m16hi)
+    };
+    __m128i zero[4];
+
+    for (int q = 0; q < 4; q++) {
+        __m128i *p = (__m128i*)&left[q * 4];
+        __m128i v = _mm_add_epi32(_mm_load_si128(p), m32[q]);
+
+        _mm_store_si128(p, v);
+        zero[q] = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+    }
+
+    __m128i done = _mm_packs_epi16(_mm_packs_epi32(zero[0], zero[1]), _mm_packs_epi32(zero[2], zero[3]));
+    return _mm_movemask_epi8(done) & mask;
+}
+
+#else
+
+static uint32_t lanes_tick(struct chip8_lanes *l, uint32_t mask, uint32_t *left) {
+    uint32_t done = 0;
+
+    for (uint32_t bits = mask; bits; bits &= bits - 1) {
+        int k = __builtin_ctz(bits);
+
+        if (--l->tick_left[k] == 0) {
+            l->tick_left[k] = l->ipf[k];
+
+            if (l->delay_timer[k] > 0) {
+                l->delay_timer[k] --;
+            }
+
+            if (l->sound_timer[k] > 0) {
+                l->sound_timer[k] --;
+
+                if (l->sound_timer[k] == 0) {
+                    l->m[k]->beep_flag = 1;
+                }
+            }
+        }
+
+        if (--left[k] == 0) {
+            done |= 1u << k;
+        }
+    }
+
+    return done;
+}
+
+#endif
+
+/**
+ * Executes an opcode on one lane, working on its column of registers in place
+ * for the common instructions and going through the reference interpreter for
+ * everything else
+ * @return {int} The outcome of the execution
+ */
+static int lanes_scalar(struct chip8_lanes *l, int k, enum chip8_op op, uint16_t opcode) {
+    struct chip8_machine *m = l->m[k];
+    uint8_t x = OP_X(opcode), y = OP_Y(opcode);
+    uint8_t *vf = &l->v[0xF][k];
+
+    switch (op) {
+        case CHIP8_OP_CLS:
+            chip8_clear(m);
+            break;
+
+        case CHIP8_OP_RET:
+            l->pc[k] = m->stack[m->sp];
+            m->sp--;
+            break;
+
+        case CHIP8_OP_CALL:
+            m->sp++;
+            m->stack[m->sp] = l->pc[k];
+            l->pc[k] = OP_NNN(opcode);
+            return 0;
+
+        case CHIP8_OP_JP_V0:
+            l->pc[k] = OP_NNN(opcode) + l->v[0][k];
+            return 0;
+
+        case CHIP8_OP_RND:
+            l->v[x][k] = (chip8_random(m) % 0xFF) & OP_NN(opcode);
+            break;
+
+        case CHIP8_OP_DRW: {
+            *vf = 0;
+
+            int rX = l->v[x][k] % VIDEO_WIDTH;
+            int rY = l->v[y][k];
+            uint64_t collision = 0;
+
+            for (int yy = 0; yy < OP_N(opcode); yy ++) {
+                uint64_t row = chip8_sprite_row(m->memory[l->i[k] + yy], rX);
+                uint64_t *line = &m->display[(rY + yy) % VIDEO_HEIGHT];
+
+                collision |= *line & row;
+                *line ^= row;
+                m->dirty_rows |= (uint32_t)(row != 0) << ((rY + yy) % VIDEO_HEIGHT);
+            }
+
+            *vf = collision != 0;
+            m->draw_flag = 1;
+            break;
+        }
+
+        case CHIP8_OP_SKP:
+            l->pc[k] += m->key[l->v[x][k]] == 1 ? 4 : 2;
+            return 0;
+
+        case CHIP8_OP_SKNP:
+            l->pc[k] += m->key[l->v[x][k]] == 0 ? 4 : 2;
+            return 0;
+
+        case CHIP8_OP_LD_VX_DT:
+            l->v[x][k] = l->delay_timer[k];
+            break;
+
+        case CHIP8_OP_LD_DT_VX:
+            l->delay_timer[k] = l->v[x][k];
+            break;
+
+        case CHIP8_OP_LD_ST_VX:
+            l->sound_timer[k] = l->v[x][k];
+            m->beep_flag = 1;
+            break;
+
+        case CHIP8_OP_LD_F:
+            l->i[k] = l->v[x][k] * 5;
+            break;
+
+        case CHIP8_OP_LD_B: {
+            uint8_t vx = l->v[x][k];
+
+            chip8_touch(m, l->i[k], 3);
+            m->memory[l->i[k]] = vx / 100;
+            m->memory[l->i[k] + 1] = (vx / 10) % 10;
+            m->memory[l->i[k] + 2] = (vx % 100) % 10;
+            break;
+        }
+
+        case CHIP8_OP_LD_MEM_VX:
+            chip8_touch(m, l->i[k], x + 1);
+            for (int r = 0; r <= x; r++) {
+                m->memory[l->i[k] + r] = l->v[r][k];
+            }
+            break;
+
+        case CHIP8_OP_LD_VX_MEM:
+            for (int r = 0; r <= x; r++) {
+                l->v[r][k] = m->memory[l->i[k] + r];
+            }
+            break;
+
+        default: {
+            lanes_store_lane(l, k);
+            int rc = chip8_execute(m, opcode);
+            lanes_load_lane(l, k);
+
+            return rc;
+        }
+    }
+
+    l->pc[k] += 2;
+    return 0;
+}
+
+#if defined(__SSE2__)
+
+static inline __m128i lanes_blend(__m128i mask, __m128i updated, __m128i old) {
+    return _mm_or_si128(_mm_and_si128(mask, updated), _mm_andnot_si128(mask, old));
+}
+
+/**
+ * Executes one opcode on every masked lane at once
+ * @return {int} 1 when the opcode was executed, 0 when it has no vector form
+ */
+static int lanes_vector(struct chip8_lanes *l, uint32_t mask, enum chip8_op op, uint16_t opcode) {
+    uint8_t x = OP_X(opcode), y = OP_Y(opcode);
+    __m128i m8 = lanes_mask8(mask);
+    __m128i m16lo = _mm_unpacklo_epi8(m8, m8);
+    __m128i m16hi = _mm_unpackhi_epi8(m8, m8);
+
+    __m128i *px = (__m128i*)l->v[x];
+    __m128i *pf = (__m128i*)l->v[0xF];
+    __m128i *pi = (__m128i*)l->i;
+    __m128i *ppc = (__m128i*)l->pc;
+
+    __m128i vx = _mm_load_si128(px);
+    __m128i vy = _mm_load_si128((const __m128i*)l->v[y]);
+    __m128i one = _mm_set1_epi8(1);
+    __m128i flag, result;
+
+    // flag-setting instructions that alias VF keep their ordering through the scalar path
+    switch (op) {
+        case CHIP8_OP_ADD_REG:
+        case CHIP8_OP_SUB:
+        case CHIP8_OP_SUBN:
+        case CHIP8_OP_SHR:
+        case CHIP8_OP_SHL:
+            if (x == 0xF || y == 0xF) {
+                return 0;
+            }
+            break;
+        default:
+            break;
+    }
+
+    switch (op) {
+        case CHIP8_OP_LD_BYTE:
+            _mm_store_si128(px, lanes_blend(m8, _mm_set1_epi8(OP_NN(opcode)), vx));
+            break;
+        case CHIP8_OP_ADD_BYTE:
+            _mm_store_si128(px, lanes_blend(m8, _mm_add_epi8(vx, _mm_set1_epi8(OP_NN(opcode))), vx));
+            break;
+        case CHIP8_OP_LD_REG:
+            _mm_store_si128(px, lanes_blend(m8, vy, vx));
+            break;
+        case CHIP8_OP_OR:
+            _mm_store_si128(px, lanes_blend(m8, _mm_or_si128(vx, vy), vx));
+            break;
+        case CHIP8_OP_AND:
+            _mm_store_si128(px, lanes_blend(m8, _mm_and_si128(vx, vy), vx));
+            break;
+        case CHIP8_OP_XOR:
+            _mm_store_si128(px, lanes_blend(m8, _mm_xor_si128(vx, vy), vx));
+            break;
+        case CHIP8_OP_ADD_REG:
+            // carry out of the byte when the wrapped sum is smaller than Vx
+            result = _mm_add_epi8(vx, vy);
+            flag = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(vx, result), result), one);
+            _mm_store_si128(pf, lanes_blend(m8, flag, _mm_load_si128(pf)));
+            _mm_store_si128(px, lanes_blend(m8, result, vx));
+            break;
+        case CHIP8_OP_SUB:
+            // not borrow when Vx > Vy, that is, when max(Vx, Vy) != Vy
+            flag = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(vx, vy), vy), one);
+            _mm_store_si128(pf, lanes_blend(m8, flag, _mm_load_si128(pf)));
+            _mm_store_si128(px, lanes_blend(m8, _mm_sub_epi8(vx, vy), vx));
+            break;
+        case CHIP8_OP_SUBN:
+            flag = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_max_epu8(vx, vy), vx), one);
+            _mm_store_si128(pf, lanes_blend(m8, flag, _mm_load_si128(pf)));
+            _mm_store_si128(px, lanes_blend(m8, _mm_sub_epi8(vy, vx), vx));
+            break;
+        case CHIP8_OP_SHR:
+            flag = _mm_and_si128(vx, one);
+            _mm_store_si128(pf, lanes_blend(m8, flag, _mm_load_si128(pf)));
+            result = _mm_and_si128(_mm_srli_epi16(vx, 1), _mm_set1_epi8(0x7F));
+            _mm_store_si128(px, lanes_blend(m8, result, vx));
+            break;
+        case CHIP8_OP_SHL:
+            flag = _mm_and_si128(_mm_srli_epi16(vx, 7), one);
+            _mm_store_si128(pf, lanes_blend(m8, flag, _mm_load_si128(pf)));
+            _mm_store_si128(px, lanes_blend(m8, _mm_add_epi8(vx, vx), vx));
+            break;
+        case CHIP8_OP_SE_BYTE:
+        case CHIP8_OP_SNE_BYTE:
+        case CHIP8_OP_SE_REG:
+        case CHIP8_OP_SNE_REG: {
+            __m128i other = op == CHIP8_OP_SE_BYTE || op == CHIP8_OP_SNE_BYTE ? _mm_set1_epi8(OP_NN(opcode)) : vy;
+            __m128i taken = _mm_cmpeq_epi8(vx, other);
+
+            if (op == CHIP8_OP_SNE_BYTE || op == CHIP8_OP_SNE_REG) {
+                taken = _mm_xor_si128(taken, _mm_set1_epi8(-1));
+            }
+
+            // advance by 2, plus 2 more on the lanes that skip
+            __m128i two = _mm_set1_epi16(2);
+            __m128i lo = _mm_load_si128(&ppc[0]);
+            __m128i hi = _mm_load_si128(&ppc[1]);
+            __m128i step_lo = _mm_add_epi16(two, _mm_and_si128(_mm_unpacklo_epi8(taken, taken), two));
+            __m128i step_hi = _mm_add_epi16(two, _mm_and_si128(_mm_unpackhi_epi8(taken, taken), two));
+
+            _mm_store_si128(&ppc[0], lanes_blend(m16lo, _mm_add_epi16(lo, step_lo), lo));
+            _mm_store_si128(&ppc[1], lanes_blend(m16hi, _mm_add_epi16(hi, step_hi), hi));
+            return 1;
+        }
+        case CHIP8_OP_JP: {
+            __m128i target = _mm_set1_epi16(OP_NNN(opcode));
+            _mm_store_si128(&ppc[0], lanes_blend(m16lo, target, _mm_load_si128(&ppc[0])));
+            _mm_store_si128(&ppc[1], lanes_blend(m16hi, target, _mm_load_si128(&ppc[1])));
+            return 1;
+        }
+        case CHIP8_OP_LD_I: {
+            __m128i target = _mm_set1_epi16(OP_NNN(opcode));
+            _mm_store_si128(&pi[0], lanes_blend(m16lo, target, _mm_load_si128(&pi[0])));
+            _mm_store_si128(&pi[1], lanes_blend(m16hi, target, _mm_load_si128(&pi[1])));
+            break;
+        }
+        case CHIP8_OP_ADD_I: {
+            __m128i zero = _mm_setzero_si128();
+            __m128i lo = _mm_load_si128(&pi[0]);
+            __m128i hi = _mm_load_si128(&pi[1]);
+            _mm_store_si128(&pi[0], lanes_blend(m16lo, _mm_add_epi16(lo, _mm_unpacklo_epi8(vx, zero)), lo));
+            _mm_store_si128(&pi[1], lanes_blend(m16hi, _mm_add_epi16(hi, _mm_unpackhi_epi8(vx, zero)), hi));
+            break;
+        }
+        default:
+            return 0;
+    }
+
+    // everything that fell through simply moves on to the next instruction
+    __m128i two = _mm_set1_epi16(2);
+    __m128i lo = _mm_load_si128(&ppc[0]);
+    __m128i hi = _mm_load_si128(&ppc[1]);
+    _mm_store_si128(&ppc[0], lanes_blend(m16lo, _mm_add_epi16(lo, two), lo));
+    _mm_store_si128(&ppc[1], lanes_blend(m16hi, _mm_add_epi16(hi, two), hi));
+
+    return 1;
+}
+
+#else
+
+static int lanes_vector(struct chip8_lanes *l, uint32_t mask, enum chip8_op op, uint16_t opcode) {
+    // without SSE2 every lane runs through the reference interpreter
+    (void)l; (void)mask; (void)op; (void)opcode;
+    return 0;
+}
+
+#endif
+
+/**
+ * Runs a single lane through the reference interpreter until its program
+ * counter meets enough other running lanes, its budget runs out or it halts
+ * @param {uint32_t} active The lanes still running in this chunk
+ * @param {int} quorum The number of other lanes worth meeting
+ * @param {int} k The lane to run
+ * @param {uint32_t*} left The remaining budget of the lane
+ * @param {uint64_t} end The cycle at which the budget runs out
+ * @return {int} 1 when the lane stopped running
+ */
+static int lanes_solo(struct chip8_lanes *l, struct lanes_run *run, uint32_t active, int quorum, int k,
+                      uint32_t *left, uint64_t end) {
+    struct chip8_machine *m = l->m[k];
+    const struct chip8_script *s = run->scripts ? run->scripts[k] : NULL;
+    uint32_t others = active & ~(1u << k);
+    int stopped = 0;
+
+    lanes_store_lane(l, k);
+    m->cycles = end - *left;
+
+    while (*left > 0) {
+        if (others && __builtin_popcount(lanes_at(l, m->pc) & others) >= quorum) {
+            break;
+        }
+
+        if (s && m->cycles >= run->next_event[k]) {
+            run->cursor[k] = chip8_script_apply(s, run->cursor[k], m);
+            run->next_event[k] = run->cursor[k] < s->count ? s->events[run->cursor[k]].cycle : UINT64_MAX;
+        }
+
+        uint16_t pc = m->pc;
+        uint16_t opcode = chip8_fetch(m);
+        int rc = chip8_execute(m, opcode);
+
+        --*left;
+
+        if (rc < 0) {
+            l->halt[k] = CHIP8_HALT_ERROR;
+            l->status[k] = rc;
+            stopped = 1;
+            break;
+        }
+
+        if ((opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == pc) {
+            l->halt[k] = CHIP8_HALT_LOOP;
+            stopped = 1;
+            break;
+        }
+
+        if ((opcode & 0xF0FF) == 0xF033 || (opcode & 0xF0FF) == 0xF055) {
+            run->shared &= ~(1u << k);
+        }
+    }
+
+    lanes_load_lane(l, k);
+
+    if (stopped) {
+        run->active &= ~(1u << k);
+    }
+
+    return stopped || *left == 0;
+}
+
+/**
+ * Runs every running lane for at most one chunk of cycles
+ * @param {uint32_t} chunk The cycles each lane may execute in this chunk
+ */
+static void lanes_run_chunk(struct chip8_lanes *l, struct lanes_run *run, uint32_t chunk) {
+    const uint8_t *decode = chip8_decode_table();
+    _Alignas(16) uint32_t left[CHIP8_LANES];
+    uint64_t base[CHIP8_LANES];
+    uint32_t active = run->active;
+    uint32_t mask = 0;
+
+    for (int k = 0; k < CHIP8_LANES; k++) {
+        left[k] = chunk;
+        base[k] = k < l->count ? l->cycles[k] : 0;
+    }
+
+    while (active) {
+        // follow the group stepped last while it holds at least half of the
+        // running lanes, otherwise regroup behind the most popular address
+        uint32_t group = mask & active ? lanes_at(l, l->pc[__builtin_ctz(mask & active)]) & active : 0;
+
+        if (__builtin_popcount(group) * 2 < __builtin_popcount(active)) {
+            for (uint32_t rest = active & ~group; rest; ) {
+                uint32_t candidate = lanes_at(l, l->pc[__builtin_ctz(rest)]) & active;
+
+                if (__builtin_popcount(candidate) > __builtin_popcount(group)) {
+                    group = candidate;
+                }
+
+                rest &= ~candidate;
+            }
+        }
+
+        int lead = __builtin_ctz(group);
+
+        // lockstep does not pay for itself on a small group; run its lead lane
+        // on its own until it meets a group worth joining
+        int quorum = __builtin_popcount(active) / 4;
+        if (__builtin_popcount(group) <= (quorum > 1 ? quorum : 1)) {
+            if (lanes_solo(l, run, active, quorum > 1 ? quorum : 1, lead, &left[lead], base[lead] + chunk)) {
+                active &= ~(1u << lead);
+            }
+
+            mask = 0;
+            continue;
+        }
+
+        uint16_t pc = l->pc[lead];
+        uint16_t opcode = lanes_opcode(l, lead);
+
+        // lanes still holding the shared image have the same opcode at pc;
+        // the others may have overwritten it
+        mask = group;
+        for (uint32_t bits = run->shared & (1u << lead) ? group & ~run->shared : group; bits; bits &= bits - 1) {
+            int k = __builtin_ctz(bits);
+
+            if (lanes_opcode(l, k) != opcode) {
+                mask &= ~(1u << k);
+            }
+        }
+
+        if (run->scripted) {
+            for (uint32_t bits = mask; bits; bits &= bits - 1) {
+                int k = __builtin_ctz(bits);
+                uint64_t cycles = base[k] + chunk - left[k];
+
+                if (cycles >= run->next_event[k]) {
+                    const struct chip8_script *s = run->scripts[k];
+                    size_t *cursor = &run->cursor[k];
+
+                    while (*cursor < s->count && s->events[*cursor].cycle <= cycles) {
+                        l->m[k]->key[s->events[*cursor].key] = s->events[*cursor].down;
+                        (*cursor)++;
+                    }
+
+                    run->next_event[k] = *cursor < s->count ? s->events[*cursor].cycle : UINT64_MAX;
+                }
+            }
+        }
+
+        uint32_t exhausted = lanes_tick(l, mask, left);
+        enum chip8_op op = decode[opcode];
+
+        if (op == CHIP8_OP_LD_B || op == CHIP8_OP_LD_MEM_VX) {
+            run->shared &= ~mask;
+        }
+
+        // instructions a lane's quirk profile changes have no lane form; each
+        // lane runs them through its own profile of chip8_execute()
+        enum chip8_op form = l->quirky >> op & 1 ? CHIP8_OP_UNKNOWN : op;
+
+        if ((mask & (mask - 1)) == 0 || !lanes_vector(l, mask, form, opcode)) {
+            for (uint32_t bits = mask; bits; bits &= bits - 1) {
+                int k = __builtin_ctz(bits);
+                int rc = lanes_scalar(l, k, form, opcode);
+
+                if (rc < 0) {
+                    l->halt[k] = CHIP8_HALT_ERROR;
+                    l->status[k] = rc;
+                    active &= ~(1u << k);
+                    run->active &= ~(1u << k);
+                }
+            }
+        }
+
+        if (op == CHIP8_OP_JP && OP_NNN(opcode) == pc) {
+            for (uint32_t bits = mask & active; bits; bits &= bits - 1) {
+                l->halt[__builtin_ctz(bits)] = CHIP8_HALT_LOOP;
+            }
+
+            active &= ~mask;
+            run->active &= ~mask;
+        }
+
+        active &= ~exhausted;
+    }
+
+    for (int k = 0; k < l->count; k++) {
+        l->cycles[k] = base[k] + chunk - left[k];
+    }
+}
+
+int chip8_lanes_run(struct chip8_lanes *l, const struct chip8_script *const *scripts, uint64_t max_cycles) {
+    if (l == NULL) {
+        return -1;
+    }
+
+    struct lanes_run run;
+    memset(&run, 0, sizeof(run));
+    run.scripts = scripts;
+
+    for (int k = 0; k < l->count; k++) {
+        const struct chip8_script *s = scripts ? scripts[k] : NULL;
+
+        run.next_event[k] = s && s->count ? s->events[0].cycle : UINT64_MAX;
+        run.scripted |= s && s->count;
+        run.active |= 1u << k;
+
+        if (memcmp(l->m[k]->memory, l->m[0]->memory, sizeof(l->m[0]->memory)) == 0) {
+            run.shared |= 1u << k;
+        }
+
+        l->halt[k] = CHIP8_HALT_CYCLES;
+        l->status[k] = 0;
+    }
+
+    // budgets are counted down in 32-bit lanes, so long runs go in chunks
+    while (max_cycles > 0 && run.active) {
+        uint32_t chunk = max_cycles > 0x40000000 ? 0x40000000 : (uint32_t)max_cycles;
+
+        lanes_run_chunk(l, &run, chunk);
+        max_cycles -= chunk;
+    }
+
+    return 0;
+}
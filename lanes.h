@@ -0,0 +1,63 @@
+#ifndef __chip8_lanes_h_
+
+#define __chip8_lanes_h_
+
+#include "machine.h"
+#include "script.h"
+#include "runner.h"
+
+/* number of machines stepped in lockstep; one SSE register of 8-bit lanes */
+#define CHIP8_LANES     16
+
+/**
+ * Structure-of-arrays view of up to CHIP8_LANES machines
+ *
+ * The registers and timers of every lane live side by side so that one vector
+ * instruction updates all lanes at once. Memory, stack, display and keys stay
+ * in each lane's own machine.
+ */
+struct chip8_lanes {
+    _Alignas(16) uint8_t v[16][CHIP8_LANES]; /* general registers, one row per register */
+    _Alignas(16) uint16_t i[CHIP8_LANES];    /* index registers */
+    _Alignas(16) uint16_t pc[CHIP8_LANES];   /* program counters */
+    _Alignas(16) uint8_t delay_timer[CHIP8_LANES]; /* delay counters */
+    _Alignas(16) uint8_t sound_timer[CHIP8_LANES]; /* sound beep timers */
+    _Alignas(16) uint16_t tick_left[CHIP8_LANES]; /* instructions left until each timer tick */
+    _Alignas(16) uint16_t ipf[CHIP8_LANES];  /* instructions per timer tick */
+    uint64_t cycles[CHIP8_LANES];    /* cycle counts */
+
+    struct chip8_machine *m[CHIP8_LANES]; /* the machine behind each lane */
+    int count;                       /* lanes in use */
+    uint64_t quirky;                 /* instruction classes some lane's quirk profile changes */
+
+    enum chip8_halt halt[CHIP8_LANES]; /* why each lane stopped */
+    int status[CHIP8_LANES];         /* result of each lane's last step */
+};
+
+/**
+ * Gathers the registers of the given machines into lanes
+ * @param {struct chip8_lanes*} l The lanes to fill
+ * @param {struct chip8_machine**} machines The machines, one per lane
+ * @param {int} count The number of machines (1 - CHIP8_LANES)
+ * @return {int} The outcome of the execution
+ */
+int chip8_lanes_load(struct chip8_lanes *l, struct chip8_machine **machines, int count);
+
+/**
+ * Scatters the registers of every lane back into its machine
+ * @param {struct chip8_lanes*} l The lanes to store
+ */
+void chip8_lanes_store(struct chip8_lanes *l);
+
+/**
+ * Runs every lane for up to max_cycles cycles, stepping lanes that share a
+ * program counter together and falling back to chip8_execute() for the rest.
+ * Each lane halts on its own, as chip8_run() would.
+ * @param {struct chip8_lanes*} l The lanes to run
+ * @param {const struct chip8_script *const *} scripts One input script per lane, may be NULL
+ * @param {uint64_t} max_cycles The maximum number of cycles each lane executes
+ * @return {int} The outcome of the execution
+ */
+int chip8_lanes_run(struct chip8_lanes *l, const struct chip8_script *const *scripts, uint64_t max_cycles);
+
+#endif /* __chip8_lanes_h_ */
@@ -20,20 +20,50 @@ uint8_t font_data[] = {
 };
 
 
+static void* default_alloc(void *ctx, size_t size) {
+    (void)ctx;
+    return malloc(size);
+}
+
+static void default_release(void *ctx, void *ptr) {
+    (void)ctx;
+    free(ptr);
+}
+
+static const struct chip8_allocator default_allocator = { default_alloc, default_release, NULL };
+
 struct chip8_machine* chip8_machine_create(void) {
-    struct chip8_machine *m = malloc(sizeof(struct chip8_machine));
+    return chip8_machine_create_with(NULL);
+}
+
+struct chip8_machine* chip8_machine_create_with(const struct chip8_allocator *a) {
+    if (a == NULL) {
+        a = &default_allocator;
+    }
+
+    struct chip8_machine *m = a->alloc(a->ctx, sizeof(struct chip8_machine));
 
     if (m == NULL) {
         return NULL;
     }
 
+    chip8_machine_init(m, a);
+    chip8_seed(m, (uint32_t)clock());
+
+    return m;
+}
+
+void chip8_machine_init(struct chip8_machine *m, const struct chip8_allocator *a) {
     // start with a zero-ed machine
     memset(m, 0, sizeof(struct chip8_machine));
+    m->allocator = a ? *a : default_allocator;
     memcpy(m->memory, font_data, sizeof(font_data));
+    m->dirty_pages = 0xFFFF;
+    m->dirty_rows = 0xFFFFFFFF;
+    m->ipf = CHIP8_DEFAULT_IPF;
+    m->tick_left = CHIP8_DEFAULT_IPF;
 
-    srand(clock());
-
-    return m;
+    chip8_seed(m, 0);
 }
 
 int chip8_machine_destroy(struct chip8_machine **p) {
@@ -41,11 +71,62 @@ int chip8_machine_destroy(struct chip8_machine **p) {
         return -1;
     }
 
-    free(*p);
+    struct chip8_allocator a = (*p)->allocator;
+    a.release(a.ctx, *p);
     *p = NULL;
     return 0;
 }
 
+void chip8_seed(struct chip8_machine *m, uint32_t seed) {
+    // xorshift state must never be zero
+    m->rng = seed ? seed : 0x9E3779B9;
+}
+
+int chip8_set_ipf(struct chip8_machine *m, uint16_t ipf) {
+    if (m == NULL || ipf == 0) {
+        return -1;
+    }
+
+    m->ipf = ipf;
+    m->tick_left = ipf;
+    return 0;
+}
+
+int chip8_set_quirks(struct chip8_machine *m, enum chip8_quirks q) {
+    if (m == NULL || (unsigned)q >= CHIP8_QUIRKS_COUNT) {
+        return -1;
+    }
+
+    m->quirks = q;
+    return 0;
+}
+
+static const char *const quirks_names[CHIP8_QUIRKS_COUNT] = {
+    [CHIP8_QUIRKS_MODERN] = "modern",
+    [CHIP8_QUIRKS_VIP] = "vip",
+    [CHIP8_QUIRKS_CHIP48] = "chip48",
+    [CHIP8_QUIRKS_SCHIP] = "schip",
+    [CHIP8_QUIRKS_XOCHIP] = "xochip",
+};
+
+const char* chip8_quirks_name(enum chip8_quirks q) {
+    if ((unsigned)q >= CHIP8_QUIRKS_COUNT) {
+        return "unknown";
+    }
+
+    return quirks_names[q];
+}
+
+int chip8_quirks_parse(const char *name) {
+    for (int q = 0; q < CHIP8_QUIRKS_COUNT; q++) {
+        if (strcmp(name, quirks_names[q]) == 0) {
+            return q;
+        }
+    }
+
+    return -1;
+}
+
 void chip8_print(struct chip8_machine *m) {
     if (m == NULL) {
         return;
@@ -77,10 +158,70 @@ int chip8_load(struct chip8_machine *m, const char *filename) {
     long fsize = ftell(f);
     fseek(f, 0, SEEK_SET);
 
-    fread(m->memory + 0x200, fsize, 1, f);
+    // anything past the end of memory would overrun the machine
+    if (fsize <= 0 || fsize > CHIP8_PROGRAM_MAX || fread(m->memory + CHIP8_PROGRAM_START, fsize, 1, f) != 1) {
+        fclose(f);
+        return 0;
+    }
+
     fclose(f);
 
-    m->pc = 0x200;
+    m->pc = CHIP8_PROGRAM_START;
+    m->dirty_pages = 0xFFFF;
+    m->touched_pages = 0xFFFF;
+
+    return 1;
+}
+
+/**
+ * Loads a chip8 program held in memory into the machine
+ * @param {struct chip8_machine*} m The machine to load the program into
+ * @param {const uint8_t *} data The program image
+ * @param {size_t} size The size of the program image
+ * @return {int} The outcome of the execution
+ */
+int chip8_load_memory(struct chip8_machine *m, const uint8_t *data, size_t size) {
+    if (size > CHIP8_PROGRAM_MAX) {
+        return 0;
+    }
+
+    memcpy(m->memory + CHIP8_PROGRAM_START, data, size);
+    m->pc = CHIP8_PROGRAM_START;
+    m->dirty_pages = 0xFFFF;
+
+    if (size > 0) {
+        m->touched_pages |= (uint16_t)((2u << ((CHIP8_PROGRAM_START + size - 1) >> CHIP8_PAGE_SHIFT)) - (1u << (CHIP8_PROGRAM_START >> CHIP8_PAGE_SHIFT)));
+    }
 
     return 1;
 }
+
+/**
+ * Reads a single pixel of the display
+ * @param {const struct chip8_machine*} m The machine to read the display of
+ * @param {int} x The column of the pixel
+ * @param {int} y The row of the pixel
+ * @return {int} 1 when the pixel is set
+ */
+int chip8_display_pixel(const struct chip8_machine *m, int x, int y) {
+    return (m->display[y] >> (63 - x)) & 1;
+}
+
+/**
+ * Computes a hash of the current display contents
+ * @param {const struct chip8_machine*} m The machine to hash the display of
+ * @return {uint64_t} The FNV-1a hash of the display memory
+ */
+uint64_t chip8_display_hash(const struct chip8_machine *m) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    // hash the rows left to right so the result does not depend on byte order
+    for (int y = 0; y < VIDEO_HEIGHT; y++) {
+        for (int shift = 56; shift >= 0; shift -= 8) {
+            hash ^= (m->display[y] >> shift) & 0xFF;
+            hash *= 0x100000001B3ULL;
+        }
+    }
+
+    return hash;
+}
@@ -8,11 +8,56 @@
 #include <stdint.h>
 #include <time.h>
 
-#include <SDL2/SDL.h>
-
 #define VIDEO_WIDTH     64
 #define VIDEO_HEIGHT    32
 
+/* each display row is packed into a single 64-bit word */
+_Static_assert(VIDEO_WIDTH == 64, "display rows are packed into uint64_t");
+_Static_assert(VIDEO_HEIGHT == 32, "dirty display rows are tracked in a uint32_t");
+
+/* memory is tracked in pages so snapshots can share the untouched ones */
+#define CHIP8_PAGE_SHIFT    8
+#define CHIP8_PAGE_SIZE     (1 << CHIP8_PAGE_SHIFT)
+#define CHIP8_PAGES         (0x1000 >> CHIP8_PAGE_SHIFT)
+
+_Static_assert(CHIP8_PAGES == 16, "dirty pages are tracked in a uint16_t");
+
+/* programs load at 0x200 and may fill the rest of memory */
+#define CHIP8_PROGRAM_START 0x200
+#define CHIP8_PROGRAM_MAX   (0x1000 - CHIP8_PROGRAM_START)
+
+/* the delay and sound timers count down at 60 Hz of emulated time */
+#define CHIP8_TIMER_HZ      60
+#define CHIP8_DEFAULT_IPF   10
+
+struct chip8_profile;
+struct chip8_trace;
+struct chip8_host;
+
+/**
+ * Quirk profiles; the interpreters CHIP-8 programs were written for disagree on
+ * how a handful of instructions behave. Every engine is specialised for each
+ * profile at build time and picks the one matching the machine once per run.
+ */
+enum chip8_quirks {
+    CHIP8_QUIRKS_MODERN = 0,         /* Cowgod's reference, which this emulator always followed */
+    CHIP8_QUIRKS_VIP,                /* the original COSMAC VIP interpreter */
+    CHIP8_QUIRKS_CHIP48,             /* CHIP-48 on the HP-48 */
+    CHIP8_QUIRKS_SCHIP,              /* SUPER-CHIP 1.1 */
+    CHIP8_QUIRKS_XOCHIP,             /* XO-CHIP, as Octo runs it */
+    CHIP8_QUIRKS_COUNT
+};
+
+/**
+ * Memory allocator of a machine; everything created for the machine, such as
+ * its snapshots, comes from the same allocator
+ */
+struct chip8_allocator {
+    void* (*alloc)(void *ctx, size_t size);
+    void (*release)(void *ctx, void *ptr);
+    void *ctx;                       /* handed to both functions */
+};
+
 /*
  System memory map
  +---------------+= 0xFFF (4095) End Chip-8 RAM
@@ -51,11 +96,31 @@ struct chip8_machine {
     uint16_t sp;                     /* stack pointer */
     uint8_t delay_timer;             /* delay counter */
     uint8_t sound_timer;             /* sound beep timer */
+    uint16_t ipf;                    /* instructions per 60 Hz timer tick */
+    uint16_t tick_left;              /* instructions left until the next timer tick */
+    uint8_t quirks;                  /* quirk profile, enum chip8_quirks */
     uint8_t key[16];                 /* key states */
-    uint8_t display[(VIDEO_WIDTH * VIDEO_HEIGHT)]; /* display memory */
+    uint64_t display[VIDEO_HEIGHT];  /* display memory; one row per word, x = 0 in the top bit */
 
     uint8_t draw_flag;               /* determines if the screen needs to be redrawn */
+    uint32_t dirty_rows;             /* display rows changed since the frontend last drew, one bit each */
     uint8_t beep_flag;               /* determines if the beep needs to be played */
+
+    uint64_t cycles;                 /* number of execution cycles performed */
+    uint32_t rng;                    /* random number generator state */
+    uint16_t dirty_pages;            /* memory pages written since the last snapshot, one bit each */
+    uint16_t touched_pages;          /* memory pages written since the machine was initialised, one bit each */
+
+    struct chip8_allocator allocator; /* the machine was allocated with this */
+    const struct chip8_host *host;   /* embedding host callbacks, may be NULL */
+
+#ifdef CHIP8_PROFILE
+    struct chip8_profile *profile;   /* counts executed instructions when set */
+#endif
+
+#ifdef CHIP8_TRACE
+    struct chip8_trace *trace;       /* records executed instructions when set */
+#endif
 };
 
 /**
@@ -64,6 +129,21 @@ struct chip8_machine {
  */
 struct chip8_machine* chip8_machine_create(void);
 
+/**
+ * Creates a new chip8 machine with memory from the given allocator
+ * @param {const struct chip8_allocator*} a The allocator to use; NULL for malloc() and free()
+ * @return {struct chip8_machine*} The newly created machine
+ */
+struct chip8_machine* chip8_machine_create_with(const struct chip8_allocator *a);
+
+/**
+ * Initialises a machine in place to the state a new machine starts in; the
+ * random number generator starts from a fixed seed
+ * @param {struct chip8_machine*} m The machine to initialise
+ * @param {const struct chip8_allocator*} a The allocator of the machine; NULL for malloc() and free()
+ */
+void chip8_machine_init(struct chip8_machine *m, const struct chip8_allocator *a);
+
 /**
  * Destroys the given chip8 machine
  * @param {struct chip8_machine**} p The machine to destroy
@@ -71,6 +151,46 @@ struct chip8_machine* chip8_machine_create(void);
  */
 int chip8_machine_destroy(struct chip8_machine **p);
 
+/**
+ * Seeds the random number generator of the given machine
+ * @param {struct chip8_machine*} m The machine to seed
+ * @param {uint32_t} seed The seed; equal seeds give equal random sequences
+ */
+void chip8_seed(struct chip8_machine *m, uint32_t seed);
+
+/**
+ * Sets how many instructions the machine executes per 60 Hz timer tick, which
+ * fixes its clock at ipf * 60 Hz of emulated time. Starts a fresh tick.
+ * @param {struct chip8_machine*} m The machine to configure
+ * @param {uint16_t} ipf The number of instructions per tick; at least 1
+ * @return {int} The outcome of the execution
+ */
+int chip8_set_ipf(struct chip8_machine *m, uint16_t ipf);
+
+/**
+ * Sets the quirk profile the machine executes under. Programs should be loaded
+ * under the profile they were written for; a jit cache that ran the machine
+ * under another profile recompiles its blocks.
+ * @param {struct chip8_machine*} m The machine to configure
+ * @param {enum chip8_quirks} q The quirk profile
+ * @return {int} The outcome of the execution
+ */
+int chip8_set_quirks(struct chip8_machine *m, enum chip8_quirks q);
+
+/**
+ * Gets the name of a quirk profile
+ * @param {enum chip8_quirks} q The quirk profile
+ * @return {const char *} The name
+ */
+const char* chip8_quirks_name(enum chip8_quirks q);
+
+/**
+ * Looks a quirk profile up by name
+ * @param {const char *} name The name, as chip8_quirks_name() gives it
+ * @return {int} The quirk profile, -1 when there is none by that name
+ */
+int chip8_quirks_parse(const char *name);
+
 /**
  * Prints the given machine to stdout
  * @param {struct chip8_machine*} m The machine to print
@@ -93,6 +213,16 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode);
  */
 int chip8_load(struct chip8_machine *m, const char *path);
 
+/**
+ * Loads a chip8 program held in memory into the machine, straight from the
+ * caller's buffer; the buffer is not referenced once the call returns
+ * @param {struct chip8_machine*} m The machine to load the program into
+ * @param {const uint8_t *} data The program image
+ * @param {size_t} size The size of the program image
+ * @return {int} The outcome of the execution
+ */
+int chip8_load_memory(struct chip8_machine *m, const uint8_t *data, size_t size);
+
 /**
  * Performs one execution cylce on the machine
  * @param {struct chip8_machine*} m The machine to progress step execution
@@ -100,4 +230,20 @@ int chip8_load(struct chip8_machine *m, const char *path);
  */
 int chip8_step(struct chip8_machine *m);
 
+/**
+ * Reads a single pixel of the display
+ * @param {const struct chip8_machine*} m The machine to read the display of
+ * @param {int} x The column of the pixel
+ * @param {int} y The row of the pixel
+ * @return {int} 1 when the pixel is set
+ */
+int chip8_display_pixel(const struct chip8_machine *m, int x, int y);
+
+/**
+ * Computes a hash of the current display contents
+ * @param {const struct chip8_machine*} m The machine to hash the display of
+ * @return {uint64_t} The FNV-1a hash of the display memory
+ */
+uint64_t chip8_display_hash(const struct chip8_machine *m);
+
 #endif /* __chip8_machine_h_ */
\ No newline at end of file
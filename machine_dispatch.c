@@ -0,0 +1,143 @@
+#include "dispatch.h"
+#include "machine_ops.h"
+
+#if defined(__GNUC__)
+#define CHIP8_COMPUTED_GOTO 1
+#endif
+
+/* every handler instantiated for every profile, as chip8_op_<class>_<profile> */
+#define CHIP8_INSTANCE(id, fn, name, flags)                             \
+    static int fn##_##name(struct chip8_machine *m, uint16_t opcode) {  \
+        return fn(m, opcode, flags);                                    \
+    }
+#define CHIP8_PROFILE_INSTANCES(q, name, flags) CHIP8_OPS(CHIP8_INSTANCE, name, flags)
+CHIP8_PROFILES(CHIP8_PROFILE_INSTANCES)
+#undef CHIP8_PROFILE_INSTANCES
+#undef CHIP8_INSTANCE
+
+#define CHIP8_HANDLER(id, fn, name) [id] = fn##_##name,
+#define CHIP8_PROFILE_HANDLERS(q, name, flags) [q] = { CHIP8_OPS(CHIP8_HANDLER, name) },
+static const chip8_handler handlers[CHIP8_QUIRKS_COUNT][CHIP8_OP_COUNT] = {
+    CHIP8_PROFILES(CHIP8_PROFILE_HANDLERS)
+};
+#undef CHIP8_PROFILE_HANDLERS
+#undef CHIP8_HANDLER
+
+const chip8_handler* chip8_handlers(enum chip8_quirks q) {
+    return handlers[(unsigned)q < CHIP8_QUIRKS_COUNT ? q : CHIP8_QUIRKS_MODERN];
+}
+
+int chip8_execute_table(struct chip8_machine *m, uint16_t opcode) {
+    if (m == NULL || m->quirks >= CHIP8_QUIRKS_COUNT) {
+        return -1;
+    }
+
+    return handlers[m->quirks][chip8_decode_table()[opcode]](m, opcode);
+}
+
+int chip8_execute_threaded(struct chip8_machine *m, uint16_t opcode) {
+#if defined(CHIP8_COMPUTED_GOTO)
+#define CHIP8_LABEL(id, fn, name) [id] = &&execute_##name##_##id,
+#define CHIP8_PROFILE_LABELS(q, name, flags) [q] = { CHIP8_OPS(CHIP8_LABEL, name) },
+    static void *const labels[CHIP8_QUIRKS_COUNT][CHIP8_OP_COUNT] = {
+        CHIP8_PROFILES(CHIP8_PROFILE_LABELS)
+    };
+#undef CHIP8_PROFILE_LABELS
+#undef CHIP8_LABEL
+
+    if (m == NULL || m->quirks >= CHIP8_QUIRKS_COUNT) {
+        return -1;
+    }
+
+    goto *labels[m->quirks][chip8_decode_table()[opcode]];
+
+#define CHIP8_CASE(id, fn, name, flags) execute_##name##_##id: return fn(m, opcode, flags);
+#define CHIP8_PROFILE_CASES(q, name, flags) CHIP8_OPS(CHIP8_CASE, name, flags)
+    CHIP8_PROFILES(CHIP8_PROFILE_CASES)
+#undef CHIP8_PROFILE_CASES
+#undef CHIP8_CASE
+#else
+    return chip8_execute_table(m, opcode);
+#endif
+}
+
+int chip8_run_table(struct chip8_machine *m, uint64_t count) {
+    const uint8_t *decode = chip8_decode_table();
+
+    if (m->quirks >= CHIP8_QUIRKS_COUNT) {
+        return -1;
+    }
+
+    // the profile is picked once; the loop only ever sees its handlers
+    const chip8_handler *h = handlers[m->quirks];
+
+    for (uint64_t c = 0; c < count; c++) {
+        int self_jump = chip8_at_self_jump(m);
+        uint16_t opcode = chip8_fetch(m);
+        int rc = h[decode[opcode]](m, opcode);
+
+        if (rc < 0) {
+            return rc;
+        }
+
+        if (self_jump) {
+            return CHIP8_RUN_LOOP;
+        }
+    }
+
+    return 0;
+}
+
+int chip8_run_threaded(struct chip8_machine *m, uint64_t count) {
+#if defined(CHIP8_COMPUTED_GOTO)
+#define CHIP8_LABEL(id, fn, name) [id] = &&run_##name##_##id,
+#define CHIP8_PROFILE_LABELS(q, name, flags) [q] = { CHIP8_OPS(CHIP8_LABEL, name) },
+    static void *const profile_labels[CHIP8_QUIRKS_COUNT][CHIP8_OP_COUNT] = {
+        CHIP8_PROFILES(CHIP8_PROFILE_LABELS)
+    };
+#undef CHIP8_PROFILE_LABELS
+#undef CHIP8_LABEL
+
+    if (m->quirks >= CHIP8_QUIRKS_COUNT) {
+        return -1;
+    }
+
+    // each profile has its own copy of every handler; only its labels are reachable
+    void *const *labels = profile_labels[m->quirks];
+    const uint8_t *decode = chip8_decode_table();
+    uint64_t end = m->cycles + count;
+    uint16_t opcode;
+    int rc;
+
+    // every handler ends by fetching and jumping straight to the next one
+#define CHIP8_DISPATCH()                    \
+    do {                                    \
+        if (m->cycles == end) {             \
+            return 0;                       \
+        }                                   \
+        opcode = chip8_fetch(m);            \
+        goto *labels[decode[opcode]];       \
+    } while (0)
+
+    CHIP8_DISPATCH();
+
+    // the id test folds away in every handler but the jump
+#define CHIP8_CASE(id, fn, name, flags)                                 \
+    run_##name##_##id:                                                  \
+        if (id == CHIP8_OP_JP && OP_NNN(opcode) == m->pc) {             \
+            fn(m, opcode, flags);                                       \
+            return CHIP8_RUN_LOOP;                                      \
+        }                                                               \
+        if ((rc = fn(m, opcode, flags)) < 0) {                          \
+            return rc;                                                  \
+        }                                                               \
+        CHIP8_DISPATCH();
+#define CHIP8_PROFILE_CASES(q, name, flags) CHIP8_OPS(CHIP8_CASE, name, flags)
+    CHIP8_PROFILES(CHIP8_PROFILE_CASES)
+#undef CHIP8_PROFILE_CASES
+#undef CHIP8_CASE
+#undef CHIP8_DISPATCH
+#else
+    return chip8_run_table(m, count);
+#endif
+}
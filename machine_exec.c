@@ -1,4 +1,15 @@
 #include "machine.h"
+#include "machine_ops.h"
+#include "dispatch.h"
+
+/* the dispatch engine used by chip8_step() is chosen at build time */
+#if defined(CHIP8_DISPATCH_THREADED)
+#define CHIP8_EXECUTE chip8_execute_threaded
+#elif defined(CHIP8_DISPATCH_TABLE)
+#define CHIP8_EXECUTE chip8_execute_table
+#else
+#define CHIP8_EXECUTE chip8_execute
+#endif
 
 /**
  * Performs one execution cylce on the machine
@@ -6,35 +17,20 @@
  * @return {int} The outcome of the execution
  */
 int chip8_step(struct chip8_machine *m) {
-    if (m->delay_timer > 0) {
-        m->delay_timer --;
-    }
-
-    if (m->sound_timer > 0) {
-        m->sound_timer --;
-
-        if (m->sound_timer == 0) {
-            m->beep_flag = 1;
-        }
-    }
-
-    // pull the next opcode
-    uint16_t opcode = m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+    uint16_t opcode = chip8_fetch(m);
 
-    return chip8_execute(m, opcode);
+    return CHIP8_EXECUTE(m, opcode);
 }
 
 /**
- * Executes the given opcode on the machine
+ * Executes the given opcode under one quirk profile; quirks is always a
+ * constant, so the quirk tests fold away in each copy
  * @param {struct chip8_machine*} m The machine to execute the opcode on
  * @param {uint16_t} opcode The opcode to execute
+ * @param {unsigned} quirks The CHIP8_QUIRK_ flags of the profile
  * @return {int} The outcome of the execution
  */
-int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
-    if (m == NULL) {
-        return -1;
-    }
-
+static CHIP8_SPECIALISE int chip8_execute_quirks(struct chip8_machine *m, uint16_t opcode, const unsigned quirks) {
     // isolate the nibbles
     uint8_t n    = (opcode>>0) & 0xF;
     uint8_t y    = (opcode>>4) & 0xF;
@@ -47,7 +43,7 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
         case 0x0:
             switch (nn) {
                 case 0xE0: // clear the display (cls)
-                    memset(m->display, 0, sizeof(m->display));
+                    chip8_clear(m);
                     m->pc += 2;
                     break;
                 case 0xEE: // return from subroutine (ret)
@@ -115,16 +111,25 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
 
                 case 0x1: // set Vx = Vx | Vy (or Vx, Vy)
                     m->v[x] |= m->v[y];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        m->v[0xF] = 0;
+                    }
                     m->pc += 2;
                     break;
 
                 case 0x2: // set Vx = Vx & Vy (and Vx, Vy)
                     m->v[x] &= m->v[y];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        m->v[0xF] = 0;
+                    }
                     m->pc += 2;
                     break;
 
                 case 0x3: // set Vx = Vx ^ Vy (xor Vx, Vy)
                     m->v[x] ^= m->v[y];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        m->v[0xF] = 0;
+                    }
                     m->pc += 2;
                     break;
 
@@ -151,8 +156,15 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
                     break;
 
                 case 0x6: // set Vx = Vx >> 1 (shr Vx {, Vy})
-                    m->v[0xF] = m->v[x] & 0x1;
-                    m->v[x] >>= 1;
+                    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+                        // set Vx = Vy >> 1 instead; the flag is written last
+                        uint8_t vy = m->v[y];
+                        m->v[x] = vy >> 1;
+                        m->v[0xF] = vy & 0x1;
+                    } else {
+                        m->v[0xF] = m->v[x] & 0x1;
+                        m->v[x] >>= 1;
+                    }
                     m->pc += 2;
                     break;
 
@@ -168,8 +180,14 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
                     break;
 
                 case 0xE: // set Vx = Vx << 1 (shl Vx {, Vy})
-                    m->v[0xF] = m->v[x] >> 7;
-                    m->v[x] <<= 1;
+                    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+                        uint8_t vy = m->v[y];
+                        m->v[x] = vy << 1;
+                        m->v[0xF] = vy >> 7;
+                    } else {
+                        m->v[0xF] = m->v[x] >> 7;
+                        m->v[x] <<= 1;
+                    }
                     m->pc += 2;
                     break;
 
@@ -193,12 +211,12 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
             m->pc += 2;
             break;
 
-        case 0xB: // jump to address nnn + V0 (jp V0, addr)
-            m->pc = nnn + m->v[0];
+        case 0xB: // jump to address nnn + V0 (jp V0, addr), or to xnn + Vx
+            m->pc = nnn + m->v[quirks & CHIP8_QUIRK_JUMP_VX ? x : 0];
             break;
 
         case 0xC: // set Vx = random byte AND nn (rnd Vx, byte)
-            m->v[x] = (rand() % 0xFF) & nn;
+            m->v[x] = (chip8_random(m) % 0xFF) & nn;
             m->pc += 2;
             break;
 
@@ -206,25 +224,26 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
             m->v[0xF] = 0;
 
             int height = n;
-            int rX = m->v[x];
-            int rY = m->v[y];
+            int rX = m->v[x] % VIDEO_WIDTH;
+            int rY = m->v[y] % VIDEO_HEIGHT;
+
+            // clipped sprites lose the rows past the bottom edge
+            if ((quirks & CHIP8_QUIRK_CLIP) && height > VIDEO_HEIGHT - rY) {
+                height = VIDEO_HEIGHT - rY;
+            }
 
+            // each sprite row is rotated (or, clipped, shifted) into place and XORed in as one word
             for (int yy = 0; yy < height; yy ++) {
-                uint8_t curPix = m->memory[m->i + yy];
-                for (int xx = 0; xx < 8; xx ++) {
-                    if (curPix & 0x80) {
-                        int curX = (rX + xx) % 64;
-                        int curY = (rY + yy) % 32;
-                        int curPos = curY * 64 + curX;
-
-                        if (m->display[curPos] == 1) {
-                            m->v[0xF] = 1;
-                        }
+                uint8_t sprite = m->memory[m->i + yy];
+                uint64_t row = quirks & CHIP8_QUIRK_CLIP ? (uint64_t)sprite << 56 >> rX : chip8_sprite_row(sprite, rX);
+                uint64_t *line = &m->display[(rY + yy) % VIDEO_HEIGHT];
 
-                        m->display[curPos] ^= 1;
-                    }
-                    curPix <<= 1;
+                if (*line & row) {
+                    m->v[0xF] = 1;
                 }
+
+                *line ^= row;
+                m->dirty_rows |= (uint32_t)(row != 0) << ((rY + yy) % VIDEO_HEIGHT);
             }
 
             m->draw_flag = 1;
@@ -295,6 +314,7 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
                     break;
 
                 case 0x33: // store BCD representation of Vx in memory locations I, I+1, and I+2 (ld B, Vx)
+                    chip8_touch(m, m->i, 3);
                     m->memory[m->i] = m->v[x] / 100;
                     m->memory[m->i + 1] = (m->v[x] / 10) % 10;
                     m->memory[m->i + 2] = (m->v[x] % 100) % 10;
@@ -302,9 +322,11 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
                     break;
 
                 case 0x55: // store registers V0 through Vx in memory starting at location I (ld [I], Vx)
+                    chip8_touch(m, m->i, x + 1);
                     for (int i = 0; i <= x; i++) {
                         m->memory[m->i + i] = m->v[i];
                     }
+                    m->i += chip8_quirk_load_i(opcode, quirks);
                     m->pc += 2;
                     break;
 
@@ -312,6 +334,7 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
                     for (int i = 0; i <= x; i++) {
                         m->v[i] = m->memory[m->i + i];
                     }
+                    m->i += chip8_quirk_load_i(opcode, quirks);
                     m->pc += 2;
                     break;
 
@@ -326,4 +349,56 @@ int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+/**
+ * Executes the given opcode on the machine, under the machine's quirk profile
+ * @param {struct chip8_machine*} m The machine to execute the opcode on
+ * @param {uint16_t} opcode The opcode to execute
+ * @return {int} The outcome of the execution
+ */
+int chip8_execute(struct chip8_machine *m, uint16_t opcode) {
+    if (m == NULL) {
+        return -1;
+    }
+
+#define CHIP8_EXECUTE_CASE(id, name, flags) case id: return chip8_execute_quirks(m, opcode, flags);
+    switch (m->quirks) {
+        CHIP8_PROFILES(CHIP8_EXECUTE_CASE)
+        default:
+            return -1;
+    }
+#undef CHIP8_EXECUTE_CASE
+}
+
+/**
+ * Runs up to count cycles through the reference switch of one quirk profile
+ * @return {int} The outcome of the execution
+ */
+static CHIP8_SPECIALISE int chip8_run_quirks(struct chip8_machine *m, uint64_t count, const unsigned quirks) {
+    for (uint64_t c = 0; c < count; c++) {
+        int self_jump = chip8_at_self_jump(m);
+        uint16_t opcode = chip8_fetch(m);
+        int rc = chip8_execute_quirks(m, opcode, quirks);
+
+        if (rc < 0) {
+            return rc;
+        }
+
+        if (self_jump) {
+            return CHIP8_RUN_LOOP;
+        }
+    }
+
+    return 0;
+}
+
+int chip8_run_switch(struct chip8_machine *m, uint64_t count) {
+#define CHIP8_RUN_CASE(id, name, flags) case id: return chip8_run_quirks(m, count, flags);
+    switch (m->quirks) {
+        CHIP8_PROFILES(CHIP8_RUN_CASE)
+        default:
+            return -1;
+    }
+#undef CHIP8_RUN_CASE
+}
@@ -0,0 +1,605 @@
+#ifndef __chip8_machine_ops_h_
+
+#define __chip8_machine_ops_h_
+
+/*
+ * Instruction handlers shared by the alternate dispatch engines. Each handler
+ * mirrors the matching case of chip8_execute(), which stays the reference.
+ *
+ * Handlers take the quirks of a profile as a constant; the engines instantiate
+ * them once per profile (see CHIP8_PROFILES), so the quirk tests fold away and
+ * never branch at run time.
+ */
+
+#include "machine.h"
+#include "decode.h"
+#include "host.h"
+
+#ifdef CHIP8_PROFILE
+#include "profile.h"
+
+/* counts the instruction at the program counter into the attached profile */
+#define CHIP8_PROFILE_HIT(m, opcode)                                    \
+    do {                                                                \
+        if ((m)->profile != NULL) {                                     \
+            chip8_profile_hit((m)->profile, (m)->pc, (opcode));         \
+        }                                                               \
+    } while (0)
+#else
+#define CHIP8_PROFILE_HIT(m, opcode)    ((void)0)
+#endif
+
+#ifdef CHIP8_TRACE
+#include "trace.h"
+
+/* records the instruction at the program counter into the attached trace */
+#define CHIP8_TRACE_HIT(m, cycle, opcode)                               \
+    do {                                                                \
+        if ((m)->trace != NULL) {                                       \
+            chip8_trace_hit((m)->trace, (m), (cycle), (opcode));        \
+        }                                                               \
+    } while (0)
+#else
+#define CHIP8_TRACE_HIT(m, cycle, opcode)   ((void)0)
+#endif
+
+#define OP_N(op)    (((op)>>0) & 0xF)
+#define OP_Y(op)    (((op)>>4) & 0xF)
+#define OP_X(op)    (((op)>>8) & 0xF)
+#define OP_NN(op)   (((op)>>0) & 0xFF)
+#define OP_NNN(op)  (((op)>>0) & 0xFFF)
+
+typedef int (*chip8_handler)(struct chip8_machine *m, uint16_t opcode);
+
+/* for the code copied into every quirk profile */
+#if defined(__GNUC__)
+#define CHIP8_SPECIALISE inline __attribute__((always_inline))
+#else
+#define CHIP8_SPECIALISE inline
+#endif
+
+/* behaviours a quirk profile switches on */
+#define CHIP8_QUIRK_SHIFT_VY    0x01     /* 8XY6/8XYE shift Vy into Vx, rather than Vx in place */
+#define CHIP8_QUIRK_LOAD_I_X1   0x02     /* FX55/FX65 leave I at I + X + 1 */
+#define CHIP8_QUIRK_LOAD_I_X    0x04     /* FX55/FX65 leave I at I + X */
+#define CHIP8_QUIRK_JUMP_VX     0x08     /* BXNN jumps to XNN + VX, rather than NNN + V0 */
+#define CHIP8_QUIRK_CLIP        0x10     /* sprites are clipped at the display edges, rather than wrapped */
+#define CHIP8_QUIRK_VF_RESET    0x20     /* 8XY1/8XY2/8XY3 clear VF */
+
+/*
+ * X-macro listing every quirk profile with the name its instances take and the
+ * behaviours it switches on, in the order of enum chip8_quirks
+ */
+#define CHIP8_PROFILES(X)                                                                          \
+    X(CHIP8_QUIRKS_MODERN, modern, 0)                                                              \
+    X(CHIP8_QUIRKS_VIP,    vip,    CHIP8_QUIRK_SHIFT_VY | CHIP8_QUIRK_LOAD_I_X1 |                  \
+                                   CHIP8_QUIRK_CLIP | CHIP8_QUIRK_VF_RESET)                        \
+    X(CHIP8_QUIRKS_CHIP48, chip48, CHIP8_QUIRK_LOAD_I_X | CHIP8_QUIRK_JUMP_VX | CHIP8_QUIRK_CLIP)  \
+    X(CHIP8_QUIRKS_SCHIP,  schip,  CHIP8_QUIRK_JUMP_VX | CHIP8_QUIRK_CLIP)                         \
+    X(CHIP8_QUIRKS_XOCHIP, xochip, CHIP8_QUIRK_SHIFT_VY | CHIP8_QUIRK_LOAD_I_X1)
+
+/**
+ * Gets the behaviours a quirk profile switches on
+ * @param {enum chip8_quirks} q The quirk profile
+ * @return {unsigned} The CHIP8_QUIRK_ flags of the profile
+ */
+static inline unsigned chip8_quirk_flags(enum chip8_quirks q) {
+#define CHIP8_QUIRK_CASE(id, name, flags) case id: return flags;
+    switch (q) {
+        CHIP8_PROFILES(CHIP8_QUIRK_CASE)
+        default:
+            return 0;
+    }
+#undef CHIP8_QUIRK_CASE
+}
+
+/**
+ * Gets the handlers instantiated for a quirk profile
+ * @param {enum chip8_quirks} q The quirk profile
+ * @return {const chip8_handler*} The handlers, indexed by enum chip8_op
+ */
+const chip8_handler* chip8_handlers(enum chip8_quirks q);
+
+/**
+ * Counts the delay and sound timers down by one 60 Hz tick
+ * @param {struct chip8_machine*} m The machine to progress
+ */
+static inline void chip8_timers(struct chip8_machine *m) {
+    if (m->delay_timer > 0) {
+        m->delay_timer --;
+    }
+
+    if (m->sound_timer > 0) {
+        m->sound_timer --;
+
+        if (m->sound_timer == 0) {
+            m->beep_flag = 1;
+        }
+    }
+}
+
+/**
+ * Progresses the cycle count, and the timers once every ipf cycles, as
+ * chip8_step() does before executing
+ * @param {struct chip8_machine*} m The machine to progress
+ */
+static inline void chip8_cycle(struct chip8_machine *m) {
+    if (--m->tick_left == 0) {
+        m->tick_left = m->ipf;
+        chip8_timers(m);
+    }
+
+    m->cycles ++;
+}
+
+/**
+ * Progresses the cycle count and timers by several cycles at once
+ * @param {struct chip8_machine*} m The machine to progress
+ * @param {uint16_t} n The number of cycles to progress
+ */
+static inline void chip8_cycles(struct chip8_machine *m, uint16_t n) {
+    m->cycles += n;
+
+    while (n >= m->tick_left) {
+        n -= m->tick_left;
+        m->tick_left = m->ipf;
+        chip8_timers(m);
+    }
+
+    m->tick_left -= n;
+}
+
+/**
+ * Progresses the machine one cycle and pulls the next opcode
+ * @param {struct chip8_machine*} m The machine to fetch from
+ * @return {uint16_t} The opcode at the program counter
+ */
+static inline uint16_t chip8_fetch(struct chip8_machine *m) {
+    chip8_cycle(m);
+
+    uint16_t opcode = m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+    CHIP8_PROFILE_HIT(m, opcode);
+    CHIP8_TRACE_HIT(m, m->cycles, opcode);
+
+    return opcode;
+}
+
+/**
+ * Advances the random number generator of the machine (xorshift32), unless
+ * the host supplies the random numbers
+ * @param {struct chip8_machine*} m The machine to draw a number from
+ * @return {uint32_t} The next random number
+ */
+static inline uint32_t chip8_random(struct chip8_machine *m) {
+    if (m->host != NULL && m->host->random != NULL) {
+        return m->host->random(m->host->ctx);
+    }
+
+    uint32_t r = m->rng;
+
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+
+    return m->rng = r;
+}
+
+/**
+ * Places a sprite byte on a display row, wrapping around the right edge
+ * @param {uint8_t} sprite The sprite byte; the top bit is the leftmost pixel
+ * @param {int} x The column of the leftmost pixel (0 - 63)
+ * @return {uint64_t} The row mask to XOR onto the display
+ */
+static inline uint64_t chip8_sprite_row(uint8_t sprite, int x) {
+    uint64_t row = (uint64_t)sprite << 56;
+    return (row >> x) | (row << ((64 - x) & 63));
+}
+
+/**
+ * Records a write to memory so the next snapshot copies the pages it touched
+ * @param {struct chip8_machine*} m The machine being written to
+ * @param {uint16_t} addr The first address written
+ * @param {int} len The number of bytes written; at most one page
+ */
+static inline void chip8_touch(struct chip8_machine *m, uint16_t addr, int len) {
+    unsigned first = addr >> CHIP8_PAGE_SHIFT;
+    unsigned last = (addr + len - 1) >> CHIP8_PAGE_SHIFT;
+
+    // writes running off the end of memory are clamped onto the last page
+    first = first < CHIP8_PAGES ? first : CHIP8_PAGES - 1;
+    last = last < CHIP8_PAGES ? last : CHIP8_PAGES - 1;
+
+    m->dirty_pages |= (uint16_t)(1u << first | 1u << last);
+    m->touched_pages |= (uint16_t)(1u << first | 1u << last);
+}
+
+/**
+ * Clears the display, marking the rows that were lit as dirty
+ * @param {struct chip8_machine*} m The machine to clear the display of
+ */
+static inline void chip8_clear(struct chip8_machine *m) {
+    for (int y = 0; y < VIDEO_HEIGHT; y++) {
+        m->dirty_rows |= (uint32_t)(m->display[y] != 0) << y;
+        m->display[y] = 0;
+    }
+}
+
+/**
+ * Tests for a jump onto itself, which programs use to stop
+ * @param {const struct chip8_machine*} m The machine to test
+ * @return {int} 1 when the instruction at pc jumps to pc
+ */
+static inline int chip8_at_self_jump(const struct chip8_machine *m) {
+    uint16_t opcode = m->memory[m->pc] << 8 | m->memory[m->pc + 1];
+    return (opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == m->pc;
+}
+
+/**
+ * Measures how far FX55 and FX65 move I under a profile
+ * @param {uint16_t} op The FX55 or FX65 opcode
+ * @param {unsigned} quirks The CHIP8_QUIRK_ flags of the profile
+ * @return {uint16_t} The amount added to I
+ */
+static inline uint16_t chip8_quirk_load_i(uint16_t op, const unsigned quirks) {
+    return quirks & CHIP8_QUIRK_LOAD_I_X1 ? OP_X(op) + 1 : quirks & CHIP8_QUIRK_LOAD_I_X ? OP_X(op) : 0;
+}
+
+static inline int chip8_op_unknown(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)m; (void)op; (void)quirks;
+    return -1;
+}
+
+static inline int chip8_op_sys(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)m; (void)op; (void)quirks;
+    return -2;
+}
+
+static inline int chip8_op_cls(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)op; (void)quirks;
+    chip8_clear(m);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ret(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)op; (void)quirks;
+    m->pc = m->stack[m->sp];
+    m->sp--;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_jp(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc = OP_NNN(op);
+    return 0;
+}
+
+static inline int chip8_op_call(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->sp++;
+    m->stack[m->sp] = m->pc;
+    m->pc = OP_NNN(op);
+    return 0;
+}
+
+static inline int chip8_op_se_byte(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->v[OP_X(op)] == OP_NN(op) ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_sne_byte(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->v[OP_X(op)] != OP_NN(op) ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_se_reg(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->v[OP_X(op)] == m->v[OP_Y(op)] ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_byte(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->v[OP_X(op)] = OP_NN(op);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_add_byte(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->v[OP_X(op)] += OP_NN(op);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_reg(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->v[OP_X(op)] = m->v[OP_Y(op)];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_or(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    m->v[OP_X(op)] |= m->v[OP_Y(op)];
+    if (quirks & CHIP8_QUIRK_VF_RESET) {
+        m->v[0xF] = 0;
+    }
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_and(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    m->v[OP_X(op)] &= m->v[OP_Y(op)];
+    if (quirks & CHIP8_QUIRK_VF_RESET) {
+        m->v[0xF] = 0;
+    }
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_xor(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    m->v[OP_X(op)] ^= m->v[OP_Y(op)];
+    if (quirks & CHIP8_QUIRK_VF_RESET) {
+        m->v[0xF] = 0;
+    }
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_add_reg(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    uint8_t x = OP_X(op), y = OP_Y(op);
+    uint8_t carry = m->v[x] + m->v[y] > 0xFF;
+
+    m->v[0xF] = carry;
+    m->v[x] += m->v[y];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_sub(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    uint8_t x = OP_X(op), y = OP_Y(op);
+    uint8_t not_borrow = m->v[x] > m->v[y];
+
+    m->v[0xF] = not_borrow;
+    m->v[x] -= m->v[y];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_shr(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    uint8_t x = OP_X(op);
+
+    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+        // the flag is written last, so it wins when Vx is VF
+        uint8_t vy = m->v[OP_Y(op)];
+        m->v[x] = vy >> 1;
+        m->v[0xF] = vy & 0x1;
+    } else {
+        m->v[0xF] = m->v[x] & 0x1;
+        m->v[x] >>= 1;
+    }
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_subn(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    uint8_t x = OP_X(op), y = OP_Y(op);
+    uint8_t not_borrow = m->v[y] > m->v[x];
+
+    m->v[0xF] = not_borrow;
+    m->v[x] = m->v[y] - m->v[x];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_shl(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    uint8_t x = OP_X(op);
+
+    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+        uint8_t vy = m->v[OP_Y(op)];
+        m->v[x] = vy << 1;
+        m->v[0xF] = vy >> 7;
+    } else {
+        m->v[0xF] = m->v[x] >> 7;
+        m->v[x] <<= 1;
+    }
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_sne_reg(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->v[OP_X(op)] != m->v[OP_Y(op)] ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_i(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->i = OP_NNN(op);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_jp_v0(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    m->pc = OP_NNN(op) + m->v[quirks & CHIP8_QUIRK_JUMP_VX ? OP_X(op) : 0];
+    return 0;
+}
+
+static inline int chip8_op_rnd(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->v[OP_X(op)] = (chip8_random(m) % 0xFF) & OP_NN(op);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_drw(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    uint64_t collision = 0;
+
+    // VF is cleared before the coordinates are read, as chip8_execute() does
+    m->v[0xF] = 0;
+
+    int height = OP_N(op);
+    int rX = m->v[OP_X(op)] % VIDEO_WIDTH;
+    int rY = m->v[OP_Y(op)] % VIDEO_HEIGHT;
+
+    // clipped sprites lose the rows past the bottom edge and the pixels past the right one
+    if ((quirks & CHIP8_QUIRK_CLIP) && height > VIDEO_HEIGHT - rY) {
+        height = VIDEO_HEIGHT - rY;
+    }
+
+    for (int yy = 0; yy < height; yy ++) {
+        uint8_t sprite = m->memory[m->i + yy];
+        uint64_t row = quirks & CHIP8_QUIRK_CLIP ? (uint64_t)sprite << 56 >> rX : chip8_sprite_row(sprite, rX);
+        uint64_t *line = &m->display[(rY + yy) % VIDEO_HEIGHT];
+
+        collision |= *line & row;
+        *line ^= row;
+        m->dirty_rows |= (uint32_t)(row != 0) << ((rY + yy) % VIDEO_HEIGHT);
+    }
+
+    m->v[0xF] = collision != 0;
+    m->draw_flag = 1;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_skp(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->key[m->v[OP_X(op)]] == 1 ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_sknp(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->pc += m->key[m->v[OP_X(op)]] == 0 ? 4 : 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_vx_dt(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->v[OP_X(op)] = m->delay_timer;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_vx_k(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    for (int i = 0; i < 16; i++) {
+        if (m->key[i] == 1) {
+            m->v[OP_X(op)] = i;
+            m->pc += 2;
+            break;
+        }
+    }
+    return 0;
+}
+
+static inline int chip8_op_ld_dt_vx(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->delay_timer = m->v[OP_X(op)];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_st_vx(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->sound_timer = m->v[OP_X(op)];
+    m->beep_flag = 1;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_add_i(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->i += m->v[OP_X(op)];
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_f(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    m->i = m->v[OP_X(op)] * 5;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_b(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    (void)quirks;
+    uint8_t vx = m->v[OP_X(op)];
+
+    chip8_touch(m, m->i, 3);
+    m->memory[m->i] = vx / 100;
+    m->memory[m->i + 1] = (vx / 10) % 10;
+    m->memory[m->i + 2] = (vx % 100) % 10;
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_mem_vx(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    chip8_touch(m, m->i, OP_X(op) + 1);
+    for (int i = 0; i <= OP_X(op); i++) {
+        m->memory[m->i + i] = m->v[i];
+    }
+    m->i += chip8_quirk_load_i(op, quirks);
+    m->pc += 2;
+    return 0;
+}
+
+static inline int chip8_op_ld_vx_mem(struct chip8_machine *m, uint16_t op, const unsigned quirks) {
+    for (int i = 0; i <= OP_X(op); i++) {
+        m->v[i] = m->memory[m->i + i];
+    }
+    m->i += chip8_quirk_load_i(op, quirks);
+    m->pc += 2;
+    return 0;
+}
+
+/*
+ * X-macro listing every instruction class alongside its handler, in the
+ * order of enum chip8_op; any further arguments are handed on to X
+ */
+#define CHIP8_OPS(X, ...)                                  \
+    X(CHIP8_OP_UNKNOWN,  chip8_op_unknown,   __VA_ARGS__)  \
+    X(CHIP8_OP_SYS,      chip8_op_sys,       __VA_ARGS__)  \
+    X(CHIP8_OP_CLS,      chip8_op_cls,       __VA_ARGS__)  \
+    X(CHIP8_OP_RET,      chip8_op_ret,       __VA_ARGS__)  \
+    X(CHIP8_OP_JP,       chip8_op_jp,        __VA_ARGS__)  \
+    X(CHIP8_OP_CALL,     chip8_op_call,      __VA_ARGS__)  \
+    X(CHIP8_OP_SE_BYTE,  chip8_op_se_byte,   __VA_ARGS__)  \
+    X(CHIP8_OP_SNE_BYTE, chip8_op_sne_byte,  __VA_ARGS__)  \
+    X(CHIP8_OP_SE_REG,   chip8_op_se_reg,    __VA_ARGS__)  \
+    X(CHIP8_OP_LD_BYTE,  chip8_op_ld_byte,   __VA_ARGS__)  \
+    X(CHIP8_OP_ADD_BYTE, chip8_op_add_byte,  __VA_ARGS__)  \
+    X(CHIP8_OP_LD_REG,   chip8_op_ld_reg,    __VA_ARGS__)  \
+    X(CHIP8_OP_OR,       chip8_op_or,        __VA_ARGS__)  \
+    X(CHIP8_OP_AND,      chip8_op_and,       __VA_ARGS__)  \
+    X(CHIP8_OP_XOR,      chip8_op_xor,       __VA_ARGS__)  \
+    X(CHIP8_OP_ADD_REG,  chip8_op_add_reg,   __VA_ARGS__)  \
+    X(CHIP8_OP_SUB,      chip8_op_sub,       __VA_ARGS__)  \
+    X(CHIP8_OP_SHR,      chip8_op_shr,       __VA_ARGS__)  \
+    X(CHIP8_OP_SUBN,     chip8_op_subn,      __VA_ARGS__)  \
+    X(CHIP8_OP_SHL,      chip8_op_shl,       __VA_ARGS__)  \
+    X(CHIP8_OP_SNE_REG,  chip8_op_sne_reg,   __VA_ARGS__)  \
+    X(CHIP8_OP_LD_I,     chip8_op_ld_i,      __VA_ARGS__)  \
+    X(CHIP8_OP_JP_V0,    chip8_op_jp_v0,     __VA_ARGS__)  \
+    X(CHIP8_OP_RND,      chip8_op_rnd,       __VA_ARGS__)  \
+    X(CHIP8_OP_DRW,      chip8_op_drw,       __VA_ARGS__)  \
+    X(CHIP8_OP_SKP,      chip8_op_skp,       __VA_ARGS__)  \
+    X(CHIP8_OP_SKNP,     chip8_op_sknp,      __VA_ARGS__)  \
+    X(CHIP8_OP_LD_VX_DT, chip8_op_ld_vx_dt,  __VA_ARGS__)  \
+    X(CHIP8_OP_LD_VX_K,  chip8_op_ld_vx_k,   __VA_ARGS__)  \
+    X(CHIP8_OP_LD_DT_VX, chip8_op_ld_dt_vx,  __VA_ARGS__)  \
+    X(CHIP8_OP_LD_ST_VX, chip8_op_ld_st_vx,  __VA_ARGS__)  \
+    X(CHIP8_OP_ADD_I,    chip8_op_add_i,     __VA_ARGS__)  \
+    X(CHIP8_OP_LD_F,     chip8_op_ld_f,      __VA_ARGS__)  \
+    X(CHIP8_OP_LD_B,     chip8_op_ld_b,      __VA_ARGS__)  \
+    X(CHIP8_OP_LD_MEM_VX,chip8_op_ld_mem_vx, __VA_ARGS__)  \
+    X(CHIP8_OP_LD_VX_MEM,chip8_op_ld_vx_mem, __VA_ARGS__)
+
+#endif /* __chip8_machine_ops_h_ */
@@ -1,31 +1,331 @@
 
 #include <stdio.h>
+#include <inttypes.h>
 #include <time.h>
 #include <limits.h>
+#include <stdatomic.h>
 #include <SDL2/SDL.h>
 #include "machine.h"
 #include "interface.h"
+#include "rewind.h"
+#include "runahead.h"
+#include "inputlog.h"
+#include "scheduler.h"
+#include "frames.h"
+#include "profile.h"
+#include "trace.h"
 
+#define REWIND_SECONDS      60
+#define REWIND_BUFFER_SIZE  (4 * 1024 * 1024)
+
+/* the build points this at the repository's programs; relative to the working directory otherwise */
+#ifndef CHIP8_DEFAULT_ROM
+#define CHIP8_DEFAULT_ROM   "programs/pong.ch8"
+#endif
+
+/**
+ * State shared between the SDL thread and the emulation thread
+ */
+struct emulator {
+    struct chip8_machine *m;
+    struct chip8_rewind *rw;
+    struct chip8_runahead *ra;       /* shows frames from ticks ahead, may be NULL */
+    struct chip8_input_recorder *rec;
+    struct chip8_frames frames;      /* finished frames, emulation to SDL */
+    struct chip8_profile *profile;   /* frame counts, and instruction counts when profiling */
+    int profiling;                   /* the machine counts into the profile */
+    double speed;
+    atomic_int running;
+};
+
+/**
+ * Hands a summary of the last second to the SDL thread: the clock rate and
+ * frame rate in the window title, and the pc heatmap when profiling
+ */
+static void report(struct emulator *e, uint64_t cycles, uint64_t frames, double seconds) {
+    char title[128];
+    int len = snprintf(title, sizeof(title), "Chip8 - %.0f kc/s, %.0f fps",
+                       cycles / seconds / 1000.0, frames / seconds);
+
+    if (!e->profiling) {
+        interface_profile(title, NULL);
+        return;
+    }
+
+    uint8_t heat[0x1000];
+    struct chip8_profile_rates pr;
+
+    chip8_profile_rates(e->profile, &pr);
+    chip8_profile_heat(e->profile, heat);
+
+    uint16_t opcode = e->m->memory[pr.hottest] << 8 | e->m->memory[(pr.hottest + 1) & 0xFFF];
+    snprintf(title + len, sizeof(title) - len, ", hot 0x%03X %s", pr.hottest, chip8_op_name(chip8_decode(opcode)));
+
+    interface_profile(title, heat);
+}
+
+/**
+ * Publishes the display of a machine as the newest frame
+ */
+static void present(void *ctx, const struct chip8_machine *m) {
+    struct emulator *e = (struct emulator*)ctx;
+
+    chip8_frames_publish(&e->frames, m);
+    chip8_profile_frame(e->profile);
+}
+
+/**
+ * Emulation thread; runs the machine at the scheduler's pace and publishes a
+ * frame whenever the display changed. Talks to the SDL thread only through
+ * the frame buffer, the key mask, the running flag and the profile summaries.
+ */
+static int emulate(void *data) {
+    struct emulator *e = (struct emulator*)data;
+    struct chip8_machine *m = e->m;
+    struct chip8_scheduler sched;
+
+    chip8_scheduler_init(&sched, e->speed, chip8_now());
+
+    uint64_t report_at = chip8_now();
+    uint64_t report_cycles = m->cycles;
+    uint64_t report_frames = 0;
+
+    while (atomic_load(&e->running)) {
+        uint8_t keys[16];
+        uint16_t mask = interface_keys();
+
+        memcpy(keys, m->key, sizeof(keys));
+        for (int k = 0; k < 16; k++) {
+            m->key[k] = (mask >> k) & 1;
+        }
+
+        // key transitions apply before the next cycle, as they do on replay
+        if (e->rec) {
+            chip8_input_recorder_keys(e->rec, m->cycles, keys, m->key);
+        }
+
+        // run every tick that came due since the last pass, back to back
+        uint32_t due = chip8_scheduler_due(&sched, chip8_now());
+        int rewinding = e->rw && interface_rewinding();
+
+        for (uint32_t t = 0; t < due; t++) {
+            if (rewinding) {
+                chip8_rewind_step_back(e->rw, m);
+            } else {
+                struct chip8_run_result r;
+                chip8_scheduler_run(m, 1, &r);
+                chip8_rewind_push(e->rw, m);
+            }
+        }
+
+        if (e->ra && rewinding) {
+            chip8_runahead_reset(e->ra);
+        }
+
+        // running ahead shows the display a few ticks on from the real one,
+        // with the keys held as they are now; the real display is never shown
+        if (e->ra && due > 0 && !rewinding) {
+            m->dirty_rows = 0;
+            chip8_runahead_run(e->ra, m, present, e);
+        } else if (m->dirty_rows) {
+            m->dirty_rows = 0;
+            present(e, m);
+        }
+
+        interface_sound(m->sound_timer, e->speed);
+
+        uint64_t now = chip8_now();
+
+        if (now - report_at >= 1000000000ULL) {
+            report(e, m->cycles - report_cycles, e->profile->frames - report_frames, (now - report_at) / 1e9);
+
+            report_at = now;
+            report_cycles = m->cycles;
+            report_frames = e->profile->frames;
+        }
+
+        chip8_sleep(chip8_scheduler_wait(&sched, chip8_now()));
+    }
+
+    return 0;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-r log] [-q quirks] [-s seed] [-f ipf] [-x speed] [-a ticks] [-P profile] [-T trace] [rom]\n", name);
+    fprintf(stderr, "  -r log      record the key transitions, seed, quirks and ipf into a binary input log\n");
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_MODERN));
+    fprintf(stderr, "  -s seed     random number generator seed (default: from the clock)\n");
+    fprintf(stderr, "  -f ipf      instructions per 60 Hz timer tick (default %d)\n", CHIP8_DEFAULT_IPF);
+    fprintf(stderr, "  -x speed    speed multiplier; 0 runs uncapped (default 1)\n");
+    fprintf(stderr, "  -a ticks    run ahead this many ticks to cut input latency; 0 for none (default 0)\n");
+    fprintf(stderr, "  -P profile  write an execution profile on exit, as JSON for a .json path and CSV otherwise\n");
+    fprintf(stderr, "  -T trace    record every executed instruction into a binary trace, in builds with CHIP8_TRACE\n");
+    fprintf(stderr, "F1 shows the pc heatmap in builds with CHIP8_PROFILE\n");
+}
 
 int main(int argc, char *argv[]) {
     uint8_t interrupted = 0;
+    const char *rom_path = CHIP8_DEFAULT_ROM;
+    const char *record_path = NULL;
+    const char *profile_path = NULL;
+    const char *trace_path = NULL;
+    uint32_t seed = (uint32_t)time(NULL);
+    uint16_t ipf = CHIP8_DEFAULT_IPF;
+    int quirks = CHIP8_QUIRKS_MODERN;
+    double speed = 1.0;
+    long ahead_ticks = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-r") == 0 && a + 1 < argc) {
+            record_path = argv[++a];
+        } else if (strcmp(argv[a], "-q") == 0 && a + 1 < argc) {
+            if ((quirks = chip8_quirks_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+            seed = strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+            ipf = (uint16_t)strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-x") == 0 && a + 1 < argc) {
+            speed = strtod(argv[++a], NULL);
+        } else if (strcmp(argv[a], "-a") == 0 && a + 1 < argc) {
+            ahead_ticks = strtol(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-P") == 0 && a + 1 < argc) {
+            profile_path = argv[++a];
+        } else if (strcmp(argv[a], "-T") == 0 && a + 1 < argc) {
+            trace_path = argv[++a];
+        } else if (argv[a][0] != '-') {
+            rom_path = argv[a];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
     struct chip8_machine *m = chip8_machine_create();
-    chip8_load(m, "../programs/pong.ch8");
+
+    if (!chip8_load(m, rom_path)) {
+        fprintf(stderr, "unable to load %s\n", rom_path);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    chip8_seed(m, seed);
+    chip8_set_quirks(m, quirks);
+
+    if (chip8_set_ipf(m, ipf) < 0) {
+        usage(argv[0]);
+        chip8_machine_destroy(&m);
+        return 2;
+    }
+
+    struct chip8_input_recorder *rec = NULL;
+    if (record_path && (rec = chip8_input_recorder_open(record_path, m)) == NULL) {
+        fprintf(stderr, "unable to record to %s\n", record_path);
+    }
+
+    // one state per tick; holding backspace steps back a tick at a time. A
+    // recording follows a single timeline, so rewinding is off while recording
+    struct chip8_rewind *rw = rec ? NULL : chip8_rewind_create(REWIND_SECONDS * CHIP8_TIMER_HZ, REWIND_BUFFER_SIZE);
+
+    struct chip8_runahead *ra = NULL;
+    if (ahead_ticks > 0 && (ra = chip8_runahead_create(ahead_ticks)) == NULL) {
+        fprintf(stderr, "unable to run ahead; showing the real frames\n");
+    }
+
+    struct chip8_profile *profile = chip8_profile_create();
+
+    if (profile == NULL) {
+        fprintf(stderr, "unable to create the profile\n");
+        chip8_input_recorder_close(&rec);
+        chip8_runahead_destroy(&ra);
+        chip8_rewind_destroy(&rw);
+        chip8_machine_destroy(&m);
+        return 1;
+    }
+
+    int profiling = chip8_profile_attach(m, profile) == 0;
+
+    if (profile_path && !profiling) {
+        fprintf(stderr, "built without CHIP8_PROFILE; %s will only hold frame counts\n", profile_path);
+    }
+
+    // rewinding shows up in the trace as a jump back in cycles
+    struct chip8_trace *trace = NULL;
+    if (trace_path) {
+        if ((trace = chip8_trace_create(trace_path, 0)) == NULL) {
+            fprintf(stderr, "unable to write trace %s\n", trace_path);
+        } else if (chip8_trace_attach(m, trace) < 0) {
+            fprintf(stderr, "built without CHIP8_TRACE; not tracing\n");
+            chip8_trace_destroy(&trace);
+            remove(trace_path);
+        }
+    }
 
     interface_init();
 
+    struct emulator e = { .m = m, .rw = rw, .ra = ra, .rec = rec, .profile = profile, .profiling = profiling, .speed = speed };
+    chip8_frames_init(&e.frames);
+    atomic_init(&e.running, 1);
+
+    SDL_Thread *thread = SDL_CreateThread(emulate, "emulation", &e);
+
+    if (thread == NULL) {
+        fprintf(stderr, "unable to start the emulation thread\n");
+        interrupted = 1;
+    }
+
+    // the SDL thread only polls events and draws whatever frame is newest
     while (!interrupted) {
-        if (interface_capture_events(m) < 0) {
+        if (interface_capture_events() < 0) {
             interrupted = 1;
         }
 
-        chip8_step(m);
-        interface_draw(m);
+        interface_draw(chip8_frames_acquire(&e.frames));
 
         SDL_Delay(1);
     }
 
+    atomic_store(&e.running, 0);
+
+    if (thread != NULL) {
+        SDL_WaitThread(thread, NULL);
+    }
+
+    if (rw != NULL) {
+        struct chip8_rewind_stats st;
+        chip8_rewind_stats(rw, &st);
+
+        printf("rewind: %zu frames held, %.0f bytes per second of history\n",
+               st.frames, st.bytes_per_frame * CHIP8_TIMER_HZ);
+    }
+
+    if (ra != NULL) {
+        printf("runahead: %ld ticks, %.1f us per pass\n", ahead_ticks, chip8_runahead_pass_ns(ra) / 1e3);
+    }
+
+    if (profile_path && chip8_profile_save(profile, profile_path) < 0) {
+        fprintf(stderr, "unable to write profile %s\n", profile_path);
+    }
+
+    if (trace != NULL) {
+        struct chip8_trace_stats ts;
+
+        if (chip8_trace_finish(trace) < 0) {
+            fprintf(stderr, "unable to write trace %s\n", trace_path);
+        }
+
+        chip8_trace_stats(trace, &ts);
+        printf("trace: %" PRIu64 " records in %" PRIu64 " bytes, %" PRIu64 " stalls\n", ts.records, ts.bytes, ts.stalls);
+    }
+
     interface_destroy();
+    chip8_trace_destroy(&trace);
+    chip8_profile_destroy(&profile);
+    chip8_input_recorder_close(&rec);
+    chip8_runahead_destroy(&ra);
+    chip8_rewind_destroy(&rw);
     chip8_machine_destroy(&m);
 
     return 0;
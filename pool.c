@@ -0,0 +1,181 @@
+#include <stddef.h>
+#include "pool.h"
+
+/* distance between machines in a slab, a whole number of cache lines */
+#define POOL_STRIDE     ((sizeof(struct chip8_machine) + CHIP8_POOL_ALIGN - 1) & ~(size_t)(CHIP8_POOL_ALIGN - 1))
+
+_Static_assert(offsetof(struct chip8_machine, memory) == 0, "memory leads the machine, the registers follow it");
+
+/**
+ * Header of a slab; the machines follow it from the next cache line
+ */
+struct pool_slab {
+    struct pool_slab *next;
+};
+
+struct chip8_pool {
+    struct chip8_allocator allocator;
+    size_t per_slab;
+    struct pool_slab *slabs;         /* every slab, newest first */
+    struct chip8_machine **free;     /* stack of machines ready to hand out */
+    size_t free_count;
+    size_t capacity;
+    size_t slab_count;
+    size_t in_use;
+    size_t peak;
+    size_t acquired;
+    uint32_t seed;                   /* seeds the next machine handed out */
+    struct chip8_machine initial;    /* the state every machine starts in */
+};
+
+static size_t pool_slab_size(const struct chip8_pool *p) {
+    return sizeof(struct pool_slab) + CHIP8_POOL_ALIGN + p->per_slab * POOL_STRIDE;
+}
+
+/**
+ * Adds a slab of initialised machines to the pool
+ * @return {int} The outcome of the execution
+ */
+static int pool_grow(struct chip8_pool *p) {
+    const struct chip8_allocator *a = &p->allocator;
+    struct pool_slab *slab = a->alloc(a->ctx, pool_slab_size(p));
+    struct chip8_machine **stack = a->alloc(a->ctx, (p->capacity + p->per_slab) * sizeof(struct chip8_machine*));
+
+    if (slab == NULL || stack == NULL) {
+        if (slab != NULL) {
+            a->release(a->ctx, slab);
+        }
+
+        if (stack != NULL) {
+            a->release(a->ctx, stack);
+        }
+
+        return -1;
+    }
+
+    if (p->free != NULL) {
+        memcpy(stack, p->free, p->free_count * sizeof(struct chip8_machine*));
+        a->release(a->ctx, p->free);
+    }
+
+    p->free = stack;
+
+    uintptr_t base = ((uintptr_t)(slab + 1) + CHIP8_POOL_ALIGN - 1) & ~(uintptr_t)(CHIP8_POOL_ALIGN - 1);
+
+    // stacked backwards so the machines are handed out in address order
+    for (size_t k = p->per_slab; k-- > 0;) {
+        struct chip8_machine *m = (struct chip8_machine*)(base + k * POOL_STRIDE);
+
+        memcpy(m, &p->initial, sizeof(struct chip8_machine));
+        p->free[p->free_count++] = m;
+    }
+
+    slab->next = p->slabs;
+    p->slabs = slab;
+    p->slab_count++;
+    p->capacity += p->per_slab;
+
+    return 0;
+}
+
+struct chip8_pool* chip8_pool_create(size_t per_slab, const struct chip8_allocator *a) {
+    struct chip8_machine scratch;
+
+    if (per_slab == 0) {
+        return NULL;
+    }
+
+    // the machine's own defaults stand in for a missing allocator
+    chip8_machine_init(&scratch, a);
+
+    struct chip8_pool *p = scratch.allocator.alloc(scratch.allocator.ctx, sizeof(struct chip8_pool));
+
+    if (p == NULL) {
+        return NULL;
+    }
+
+    memset(p, 0, sizeof(struct chip8_pool));
+    memcpy(&p->initial, &scratch, sizeof(struct chip8_machine));
+    p->allocator = scratch.allocator;
+    p->per_slab = per_slab;
+    p->seed = (uint32_t)clock();
+
+    return p;
+}
+
+int chip8_pool_destroy(struct chip8_pool **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    struct chip8_allocator a = (*p)->allocator;
+
+    for (struct pool_slab *slab = (*p)->slabs, *next; slab != NULL; slab = next) {
+        next = slab->next;
+        a.release(a.ctx, slab);
+    }
+
+    if ((*p)->free != NULL) {
+        a.release(a.ctx, (*p)->free);
+    }
+
+    a.release(a.ctx, *p);
+    *p = NULL;
+    return 0;
+}
+
+struct chip8_machine* chip8_pool_acquire(struct chip8_pool *p) {
+    if (p == NULL || (p->free_count == 0 && pool_grow(p) < 0)) {
+        return NULL;
+    }
+
+    struct chip8_machine *m = p->free[--p->free_count];
+
+    // a cheap sequence in place of a clock read per machine
+    p->seed = p->seed * 747796405u + 2891336453u;
+    chip8_seed(m, p->seed);
+
+    p->acquired++;
+    p->in_use++;
+
+    if (p->in_use > p->peak) {
+        p->peak = p->in_use;
+    }
+
+    return m;
+}
+
+int chip8_pool_release(struct chip8_pool *p, struct chip8_machine *m) {
+    if (p == NULL || m == NULL || p->in_use == 0) {
+        return -1;
+    }
+
+    // only the pages the machine wrote differ from the initial image
+    for (uint16_t pages = m->touched_pages; pages != 0; pages &= pages - 1) {
+        size_t offset = (size_t)__builtin_ctz(pages) << CHIP8_PAGE_SHIFT;
+        memcpy(m->memory + offset, p->initial.memory + offset, CHIP8_PAGE_SIZE);
+    }
+
+    // everything after memory, the display included, is small enough to copy whole
+    memcpy((uint8_t*)m + sizeof(m->memory), (const uint8_t*)&p->initial + sizeof(m->memory),
+           sizeof(struct chip8_machine) - sizeof(m->memory));
+
+    p->free[p->free_count++] = m;
+    p->in_use--;
+
+    return 0;
+}
+
+void chip8_pool_seed(struct chip8_pool *p, uint32_t seed) {
+    p->seed = seed;
+}
+
+void chip8_pool_stats(const struct chip8_pool *p, struct chip8_pool_stats *st) {
+    st->slabs = p->slab_count;
+    st->capacity = p->capacity;
+    st->in_use = p->in_use;
+    st->peak = p->peak;
+    st->acquired = p->acquired;
+    st->bytes = sizeof(struct chip8_pool) + p->slab_count * pool_slab_size(p)
+                + p->capacity * sizeof(struct chip8_machine*);
+}
@@ -0,0 +1,86 @@
+#ifndef __chip8_pool_h_
+
+#define __chip8_pool_h_
+
+#include "machine.h"
+
+/* machines in a pool start on a cache line of their own */
+#define CHIP8_POOL_ALIGN    64
+
+/**
+ * Pool of machines for creating and discarding them in bulk
+ *
+ * Machines are carved out of contiguous, cache-line-aligned slabs and are
+ * initialised once, when their slab is. A released machine is put back into
+ * the state a new machine starts in by rewriting only what it changed: the
+ * memory pages it touched, the display and the registers. Acquiring one is a
+ * pop off a free list. Only writes made by the machine's own instructions, its
+ * loaders and state restores are tracked; a host writing into a machine's
+ * memory directly has to go through chip8_load_memory() or mark the pages in
+ * touched_pages itself.
+ *
+ * A pool belongs to one thread. Machines from a pool go back with
+ * chip8_pool_release(), never chip8_machine_destroy(); anything else they
+ * allocate, such as snapshots, comes from the pool's allocator.
+ */
+struct chip8_pool;
+
+/**
+ * Occupancy of a pool
+ */
+struct chip8_pool_stats {
+    size_t slabs;                    /* slabs allocated */
+    size_t capacity;                 /* machines the slabs hold */
+    size_t in_use;                   /* machines handed out and not released */
+    size_t peak;                     /* most machines in use at once */
+    size_t acquired;                 /* machines handed out over the pool's life */
+    size_t bytes;                    /* memory held by the pool */
+};
+
+/**
+ * Creates an empty pool
+ * @param {size_t} per_slab The number of machines each slab holds
+ * @param {const struct chip8_allocator*} a The allocator of the slabs and the machines; NULL for malloc() and free()
+ * @return {struct chip8_pool*} The newly created pool
+ */
+struct chip8_pool* chip8_pool_create(size_t per_slab, const struct chip8_allocator *a);
+
+/**
+ * Destroys the given pool along with every machine it holds, released or not
+ * @param {struct chip8_pool**} p The pool to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_pool_destroy(struct chip8_pool **p);
+
+/**
+ * Takes a machine in its initial state out of the pool, growing it by a slab
+ * when it is empty. Machines are seeded from a sequence that starts at the
+ * pool's seed.
+ * @param {struct chip8_pool*} p The pool to take the machine from
+ * @return {struct chip8_machine*} The machine, NULL when out of memory
+ */
+struct chip8_machine* chip8_pool_acquire(struct chip8_pool *p);
+
+/**
+ * Resets a machine and puts it back into its pool
+ * @param {struct chip8_pool*} p The pool the machine came from
+ * @param {struct chip8_machine*} m The machine to release
+ * @return {int} The outcome of the execution
+ */
+int chip8_pool_release(struct chip8_pool *p, struct chip8_machine *m);
+
+/**
+ * Sets the seed the pool seeds the machines it hands out from
+ * @param {struct chip8_pool*} p The pool to seed
+ * @param {uint32_t} seed The seed
+ */
+void chip8_pool_seed(struct chip8_pool *p, uint32_t seed);
+
+/**
+ * Reports the occupancy of a pool
+ * @param {const struct chip8_pool*} p The pool to report on
+ * @param {struct chip8_pool_stats*} st Receives the occupancy
+ */
+void chip8_pool_stats(const struct chip8_pool *p, struct chip8_pool_stats *st);
+
+#endif /* __chip8_pool_h_ */
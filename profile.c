@@ -0,0 +1,182 @@
+#include "profile.h"
+#include "scheduler.h"
+
+#define NS_PER_SECOND   1000000000.0
+
+/**
+ * Works out log2(n + 1) in sixteenths, which is plenty for a heatmap
+ * @param {uint64_t} n The value to take the logarithm of
+ * @return {uint32_t} The logarithm, scaled by 16
+ */
+static uint32_t profile_log2(uint64_t n) {
+    n ++;
+
+    uint32_t bits = 63 - __builtin_clzll(n);
+    uint32_t frac = bits >= 4 ? (uint32_t)(n >> (bits - 4)) & 0xF : (uint32_t)(n << (4 - bits)) & 0xF;
+
+    return bits << 4 | frac;
+}
+
+struct chip8_profile* chip8_profile_create(void) {
+    struct chip8_profile *p = malloc(sizeof(struct chip8_profile));
+
+    if (p == NULL) {
+        return NULL;
+    }
+
+    memset(p, 0, sizeof(struct chip8_profile));
+    p->decode = chip8_decode_table();
+    p->start = chip8_now();
+
+    return p;
+}
+
+int chip8_profile_destroy(struct chip8_profile **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+int chip8_profile_attach(struct chip8_machine *m, struct chip8_profile *p) {
+#ifdef CHIP8_PROFILE
+    if (m == NULL) {
+        return -1;
+    }
+
+    m->profile = p;
+    return 0;
+#else
+    (void)m;
+    (void)p;
+    return -1;
+#endif
+}
+
+void chip8_profile_frame(struct chip8_profile *p) {
+    p->frames ++;
+}
+
+void chip8_profile_rates(const struct chip8_profile *p, struct chip8_profile_rates *r) {
+    memset(r, 0, sizeof(struct chip8_profile_rates));
+
+    for (int op = 0; op < CHIP8_OP_COUNT; op++) {
+        r->cycles += p->ops[op];
+    }
+
+    for (uint16_t pc = 0; pc < 0x1000; pc++) {
+        if (p->pcs[pc] > p->pcs[r->hottest]) {
+            r->hottest = pc;
+        }
+    }
+
+    r->seconds = (chip8_now() - p->start) / NS_PER_SECOND;
+
+    if (r->seconds > 0.0) {
+        r->cycles_per_second = r->cycles / r->seconds;
+        r->frames_per_second = p->frames / r->seconds;
+    }
+}
+
+void chip8_profile_heat(const struct chip8_profile *p, uint8_t *heat) {
+    uint64_t max = 0;
+
+    for (int pc = 0; pc < 0x1000; pc++) {
+        if (p->pcs[pc] > max) {
+            max = p->pcs[pc];
+        }
+    }
+
+    if (max == 0) {
+        memset(heat, 0, 0x1000);
+        return;
+    }
+
+    uint32_t top = profile_log2(max);
+
+    for (int pc = 0; pc < 0x1000; pc++) {
+        heat[pc] = (uint8_t)(profile_log2(p->pcs[pc]) * 255 / top);
+    }
+}
+
+int chip8_profile_dump_json(const struct chip8_profile *p, FILE *f) {
+    struct chip8_profile_rates r;
+    chip8_profile_rates(p, &r);
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"seconds\": %.6f,\n", r.seconds);
+    fprintf(f, "  \"cycles\": %llu,\n", (unsigned long long)r.cycles);
+    fprintf(f, "  \"cycles_per_second\": %.1f,\n", r.cycles_per_second);
+    fprintf(f, "  \"frames\": %llu,\n", (unsigned long long)p->frames);
+    fprintf(f, "  \"frames_per_second\": %.2f,\n", r.frames_per_second);
+    fprintf(f, "  \"hottest\": \"0x%03X\",\n", r.hottest);
+
+    fprintf(f, "  \"ops\": {");
+    for (int op = 0, first = 1; op < CHIP8_OP_COUNT; op++) {
+        if (p->ops[op] == 0) {
+            continue;
+        }
+
+        fprintf(f, "%s\n    \"%s\": %llu", first ? "" : ",", chip8_op_name(op), (unsigned long long)p->ops[op]);
+        first = 0;
+    }
+    fprintf(f, "\n  },\n");
+
+    fprintf(f, "  \"pcs\": {");
+    for (int pc = 0, first = 1; pc < 0x1000; pc++) {
+        if (p->pcs[pc] == 0) {
+            continue;
+        }
+
+        fprintf(f, "%s\n    \"0x%03X\": %llu", first ? "" : ",", pc, (unsigned long long)p->pcs[pc]);
+        first = 0;
+    }
+    fprintf(f, "\n  }\n}\n");
+
+    return ferror(f) ? -1 : 0;
+}
+
+int chip8_profile_dump_csv(const struct chip8_profile *p, FILE *f) {
+    struct chip8_profile_rates r;
+    chip8_profile_rates(p, &r);
+
+    fprintf(f, "kind,key,hits\n");
+    fprintf(f, "total,cycles,%llu\n", (unsigned long long)r.cycles);
+    fprintf(f, "total,frames,%llu\n", (unsigned long long)p->frames);
+    fprintf(f, "total,seconds,%.6f\n", r.seconds);
+
+    for (int op = 0; op < CHIP8_OP_COUNT; op++) {
+        if (p->ops[op] != 0) {
+            fprintf(f, "op,%s,%llu\n", chip8_op_name(op), (unsigned long long)p->ops[op]);
+        }
+    }
+
+    for (int pc = 0; pc < 0x1000; pc++) {
+        if (p->pcs[pc] != 0) {
+            fprintf(f, "pc,0x%03X,%llu\n", pc, (unsigned long long)p->pcs[pc]);
+        }
+    }
+
+    return ferror(f) ? -1 : 0;
+}
+
+int chip8_profile_save(const struct chip8_profile *p, const char *path) {
+    FILE *f = fopen(path, "w");
+
+    if (f == NULL) {
+        return -1;
+    }
+
+    size_t len = strlen(path);
+    int json = len >= 5 && strcmp(path + len - 5, ".json") == 0;
+    int rc = json ? chip8_profile_dump_json(p, f) : chip8_profile_dump_csv(p, f);
+
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+
+    return rc;
+}
@@ -0,0 +1,110 @@
+#ifndef __chip8_profile_h_
+
+#define __chip8_profile_h_
+
+#include "machine.h"
+#include "decode.h"
+
+/**
+ * Execution profile of a machine; hit counts per instruction class and per
+ * address, and the host time they were gathered over
+ *
+ * Counting only happens in builds configured with CHIP8_PROFILE; without it
+ * the hooks compile to nothing and chip8_profile_attach() fails.
+ */
+struct chip8_profile {
+    const uint8_t *decode;           /* instruction class of every opcode */
+    uint64_t ops[CHIP8_OP_COUNT];    /* hits per instruction class */
+    uint64_t pcs[0x1000];            /* hits per address */
+    uint64_t frames;                 /* frames shown by the frontend */
+    uint64_t start;                  /* host time profiling began, in nanoseconds */
+};
+
+/**
+ * Summary rates of a profile
+ */
+struct chip8_profile_rates {
+    double seconds;                  /* host time covered */
+    uint64_t cycles;                 /* instructions counted */
+    double cycles_per_second;
+    double frames_per_second;
+    uint16_t hottest;                /* address with the most hits */
+};
+
+/**
+ * Creates an empty profile whose clock starts now
+ * @return {struct chip8_profile*} The newly created profile
+ */
+struct chip8_profile* chip8_profile_create(void);
+
+/**
+ * Destroys the given profile
+ * @param {struct chip8_profile**} p The profile to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_profile_destroy(struct chip8_profile **p);
+
+/**
+ * Starts counting the instructions a machine executes into a profile
+ * @param {struct chip8_machine*} m The machine to profile
+ * @param {struct chip8_profile*} p The profile to count into, NULL to stop
+ * @return {int} The outcome of the execution; -1 in builds without CHIP8_PROFILE
+ */
+int chip8_profile_attach(struct chip8_machine *m, struct chip8_profile *p);
+
+/**
+ * Counts one executed instruction
+ * @param {struct chip8_profile*} p The profile to count into
+ * @param {uint16_t} pc The address of the instruction
+ * @param {uint16_t} opcode The instruction
+ */
+static inline void chip8_profile_hit(struct chip8_profile *p, uint16_t pc, uint16_t opcode) {
+    p->ops[p->decode[opcode]]++;
+    p->pcs[pc & 0xFFF]++;
+}
+
+/**
+ * Counts one frame shown by the frontend
+ * @param {struct chip8_profile*} p The profile to count into
+ */
+void chip8_profile_frame(struct chip8_profile *p);
+
+/**
+ * Works out the summary rates of a profile
+ * @param {const struct chip8_profile*} p The profile to summarise
+ * @param {struct chip8_profile_rates*} r Receives the rates
+ */
+void chip8_profile_rates(const struct chip8_profile *p, struct chip8_profile_rates *r);
+
+/**
+ * Scales the per-address hit counts logarithmically into 0 - 255
+ * @param {const struct chip8_profile*} p The profile to read
+ * @param {uint8_t *} heat Receives one value per address (0x1000 bytes)
+ */
+void chip8_profile_heat(const struct chip8_profile *p, uint8_t *heat);
+
+/**
+ * Writes the profile out as JSON
+ * @param {const struct chip8_profile*} p The profile to write
+ * @param {FILE*} f The stream to write to
+ * @return {int} The outcome of the execution
+ */
+int chip8_profile_dump_json(const struct chip8_profile *p, FILE *f);
+
+/**
+ * Writes the profile out as CSV rows of "kind,key,hits"
+ * @param {const struct chip8_profile*} p The profile to write
+ * @param {FILE*} f The stream to write to
+ * @return {int} The outcome of the execution
+ */
+int chip8_profile_dump_csv(const struct chip8_profile *p, FILE *f);
+
+/**
+ * Writes the profile to a file, as JSON when the path ends in ".json" and as CSV otherwise
+ * @param {const struct chip8_profile*} p The profile to write
+ * @param {const char *} path The path of the file to write
+ * @return {int} The outcome of the execution
+ */
+int chip8_profile_save(const struct chip8_profile *p, const char *path);
+
+#endif /* __chip8_profile_h_ */
@@ -0,0 +1,342 @@
+#include "rewind.h"
+
+/**
+ * Flat copy of everything that makes up the state of a machine
+ *
+ * Kept apart from struct chip8_machine so the deltas never see bookkeeping
+ * such as the dirty page mask. Padding is zeroed once and never written.
+ */
+struct rewind_state {
+    uint8_t memory[0x1000];
+    uint64_t display[VIDEO_HEIGHT];
+    uint64_t cycles;
+    uint32_t rng;
+    uint16_t i;
+    uint16_t pc;
+    uint16_t sp;
+    uint16_t ipf;
+    uint8_t quirks;
+    uint16_t tick_left;
+    uint16_t stack[16];
+    uint8_t v[16];
+    uint8_t key[16];
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t draw_flag;
+    uint8_t beep_flag;
+};
+
+/* deltas are built a word at a time */
+_Static_assert(sizeof(struct rewind_state) % sizeof(uint64_t) == 0, "state is a whole number of words");
+
+/* worst case encoding: one literal run of the whole state behind two lengths */
+#define REWIND_MAX_DELTA    (sizeof(struct rewind_state) + 16)
+
+/**
+ * Location of one stored delta within the ring
+ */
+struct rewind_frame {
+    size_t offset;                   /* first byte of the delta */
+    size_t length;                   /* encoded length of the delta */
+};
+
+struct chip8_rewind {
+    struct rewind_frame *frames;     /* ring of deltas, oldest at first */
+    size_t max_frames;
+    size_t first;
+    size_t count;
+
+    uint8_t *data;                   /* ring of encoded deltas */
+    size_t capacity;
+    size_t head;                     /* where the next delta is written */
+    size_t used;                     /* bytes held by live deltas */
+
+    int valid;                       /* current holds the newest state */
+    struct rewind_state current;     /* the newest state, in full */
+    struct rewind_state next;        /* scratch for the state being pushed */
+    uint8_t scratch[REWIND_MAX_DELTA];
+};
+
+static void rewind_pack(struct rewind_state *s, const struct chip8_machine *m) {
+    memcpy(s->memory, m->memory, sizeof(s->memory));
+    memcpy(s->display, m->display, sizeof(s->display));
+    s->cycles = m->cycles;
+    s->rng = m->rng;
+    s->i = m->i;
+    s->pc = m->pc;
+    s->sp = m->sp;
+    s->ipf = m->ipf;
+    s->quirks = m->quirks;
+    s->tick_left = m->tick_left;
+    memcpy(s->stack, m->stack, sizeof(s->stack));
+    memcpy(s->v, m->v, sizeof(s->v));
+    memcpy(s->key, m->key, sizeof(s->key));
+    s->delay_timer = m->delay_timer;
+    s->sound_timer = m->sound_timer;
+    s->draw_flag = m->draw_flag;
+    s->beep_flag = m->beep_flag;
+}
+
+static void rewind_unpack(const struct rewind_state *s, struct chip8_machine *m) {
+    memcpy(m->memory, s->memory, sizeof(m->memory));
+    memcpy(m->display, s->display, sizeof(m->display));
+    m->cycles = s->cycles;
+    m->rng = s->rng;
+    m->i = s->i;
+    m->pc = s->pc;
+    m->sp = s->sp;
+    m->ipf = s->ipf;
+    m->quirks = s->quirks;
+    m->tick_left = s->tick_left;
+    memcpy(m->stack, s->stack, sizeof(m->stack));
+    memcpy(m->v, s->v, sizeof(m->v));
+    memcpy(m->key, s->key, sizeof(m->key));
+    m->delay_timer = s->delay_timer;
+    m->sound_timer = s->sound_timer;
+    m->beep_flag = s->beep_flag;
+
+    // the whole screen and every page changed as far as anyone else can tell
+    m->draw_flag = 1;
+    m->dirty_rows = 0xFFFFFFFF;
+    m->dirty_pages = 0xFFFF;
+    m->touched_pages = 0xFFFF;
+}
+
+static uint8_t* put_length(uint8_t *out, size_t n) {
+    while (n >= 0x80) {
+        *out++ = (uint8_t)(n | 0x80);
+        n >>= 7;
+    }
+
+    *out++ = (uint8_t)n;
+    return out;
+}
+
+static const uint8_t* get_length(const uint8_t *in, size_t *n) {
+    size_t v = 0;
+    int shift = 0;
+
+    do {
+        v |= (size_t)(*in & 0x7F) << shift;
+        shift += 7;
+    } while (*in++ & 0x80);
+
+    *n = v;
+    return in;
+}
+
+/**
+ * Encodes a ^ b as alternating runs: the length of a run of zero bytes, the
+ * length of the literal run after it and then the literal bytes
+ * @return {size_t} The number of bytes written to out
+ */
+static size_t delta_encode(const uint8_t *a, const uint8_t *b, size_t size, uint8_t *out) {
+    uint8_t *o = out;
+    size_t pos = 0;
+
+    while (pos < size) {
+        size_t zeros = pos;
+
+        // skip unchanged words first, then the odd bytes
+        while (zeros + 8 <= size) {
+            uint64_t wa, wb;
+            memcpy(&wa, a + zeros, 8);
+            memcpy(&wb, b + zeros, 8);
+
+            if (wa != wb) {
+                break;
+            }
+
+            zeros += 8;
+        }
+
+        while (zeros < size && a[zeros] == b[zeros]) {
+            zeros++;
+        }
+
+        if (zeros == size) {
+            break;
+        }
+
+        // a literal run ends at the first pair of unchanged bytes
+        size_t end = zeros + 1;
+        while (end < size && !(a[end] == b[end] && (end + 1 == size || a[end + 1] == b[end + 1]))) {
+            end++;
+        }
+
+        o = put_length(o, zeros - pos);
+        o = put_length(o, end - zeros);
+
+        for (size_t k = zeros; k < end; k++) {
+            *o++ = a[k] ^ b[k];
+        }
+
+        pos = end;
+    }
+
+    return o - out;
+}
+
+/**
+ * XORs an encoded delta into the given state
+ */
+static void delta_apply(uint8_t *state, const uint8_t *in, size_t length) {
+    const uint8_t *end = in + length;
+    size_t pos = 0;
+
+    while (in < end) {
+        size_t zeros, literals;
+
+        in = get_length(in, &zeros);
+        in = get_length(in, &literals);
+        pos += zeros;
+
+        for (size_t k = 0; k < literals; k++) {
+            state[pos++] ^= *in++;
+        }
+    }
+}
+
+static void rewind_drop_oldest(struct chip8_rewind *r) {
+    r->used -= r->frames[r->first].length;
+    r->first = (r->first + 1) % r->max_frames;
+    r->count--;
+
+    if (r->count == 0) {
+        r->head = 0;
+    }
+}
+
+/**
+ * Finds room for a delta in the ring, dropping the oldest ones as needed
+ * @return {size_t} The offset to write the delta at
+ */
+static size_t rewind_reserve(struct chip8_rewind *r, size_t length) {
+    if (r->count == r->max_frames) {
+        rewind_drop_oldest(r);
+    }
+
+    while (r->count > 0) {
+        size_t oldest = r->frames[r->first].offset;
+
+        if (r->head > oldest) {
+            // live deltas sit in [oldest, head); use the end, or wrap around
+            if (r->head + length <= r->capacity) {
+                return r->head;
+            }
+
+            if (length <= oldest) {
+                return 0;
+            }
+        } else if (r->head + length <= oldest) {
+            // wrapped: live deltas sit in [oldest, end) and [0, head)
+            return r->head;
+        }
+
+        rewind_drop_oldest(r);
+    }
+
+    return 0;
+}
+
+struct chip8_rewind* chip8_rewind_create(size_t frames, size_t bytes) {
+    if (frames == 0 || bytes < REWIND_MAX_DELTA) {
+        return NULL;
+    }
+
+    struct chip8_rewind *r = (struct chip8_rewind*)calloc(1, sizeof(struct chip8_rewind));
+
+    if (r == NULL) {
+        return NULL;
+    }
+
+    r->frames = (struct rewind_frame*)calloc(frames, sizeof(struct rewind_frame));
+    r->data = (uint8_t*)malloc(bytes);
+
+    if (r->frames == NULL || r->data == NULL) {
+        chip8_rewind_destroy(&r);
+        return NULL;
+    }
+
+    r->max_frames = frames;
+    r->capacity = bytes;
+
+    return r;
+}
+
+int chip8_rewind_destroy(struct chip8_rewind **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    free((*p)->frames);
+    free((*p)->data);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+int chip8_rewind_push(struct chip8_rewind *r, const struct chip8_machine *m) {
+    if (r == NULL || m == NULL) {
+        return -1;
+    }
+
+    if (!r->valid) {
+        rewind_pack(&r->current, m);
+        r->valid = 1;
+        return 0;
+    }
+
+    rewind_pack(&r->next, m);
+
+    // the delta takes the new state back to the one it replaces as newest
+    size_t length = delta_encode((const uint8_t*)&r->current, (const uint8_t*)&r->next,
+                                 sizeof(struct rewind_state), r->scratch);
+    size_t offset = rewind_reserve(r, length);
+    size_t slot = (r->first + r->count) % r->max_frames;
+
+    memcpy(r->data + offset, r->scratch, length);
+    r->frames[slot].offset = offset;
+    r->frames[slot].length = length;
+    r->count++;
+    r->used += length;
+    r->head = offset + length;
+
+    memcpy(&r->current, &r->next, sizeof(struct rewind_state));
+
+    return 0;
+}
+
+int chip8_rewind_step_back(struct chip8_rewind *r, struct chip8_machine *m) {
+    if (r == NULL || m == NULL || r->count == 0) {
+        return -1;
+    }
+
+    size_t slot = (r->first + r->count - 1) % r->max_frames;
+    struct rewind_frame *f = &r->frames[slot];
+
+    delta_apply((uint8_t*)&r->current, r->data + f->offset, f->length);
+
+    r->count--;
+    r->used -= f->length;
+    r->head = r->count > 0 ? f->offset : 0;
+
+    rewind_unpack(&r->current, m);
+
+    return 0;
+}
+
+void chip8_rewind_clear(struct chip8_rewind *r) {
+    r->first = 0;
+    r->count = 0;
+    r->head = 0;
+    r->used = 0;
+    r->valid = 0;
+}
+
+void chip8_rewind_stats(const struct chip8_rewind *r, struct chip8_rewind_stats *st) {
+    st->frames = r->count;
+    st->bytes = r->used + r->count * sizeof(struct rewind_frame);
+    st->capacity = r->capacity + r->max_frames * sizeof(struct rewind_frame) + sizeof(struct rewind_state);
+    st->bytes_per_frame = r->count > 0 ? (double)st->bytes / r->count : 0.0;
+}
@@ -0,0 +1,73 @@
+#ifndef __chip8_rewind_h_
+
+#define __chip8_rewind_h_
+
+#include "machine.h"
+
+/**
+ * Rewind history; a fixed-size ring of machine states
+ *
+ * Only the newest state is held in full. Every older state is stored as the
+ * XOR of itself and the state after it, with runs of zero bytes (everything
+ * that did not change) squeezed out, so that stepping back applies one delta
+ * at a time. When the ring fills up the oldest states are dropped.
+ */
+struct chip8_rewind;
+
+/**
+ * Memory use of a rewind history
+ */
+struct chip8_rewind_stats {
+    size_t frames;                   /* number of states that can be stepped back to */
+    size_t bytes;                    /* bytes of the ring holding those states */
+    size_t capacity;                 /* size of the ring in bytes */
+    double bytes_per_frame;          /* average size of a stored state */
+};
+
+/**
+ * Creates a new, empty rewind history
+ * @param {size_t} frames The maximum number of states to keep
+ * @param {size_t} bytes The size of the ring holding the compressed states
+ * @return {struct chip8_rewind*} The newly created history, NULL on failure
+ */
+struct chip8_rewind* chip8_rewind_create(size_t frames, size_t bytes);
+
+/**
+ * Destroys the given rewind history
+ * @param {struct chip8_rewind**} p The history to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_rewind_destroy(struct chip8_rewind **p);
+
+/**
+ * Records the current state of the machine as the newest state
+ * @param {struct chip8_rewind*} r The history to record into
+ * @param {const struct chip8_machine*} m The machine to record
+ * @return {int} The outcome of the execution
+ */
+int chip8_rewind_push(struct chip8_rewind *r, const struct chip8_machine *m);
+
+/**
+ * Steps the machine back to the state recorded before the newest one, which
+ * is then dropped. The machine's memory is rewritten: any block cache must be
+ * flushed and any snapshot base is no longer valid.
+ * @param {struct chip8_rewind*} r The history to step back through
+ * @param {struct chip8_machine*} m The machine to restore
+ * @return {int} 0 on success, -1 when there is no older state
+ */
+int chip8_rewind_step_back(struct chip8_rewind *r, struct chip8_machine *m);
+
+/**
+ * Drops every recorded state
+ * @param {struct chip8_rewind*} r The history to clear
+ */
+void chip8_rewind_clear(struct chip8_rewind *r);
+
+/**
+ * Reports the memory use of the history
+ * @param {const struct chip8_rewind*} r The history to measure
+ * @param {struct chip8_rewind_stats*} st Receives the measurements
+ */
+void chip8_rewind_stats(const struct chip8_rewind *r, struct chip8_rewind_stats *st);
+
+#endif /* __chip8_rewind_h_ */
@@ -0,0 +1,504 @@
+#include "romstore.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define ROMSTORE_EXTENSION  ".ch8"
+
+/**
+ * An artifact built for an image; images keep theirs in a list
+ */
+struct romstore_artifact {
+    const struct chip8_artifact_type *type;
+    void *artifact;
+    struct romstore_artifact *next;
+};
+
+struct romstore_entry {
+    struct chip8_rom rom;
+    struct romstore_artifact *artifacts;
+};
+
+/**
+ * A file name holding an image; several may hold the same one
+ */
+struct romstore_name {
+    char *name;
+    size_t entry;
+};
+
+/**
+ * A region mapped by the store
+ */
+struct romstore_map {
+    void *addr;
+    size_t length;
+};
+
+struct chip8_romstore {
+    struct romstore_entry *entries;  /* distinct images, in the order first seen */
+    size_t count;
+    size_t capacity;
+
+    struct romstore_name *names;
+    size_t name_count;
+    size_t name_capacity;
+
+    struct romstore_map *maps;
+    size_t map_count;
+    size_t map_capacity;
+
+    uint32_t *index;                 /* open addressed by hash; entry + 1, 0 when free */
+    size_t index_size;               /* a power of two */
+
+    pthread_mutex_t lock;            /* guards the artifact lists */
+};
+
+uint64_t chip8_rom_hash(const uint8_t *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t k = 0; k < size; k++) {
+        hash ^= data[k];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+/**
+ * Grows an array of the store to hold one more element
+ * @return {int} The outcome of the execution
+ */
+static int romstore_reserve(void **items, size_t *capacity, size_t count, size_t item) {
+    if (count < *capacity) {
+        return 0;
+    }
+
+    size_t grown = *capacity ? *capacity * 2 : 16;
+    void *p = realloc(*items, grown * item);
+
+    if (p == NULL) {
+        return -1;
+    }
+
+    *items = p;
+    *capacity = grown;
+    return 0;
+}
+
+/**
+ * Finds the slot of the index holding a hash, or the free slot it would go in
+ */
+static size_t romstore_slot(const struct chip8_romstore *s, uint64_t hash) {
+    size_t mask = s->index_size - 1;
+    size_t slot = (size_t)hash & mask;
+
+    while (s->index[slot] != 0 && s->entries[s->index[slot] - 1].rom.hash != hash) {
+        slot = (slot + 1) & mask;
+    }
+
+    return slot;
+}
+
+/**
+ * Rebuilds the index at twice its size
+ * @return {int} The outcome of the execution
+ */
+static int romstore_rehash(struct chip8_romstore *s) {
+    size_t size = s->index_size ? s->index_size * 2 : 64;
+    uint32_t *index = calloc(size, sizeof(uint32_t));
+
+    if (index == NULL) {
+        return -1;
+    }
+
+    free(s->index);
+    s->index = index;
+    s->index_size = size;
+
+    for (size_t e = 0; e < s->count; e++) {
+        s->index[romstore_slot(s, s->entries[e].rom.hash)] = (uint32_t)(e + 1);
+    }
+
+    return 0;
+}
+
+/**
+ * Adds an image to the store under a name, unless the store already holds it
+ * @return {int} 1 when the image is new, 0 when it was known, -1 on failure
+ */
+static int romstore_add(struct chip8_romstore *s, const char *name, const uint8_t *data, size_t size) {
+    uint64_t hash = chip8_rom_hash(data, size);
+    int added = 0;
+
+    if ((s->count + 1) * 2 > s->index_size && romstore_rehash(s) < 0) {
+        return -1;
+    }
+
+    if (romstore_reserve((void**)&s->names, &s->name_capacity, s->name_count, sizeof(struct romstore_name)) < 0) {
+        return -1;
+    }
+
+    char *copy = strdup(name);
+    size_t slot = romstore_slot(s, hash);
+
+    if (copy == NULL) {
+        return -1;
+    }
+
+    if (s->index[slot] == 0) {
+        if (romstore_reserve((void**)&s->entries, &s->capacity, s->count, sizeof(struct romstore_entry)) < 0) {
+            free(copy);
+            return -1;
+        }
+
+        struct romstore_entry *e = &s->entries[s->count];
+        e->rom.hash = hash;
+        e->rom.data = data;
+        e->rom.size = size;
+        e->rom.name = copy;
+        e->artifacts = NULL;
+
+        s->index[slot] = (uint32_t)++s->count;
+        added = 1;
+    }
+
+    s->names[s->name_count].name = copy;
+    s->names[s->name_count].entry = s->index[slot] - 1;
+    s->name_count++;
+
+    return added;
+}
+
+/**
+ * Maps a whole file read-only
+ * @return {const uint8_t *} The mapping, NULL on failure or for an empty file
+ */
+static const uint8_t* romstore_map(struct chip8_romstore *s, const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+        romstore_reserve((void**)&s->maps, &s->map_capacity, s->map_count, sizeof(struct romstore_map)) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        return NULL;
+    }
+
+    s->maps[s->map_count].addr = data;
+    s->maps[s->map_count].length = st.st_size;
+    s->map_count++;
+
+    *size = st.st_size;
+    return data;
+}
+
+/**
+ * Drops the most recent mapping, for an image the store already held
+ */
+static void romstore_unmap_last(struct chip8_romstore *s) {
+    s->map_count--;
+    munmap(s->maps[s->map_count].addr, s->maps[s->map_count].length);
+}
+
+static uint32_t romstore_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * Adds every image of a mapped pack
+ * @return {int} The outcome of the execution
+ */
+static int romstore_add_pack(struct chip8_romstore *s, const uint8_t *data, size_t size) {
+    if (size < CHIP8_ROM_PACK_HEADER || data[4] != CHIP8_ROM_PACK_VERSION) {
+        return -1;
+    }
+
+    uint32_t count = romstore_u32(data + 8);
+
+    if (count > (size - CHIP8_ROM_PACK_HEADER) / CHIP8_ROM_PACK_ENTRY) {
+        return -1;
+    }
+
+    for (uint32_t k = 0; k < count; k++) {
+        const uint8_t *entry = data + CHIP8_ROM_PACK_HEADER + k * CHIP8_ROM_PACK_ENTRY;
+        uint32_t offset = romstore_u32(entry + 8);
+        uint32_t length = romstore_u32(entry + 12);
+        char name[CHIP8_ROM_PACK_NAME];
+
+        if (length == 0 || length > CHIP8_PROGRAM_MAX || offset > size || length > size - offset) {
+            return -1;
+        }
+
+        memcpy(name, entry + 16, CHIP8_ROM_PACK_NAME);
+        name[CHIP8_ROM_PACK_NAME - 1] = '\0';
+
+        if (romstore_add(s, name, data + offset, length) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Adds a single rom file, or every image of a pack
+ * @return {int} The outcome of the execution
+ */
+static int romstore_add_file(struct chip8_romstore *s, const char *path, const char *name) {
+    size_t size;
+    const uint8_t *data = romstore_map(s, path, &size);
+
+    if (data == NULL) {
+        return -1;
+    }
+
+    if (size >= 4 && memcmp(data, CHIP8_ROM_PACK_MAGIC, 4) == 0) {
+        return romstore_add_pack(s, data, size);
+    }
+
+    if (size > CHIP8_PROGRAM_MAX) {
+        romstore_unmap_last(s);
+        return -1;
+    }
+
+    int added = romstore_add(s, name, data, size);
+
+    if (added == 0) {
+        romstore_unmap_last(s);
+    }
+
+    return added < 0 ? -1 : 0;
+}
+
+static int romstore_compare_names(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/**
+ * Adds every rom of a directory, in name order
+ * @return {int} The outcome of the execution
+ */
+static int romstore_add_directory(struct chip8_romstore *s, const char *path) {
+    DIR *dir = opendir(path);
+    char **names = NULL;
+    size_t count = 0, capacity = 0;
+    struct dirent *d;
+    int rc = 0;
+
+    if (dir == NULL) {
+        return -1;
+    }
+
+    while (rc == 0 && (d = readdir(dir)) != NULL) {
+        size_t len = strlen(d->d_name);
+        size_t ext = strlen(ROMSTORE_EXTENSION);
+
+        if (d->d_name[0] == '.' || len <= ext || strcmp(d->d_name + len - ext, ROMSTORE_EXTENSION) != 0) {
+            continue;
+        }
+
+        if (romstore_reserve((void**)&names, &capacity, count, sizeof(char*)) < 0 ||
+            (names[count] = strdup(d->d_name)) == NULL) {
+            rc = -1;
+            break;
+        }
+
+        count++;
+    }
+
+    closedir(dir);
+
+    // name order keeps positions in the store the same from run to run
+    qsort(names, count, sizeof(char*), romstore_compare_names);
+
+    for (size_t k = 0; k < count; k++) {
+        char file[4096];
+
+        // a rom that is too large or unreadable is left out, not fatal
+        if (rc == 0 && snprintf(file, sizeof(file), "%s/%s", path, names[k]) < (int)sizeof(file)) {
+            romstore_add_file(s, file, names[k]);
+        }
+
+        free(names[k]);
+    }
+
+    free(names);
+
+    return rc;
+}
+
+struct chip8_romstore* chip8_romstore_open(const char *path) {
+    struct chip8_romstore *s = calloc(1, sizeof(struct chip8_romstore));
+    struct stat st;
+
+    if (s == NULL) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    int rc = stat(path, &st) < 0 ? -1
+           : S_ISDIR(st.st_mode) ? romstore_add_directory(s, path)
+           : romstore_add_file(s, path, name);
+
+    if (rc < 0 || s->count == 0) {
+        chip8_romstore_close(&s);
+        return NULL;
+    }
+
+    return s;
+}
+
+int chip8_romstore_close(struct chip8_romstore **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    struct chip8_romstore *s = *p;
+
+    for (size_t e = 0; e < s->count; e++) {
+        for (struct romstore_artifact *a = s->entries[e].artifacts, *next; a != NULL; a = next) {
+            next = a->next;
+            a->type->destroy(a->artifact);
+            free(a);
+        }
+    }
+
+    for (size_t n = 0; n < s->name_count; n++) {
+        free(s->names[n].name);
+    }
+
+    for (size_t m = 0; m < s->map_count; m++) {
+        munmap(s->maps[m].addr, s->maps[m].length);
+    }
+
+    pthread_mutex_destroy(&s->lock);
+
+    free(s->entries);
+    free(s->names);
+    free(s->maps);
+    free(s->index);
+    free(s);
+    *p = NULL;
+    return 0;
+}
+
+size_t chip8_romstore_count(const struct chip8_romstore *s) {
+    return s->count;
+}
+
+const struct chip8_rom* chip8_romstore_get(const struct chip8_romstore *s, size_t index) {
+    return index < s->count ? &s->entries[index].rom : NULL;
+}
+
+const struct chip8_rom* chip8_romstore_find(const struct chip8_romstore *s, uint64_t hash) {
+    size_t slot = romstore_slot(s, hash);
+    return s->index[slot] ? &s->entries[s->index[slot] - 1].rom : NULL;
+}
+
+const struct chip8_rom* chip8_romstore_lookup(const struct chip8_romstore *s, const char *name) {
+    for (size_t n = 0; n < s->name_count; n++) {
+        if (strcmp(s->names[n].name, name) == 0) {
+            return &s->entries[s->names[n].entry].rom;
+        }
+    }
+
+    return NULL;
+}
+
+const void* chip8_romstore_artifact(struct chip8_romstore *s, const struct chip8_rom *rom,
+                                    const struct chip8_artifact_type *type) {
+    // the rom is one of the entries, and the entry leads with it
+    struct romstore_entry *e = (struct romstore_entry*)rom;
+    struct romstore_artifact *a;
+
+    pthread_mutex_lock(&s->lock);
+
+    for (a = e->artifacts; a != NULL && a->type != type; a = a->next) {
+    }
+
+    if (a == NULL && (a = malloc(sizeof(struct romstore_artifact))) != NULL) {
+        a->type = type;
+        a->artifact = type->build(rom);
+
+        if (a->artifact != NULL) {
+            a->next = e->artifacts;
+            e->artifacts = a;
+        } else {
+            free(a);
+            a = NULL;
+        }
+    }
+
+    pthread_mutex_unlock(&s->lock);
+
+    return a ? a->artifact : NULL;
+}
+
+static void romstore_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+int chip8_romstore_pack(const struct chip8_romstore *s, const char *path) {
+    FILE *f = fopen(path, "wb");
+
+    if (!f) {
+        return -1;
+    }
+
+    uint8_t header[CHIP8_ROM_PACK_HEADER] = {
+        CHIP8_ROM_PACK_MAGIC[0], CHIP8_ROM_PACK_MAGIC[1], CHIP8_ROM_PACK_MAGIC[2], CHIP8_ROM_PACK_MAGIC[3],
+        CHIP8_ROM_PACK_VERSION, 0, 0, 0
+    };
+    romstore_put_u32(header + 8, (uint32_t)s->count);
+
+    int rc = fwrite(header, sizeof(header), 1, f) == 1 ? 0 : -1;
+    uint32_t offset = CHIP8_ROM_PACK_HEADER + (uint32_t)s->count * CHIP8_ROM_PACK_ENTRY;
+
+    for (size_t e = 0; rc == 0 && e < s->count; e++) {
+        const struct chip8_rom *rom = &s->entries[e].rom;
+        uint8_t entry[CHIP8_ROM_PACK_ENTRY] = { 0 };
+
+        romstore_put_u32(entry, (uint32_t)rom->hash);
+        romstore_put_u32(entry + 4, (uint32_t)(rom->hash >> 32));
+        romstore_put_u32(entry + 8, offset);
+        romstore_put_u32(entry + 12, (uint32_t)rom->size);
+        strncpy((char*)entry + 16, rom->name, CHIP8_ROM_PACK_NAME - 1);
+
+        rc = fwrite(entry, sizeof(entry), 1, f) == 1 ? 0 : -1;
+        offset += (uint32_t)rom->size;
+    }
+
+    for (size_t e = 0; rc == 0 && e < s->count; e++) {
+        rc = fwrite(s->entries[e].rom.data, s->entries[e].rom.size, 1, f) == 1 ? 0 : -1;
+    }
+
+    if (fclose(f) != 0) {
+        rc = -1;
+    }
+
+    return rc;
+}
+
+int chip8_rom_load(struct chip8_machine *m, const struct chip8_rom *rom) {
+    return chip8_load_memory(m, rom->data, rom->size);
+}
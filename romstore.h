@@ -0,0 +1,138 @@
+#ifndef __chip8_romstore_h_
+
+#define __chip8_romstore_h_
+
+#include "machine.h"
+
+/*
+ ROM pack format; all integers little endian
+ +--------+---------+----------+-------+
+ | "C8RP" | version | reserved | count |  header, 12 bytes
+ | 4      | 1       | 3        | 4     |
+ +--------+---------+----------+-------+
+ followed by count entries of 64 bytes each:
+ +------+--------+------+----------------------+
+ | hash | offset | size | name, NUL terminated |
+ | 8    | 4      | 4    | 48                   |
+ +------+--------+------+----------------------+
+ followed by the images; offsets count from the start of the pack.
+*/
+
+#define CHIP8_ROM_PACK_MAGIC      "C8RP"
+#define CHIP8_ROM_PACK_VERSION    1
+#define CHIP8_ROM_PACK_HEADER     12
+#define CHIP8_ROM_PACK_ENTRY      64
+#define CHIP8_ROM_PACK_NAME       48
+
+/**
+ * A program image held by a ROM store; read-only and shared by every machine
+ * loading it
+ */
+struct chip8_rom {
+    uint64_t hash;                   /* FNV-1a hash of the image */
+    const uint8_t *data;             /* the image, mapped from its file */
+    size_t size;                     /* size of the image; at most CHIP8_PROGRAM_MAX */
+    const char *name;                /* name of the first file holding the image */
+};
+
+/**
+ * Something derived from a program image once and then shared by every
+ * machine running it, such as its static analysis
+ */
+struct chip8_artifact_type {
+    const char *name;
+    void* (*build)(const struct chip8_rom *rom);
+    void (*destroy)(void *artifact);
+};
+
+/**
+ * Memory-mapped collection of program images, indexed by the hash of their
+ * contents; files holding the same image share one entry
+ *
+ * A store is opened on a directory of roms, a single rom or a pack written by
+ * chip8_romstore_pack(). Images are never copied: each file (or the whole pack)
+ * is mapped once and the images point into the mapping. Lookups are read-only
+ * and may run on any thread; artifacts are built under a lock, once per image.
+ */
+struct chip8_romstore;
+
+/**
+ * Hashes a program image
+ * @param {const uint8_t *} data The image
+ * @param {size_t} size The size of the image
+ * @return {uint64_t} The FNV-1a hash of the image
+ */
+uint64_t chip8_rom_hash(const uint8_t *data, size_t size);
+
+/**
+ * Opens a store on a directory of roms, a pack or a single rom
+ * @param {const char *} path The path to open
+ * @return {struct chip8_romstore*} The store, NULL when nothing could be mapped
+ */
+struct chip8_romstore* chip8_romstore_open(const char *path);
+
+/**
+ * Closes the given store, unmapping its images and destroying their artifacts
+ * @param {struct chip8_romstore**} p The store to close
+ * @return {int} The outcome of the execution
+ */
+int chip8_romstore_close(struct chip8_romstore **p);
+
+/**
+ * Gets the number of distinct images in a store
+ * @param {const struct chip8_romstore*} s The store
+ * @return {size_t} The number of images
+ */
+size_t chip8_romstore_count(const struct chip8_romstore *s);
+
+/**
+ * Gets an image of a store by its position
+ * @param {const struct chip8_romstore*} s The store
+ * @param {size_t} index The position of the image, below chip8_romstore_count()
+ * @return {const struct chip8_rom*} The image, NULL when out of range
+ */
+const struct chip8_rom* chip8_romstore_get(const struct chip8_romstore *s, size_t index);
+
+/**
+ * Finds an image of a store by the hash of its contents
+ * @param {const struct chip8_romstore*} s The store
+ * @param {uint64_t} hash The hash of the image
+ * @return {const struct chip8_rom*} The image, NULL when the store does not hold it
+ */
+const struct chip8_rom* chip8_romstore_find(const struct chip8_romstore *s, uint64_t hash);
+
+/**
+ * Finds an image of a store by the name of any file holding it
+ * @param {const struct chip8_romstore*} s The store
+ * @param {const char *} name The file name, without its directory
+ * @return {const struct chip8_rom*} The image, NULL when no file has that name
+ */
+const struct chip8_rom* chip8_romstore_lookup(const struct chip8_romstore *s, const char *name);
+
+/**
+ * Gets an artifact of an image, building it on first use
+ * @param {struct chip8_romstore*} s The store holding the image
+ * @param {const struct chip8_rom*} rom The image
+ * @param {const struct chip8_artifact_type*} type The kind of artifact
+ * @return {const void*} The artifact, NULL when it could not be built
+ */
+const void* chip8_romstore_artifact(struct chip8_romstore *s, const struct chip8_rom *rom,
+                                    const struct chip8_artifact_type *type);
+
+/**
+ * Writes every image of a store, with its name, into a single pack
+ * @param {const struct chip8_romstore*} s The store to pack
+ * @param {const char *} path The path of the pack to write
+ * @return {int} The outcome of the execution
+ */
+int chip8_romstore_pack(const struct chip8_romstore *s, const char *path);
+
+/**
+ * Loads an image of a store into a machine
+ * @param {struct chip8_machine*} m The machine to load the program into
+ * @param {const struct chip8_rom*} rom The image to load
+ * @return {int} The outcome of the execution
+ */
+int chip8_rom_load(struct chip8_machine *m, const struct chip8_rom *rom);
+
+#endif /* __chip8_romstore_h_ */
@@ -0,0 +1,108 @@
+#include "runahead.h"
+#include "runner.h"
+#include "scheduler.h"
+
+struct chip8_runahead {
+    uint32_t ticks;                  /* 60 Hz ticks run ahead each pass */
+    struct chip8_snapshot *base;     /* the real state at the last pass */
+    uint64_t shown[VIDEO_HEIGHT];    /* the display presented last */
+    int presented;                   /* shown holds a display */
+    uint64_t passes;                 /* passes run */
+    uint64_t ns;                     /* host time spent in them */
+};
+
+struct chip8_runahead* chip8_runahead_create(uint32_t ticks) {
+    struct chip8_runahead *ra = (struct chip8_runahead*)malloc(sizeof(struct chip8_runahead));
+
+    if (ra == NULL) {
+        return NULL;
+    }
+
+    memset(ra, 0, sizeof(struct chip8_runahead));
+    ra->ticks = ticks;
+
+    return ra;
+}
+
+int chip8_runahead_destroy(struct chip8_runahead **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    chip8_snapshot_release(&(*p)->base);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+void chip8_runahead_reset(struct chip8_runahead *ra) {
+    chip8_snapshot_release(&ra->base);
+}
+
+int chip8_runahead_run(struct chip8_runahead *ra, struct chip8_machine *m,
+                       void (*present)(void *ctx, const struct chip8_machine *m), void *ctx) {
+    uint64_t start = chip8_now();
+
+    // the new snapshot shares every page the machine left alone with the last one
+    struct chip8_snapshot *s = chip8_snapshot_take(m, ra->base);
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    chip8_snapshot_release(&ra->base);
+    ra->base = s;
+
+    uint32_t dirty_rows = m->dirty_rows;
+    struct chip8_run_result r;
+
+    // the snapshot only rolls back the machine's own generator; numbers taken
+    // from a host would be gone from the real timeline, so the future draws
+    // from the machine's generator instead
+    const struct chip8_host *host = m->host;
+    m->host = NULL;
+
+#ifdef CHIP8_PROFILE
+    // only the real timeline counts towards the profile
+    struct chip8_profile *profile = m->profile;
+    m->profile = NULL;
+#endif
+
+#ifdef CHIP8_TRACE
+    // or goes into the trace
+    struct chip8_trace *trace = m->trace;
+    m->trace = NULL;
+#endif
+
+    chip8_scheduler_run(m, ra->ticks, &r);
+
+    m->host = host;
+
+#ifdef CHIP8_PROFILE
+    m->profile = profile;
+#endif
+
+#ifdef CHIP8_TRACE
+    m->trace = trace;
+#endif
+
+    if (!ra->presented || memcmp(ra->shown, m->display, sizeof(ra->shown)) != 0) {
+        memcpy(ra->shown, m->display, sizeof(ra->shown));
+        ra->presented = 1;
+        present(ctx, m);
+    }
+
+    // only the pages written while running ahead differ from the snapshot
+    int rc = chip8_snapshot_restore(m, s, s) < 0 ? -1 : 0;
+
+    m->dirty_rows = dirty_rows;
+
+    ra->passes++;
+    ra->ns += chip8_now() - start;
+
+    return rc;
+}
+
+double chip8_runahead_pass_ns(const struct chip8_runahead *ra) {
+    return ra->passes ? (double)ra->ns / ra->passes : 0.0;
+}
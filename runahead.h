@@ -0,0 +1,67 @@
+#ifndef __chip8_runahead_h_
+
+#define __chip8_runahead_h_
+
+#include "machine.h"
+#include "snapshot.h"
+
+/**
+ * Run-ahead state of one machine
+ *
+ * Each pass snapshots the machine, runs it some ticks further with the keys
+ * held as they are now, shows the display of that future and rolls back to
+ * the snapshot. A key press shows on screen that many ticks sooner than it
+ * would otherwise, while the machine itself only ever moves forward on the
+ * real timeline.
+ *
+ * Every snapshot is taken against the one before it, and restored against
+ * itself, so a pass copies only the memory pages written since the last pass
+ * and those written while running ahead.
+ */
+struct chip8_runahead;
+
+/**
+ * Creates the run-ahead state for a machine
+ * @param {uint32_t} ticks The number of 60 Hz ticks to run ahead
+ * @return {struct chip8_runahead*} The newly created state, NULL on failure
+ */
+struct chip8_runahead* chip8_runahead_create(uint32_t ticks);
+
+/**
+ * Destroys the given run-ahead state
+ * @param {struct chip8_runahead**} p The state to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_runahead_destroy(struct chip8_runahead **p);
+
+/**
+ * Drops the snapshot the next pass would be taken against; must be called
+ * whenever the machine was loaded or restored from anything else since the
+ * last pass, for instance after stepping back through a rewind history
+ * @param {struct chip8_runahead*} ra The run-ahead state
+ */
+void chip8_runahead_reset(struct chip8_runahead *ra);
+
+/**
+ * Runs the machine ahead, hands it to present() in the future state when its
+ * display differs from the one presented last, and rolls it back. The
+ * machine's dirty rows are left as they were before the pass. The host is
+ * detached while running ahead, so its random numbers only feed the real
+ * timeline.
+ * @param {struct chip8_runahead*} ra The run-ahead state
+ * @param {struct chip8_machine*} m The machine to run ahead
+ * @param {void (*)(void*, const struct chip8_machine*)} present Shows the future display
+ * @param {void*} ctx Handed to present()
+ * @return {int} The outcome of the execution
+ */
+int chip8_runahead_run(struct chip8_runahead *ra, struct chip8_machine *m,
+                       void (*present)(void *ctx, const struct chip8_machine *m), void *ctx);
+
+/**
+ * Reads the average host time of a pass
+ * @param {const struct chip8_runahead*} ra The run-ahead state
+ * @return {double} The average time of a pass in nanoseconds, 0 before the first
+ */
+double chip8_runahead_pass_ns(const struct chip8_runahead *ra);
+
+#endif /* __chip8_runahead_h_ */
@@ -0,0 +1,219 @@
+#include "runner.h"
+#include "dispatch.h"
+#include "jit.h"
+#include "lanes.h"
+
+static const char *engine_names[CHIP8_ENGINE_COUNT] = {
+    [CHIP8_ENGINE_SWITCH]   = "switch",
+    [CHIP8_ENGINE_TABLE]    = "table",
+    [CHIP8_ENGINE_THREADED] = "threaded",
+    [CHIP8_ENGINE_JIT]      = "jit",
+    [CHIP8_ENGINE_LANES]    = "lanes",
+};
+
+/**
+ * Runs a single machine as the only lane of the lockstep engine
+ * @return {int} The outcome of the execution, as chip8_run_switch() reports it
+ */
+static int chip8_run_lanes(struct chip8_machine *m, uint64_t count) {
+    struct chip8_lanes l;
+
+    chip8_lanes_load(&l, &m, 1);
+    chip8_lanes_run(&l, NULL, count);
+    chip8_lanes_store(&l);
+
+    switch (l.halt[0]) {
+        case CHIP8_HALT_LOOP:  return CHIP8_RUN_LOOP;
+        case CHIP8_HALT_ERROR: return l.status[0];
+        default:               return 0;
+    }
+}
+
+int chip8_run_engine(struct chip8_machine *m, enum chip8_engine engine, struct chip8_jit *jit, uint64_t count) {
+    switch (engine) {
+        case CHIP8_ENGINE_TABLE:    return chip8_run_table(m, count);
+        case CHIP8_ENGINE_THREADED: return chip8_run_threaded(m, count);
+        case CHIP8_ENGINE_JIT:      return chip8_jit_run(jit, m, count);
+        case CHIP8_ENGINE_LANES:    return chip8_run_lanes(m, count);
+        default:                    return chip8_run_switch(m, count);
+    }
+}
+
+int chip8_run(struct chip8_machine *m, const struct chip8_script *s, uint64_t max_cycles, struct chip8_run_result *r) {
+    return chip8_run_with(m, s, max_cycles, CHIP8_ENGINE_DEFAULT, r);
+}
+
+/**
+ * Source of key transitions for a run; applies every transition due at the
+ * machine's current cycle and returns the cycle of the next one
+ */
+typedef uint64_t (*chip8_input_fn)(void *ctx, struct chip8_machine *m);
+
+struct script_input {
+    const struct chip8_script *s;
+    size_t cursor;
+};
+
+static uint64_t script_input_apply(void *ctx, struct chip8_machine *m) {
+    struct script_input *in = (struct script_input*)ctx;
+
+    in->cursor = chip8_script_apply(in->s, in->cursor, m);
+
+    return in->s && in->cursor < in->s->count ? in->s->events[in->cursor].cycle : UINT64_MAX;
+}
+
+struct chip8_runner {
+    enum chip8_engine engine;
+    struct chip8_jit *jit;           /* block cache of the machine; CHIP8_ENGINE_JIT only */
+    struct script_input in;
+};
+
+static uint64_t log_input_apply(void *ctx, struct chip8_machine *m) {
+    return chip8_input_log_apply((struct chip8_input_log*)ctx, m);
+}
+
+/**
+ * Runs the machine through the given engine, stopping at every key transition
+ * of the input source to apply it
+ * @return {int} The outcome of the execution
+ */
+static int chip8_run_input(struct chip8_machine *m, chip8_input_fn input, void *ctx, uint64_t max_cycles,
+                           enum chip8_engine engine, struct chip8_jit *jit, struct chip8_run_result *r) {
+    uint64_t start = m->cycles;
+    uint64_t end = start + max_cycles;
+    int rc = 0;
+
+    while (rc == 0 && m->cycles < end) {
+        uint64_t next = input(ctx, m);
+
+        // run uninterrupted up to the next key transition
+        uint64_t count = end - m->cycles;
+        if (next - m->cycles < count) {
+            count = next - m->cycles;
+        }
+
+        rc = chip8_run_engine(m, engine, jit, count);
+    }
+
+    r->halt = rc == CHIP8_RUN_LOOP ? CHIP8_HALT_LOOP : rc < 0 ? CHIP8_HALT_ERROR : CHIP8_HALT_CYCLES;
+    r->status = rc < 0 ? rc : 0;
+    r->cycles = m->cycles - start;
+
+    return 0;
+}
+
+struct chip8_runner* chip8_runner_create(enum chip8_engine engine, const struct chip8_script *s) {
+    if (engine >= CHIP8_ENGINE_COUNT) {
+        return NULL;
+    }
+
+    struct chip8_runner *rn = calloc(1, sizeof(struct chip8_runner));
+
+    if (rn == NULL) {
+        return NULL;
+    }
+
+    rn->engine = engine;
+    rn->in.s = s;
+
+    if (engine == CHIP8_ENGINE_JIT && (rn->jit = chip8_jit_create()) == NULL) {
+        free(rn);
+        return NULL;
+    }
+
+    return rn;
+}
+
+int chip8_runner_destroy(struct chip8_runner **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    chip8_jit_destroy(&(*p)->jit);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+void chip8_runner_reset(struct chip8_runner *rn, const struct chip8_machine *m) {
+    if (rn->jit != NULL) {
+        chip8_jit_flush(rn->jit);
+    }
+
+    // transitions before the machine's cycle are already in its key states
+    rn->in.cursor = 0;
+    while (rn->in.s && rn->in.cursor < rn->in.s->count && rn->in.s->events[rn->in.cursor].cycle < m->cycles) {
+        rn->in.cursor++;
+    }
+}
+
+int chip8_runner_run(struct chip8_runner *rn, struct chip8_machine *m, uint64_t max_cycles, struct chip8_run_result *r) {
+    if (rn == NULL || m == NULL || r == NULL) {
+        return -1;
+    }
+
+    return chip8_run_input(m, script_input_apply, &rn->in, max_cycles, rn->engine, rn->jit, r);
+}
+
+int chip8_run_with(struct chip8_machine *m, const struct chip8_script *s, uint64_t max_cycles,
+                   enum chip8_engine engine, struct chip8_run_result *r) {
+    struct chip8_runner rn = { engine, NULL, { s, 0 } };
+
+    if (m == NULL || r == NULL || engine >= CHIP8_ENGINE_COUNT) {
+        return -1;
+    }
+
+    if (engine == CHIP8_ENGINE_JIT && (rn.jit = chip8_jit_create()) == NULL) {
+        return -1;
+    }
+
+    int rc = chip8_runner_run(&rn, m, max_cycles, r);
+
+    chip8_jit_destroy(&rn.jit);
+    return rc;
+}
+
+int chip8_run_log(struct chip8_machine *m, struct chip8_input_log *l, uint64_t max_cycles,
+                  enum chip8_engine engine, struct chip8_run_result *r) {
+    if (m == NULL || r == NULL || engine >= CHIP8_ENGINE_COUNT) {
+        return -1;
+    }
+
+    struct chip8_jit *jit = NULL;
+    if (engine == CHIP8_ENGINE_JIT && (jit = chip8_jit_create()) == NULL) {
+        return -1;
+    }
+
+    int rc = chip8_run_input(m, log_input_apply, l, max_cycles, engine, jit, r);
+
+    chip8_jit_destroy(&jit);
+    return rc;
+}
+
+const char* chip8_halt_name(enum chip8_halt halt) {
+    switch (halt) {
+        case CHIP8_HALT_CYCLES: return "cycles";
+        case CHIP8_HALT_LOOP:   return "loop";
+        case CHIP8_HALT_ERROR:  return "error";
+    }
+
+    return "unknown";
+}
+
+const char* chip8_engine_name(enum chip8_engine engine) {
+    if (engine >= CHIP8_ENGINE_COUNT) {
+        return "unknown";
+    }
+
+    return engine_names[engine];
+}
+
+int chip8_engine_parse(const char *name) {
+    for (int e = 0; e < CHIP8_ENGINE_COUNT; e++) {
+        if (strcmp(name, engine_names[e]) == 0) {
+            return e;
+        }
+    }
+
+    return -1;
+}
@@ -0,0 +1,160 @@
+#ifndef __chip8_runner_h_
+
+#define __chip8_runner_h_
+
+#include "machine.h"
+#include "script.h"
+#include "inputlog.h"
+
+struct chip8_jit;
+
+/**
+ * Reasons a headless run stops
+ */
+enum chip8_halt {
+    CHIP8_HALT_CYCLES = 0,           /* the cycle budget was exhausted */
+    CHIP8_HALT_LOOP,                 /* the program jumped to itself */
+    CHIP8_HALT_ERROR                 /* an opcode failed to execute */
+};
+
+/**
+ * Execution engines a headless run can be driven by
+ */
+enum chip8_engine {
+    CHIP8_ENGINE_SWITCH = 0,         /* reference chip8_execute() switch */
+    CHIP8_ENGINE_TABLE,              /* precomputed decode and handler tables */
+    CHIP8_ENGINE_THREADED,           /* computed-goto threaded code */
+    CHIP8_ENGINE_JIT,                /* basic-block recompiler */
+    CHIP8_ENGINE_LANES,              /* structure-of-arrays lockstep engine */
+    CHIP8_ENGINE_COUNT
+};
+
+/* the engine chip8_run() uses follows the build-time dispatch choice */
+#if defined(CHIP8_DISPATCH_THREADED)
+#define CHIP8_ENGINE_DEFAULT CHIP8_ENGINE_THREADED
+#elif defined(CHIP8_DISPATCH_TABLE)
+#define CHIP8_ENGINE_DEFAULT CHIP8_ENGINE_TABLE
+#else
+#define CHIP8_ENGINE_DEFAULT CHIP8_ENGINE_SWITCH
+#endif
+
+/**
+ * Outcome of a headless run
+ */
+struct chip8_run_result {
+    enum chip8_halt halt;            /* why the run stopped */
+    int status;                      /* result of the last executed step */
+    uint64_t cycles;                 /* cycles executed by this run */
+};
+
+/**
+ * Runs the machine without any frontend until the cycle budget is exhausted or it halts
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {const struct chip8_script*} s The input script to drive the keys with, may be NULL
+ * @param {uint64_t} max_cycles The maximum number of cycles to execute
+ * @param {struct chip8_run_result*} r Receives the outcome of the run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run(struct chip8_machine *m, const struct chip8_script *s, uint64_t max_cycles, struct chip8_run_result *r);
+
+/**
+ * Runs the machine as chip8_run() does, through the given execution engine
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {const struct chip8_script*} s The input script to drive the keys with, may be NULL
+ * @param {uint64_t} max_cycles The maximum number of cycles to execute
+ * @param {enum chip8_engine} engine The engine to execute with
+ * @param {struct chip8_run_result*} r Receives the outcome of the run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run_with(struct chip8_machine *m, const struct chip8_script *s, uint64_t max_cycles,
+                   enum chip8_engine engine, struct chip8_run_result *r);
+
+/**
+ * Runs the machine as chip8_run_with() does, replaying the key transitions of
+ * an input log from its cursor on; the cursor is left after the last applied
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {struct chip8_input_log*} l The input log to drive the keys with, may be NULL
+ * @param {uint64_t} max_cycles The maximum number of cycles to execute
+ * @param {enum chip8_engine} engine The engine to execute with
+ * @param {struct chip8_run_result*} r Receives the outcome of the run
+ * @return {int} The outcome of the execution
+ */
+int chip8_run_log(struct chip8_machine *m, struct chip8_input_log *l, uint64_t max_cycles,
+                  enum chip8_engine engine, struct chip8_run_result *r);
+
+/**
+ * Run state a caller keeps across the runs of one machine: the engine's block
+ * cache and the position reached in the input script. A caller running the
+ * machine a tick at a time through one keeps its compiled blocks and does not
+ * replay the script from the start on every tick.
+ */
+struct chip8_runner;
+
+/**
+ * Creates the run state for an engine and input script
+ * @param {enum chip8_engine} engine The engine to execute with
+ * @param {const struct chip8_script*} s The input script to drive the keys with, may be NULL; must outlive the runner
+ * @return {struct chip8_runner*} The newly created run state, NULL on failure
+ */
+struct chip8_runner* chip8_runner_create(enum chip8_engine engine, const struct chip8_script *s);
+
+/**
+ * Destroys the given run state
+ * @param {struct chip8_runner**} p The run state to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_runner_destroy(struct chip8_runner **p);
+
+/**
+ * Forgets everything carried over from earlier runs; must be called whenever
+ * the machine was loaded or restored from anything else since the last run.
+ * The script carries on from the machine's current cycle.
+ * @param {struct chip8_runner*} rn The run state
+ * @param {const struct chip8_machine*} m The machine as it is now
+ */
+void chip8_runner_reset(struct chip8_runner *rn, const struct chip8_machine *m);
+
+/**
+ * Runs the machine as chip8_run_with() does, carrying the run state over from
+ * the previous call
+ * @param {struct chip8_runner*} rn The run state
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint64_t} max_cycles The maximum number of cycles to execute
+ * @param {struct chip8_run_result*} r Receives the outcome of the run
+ * @return {int} The outcome of the execution
+ */
+int chip8_runner_run(struct chip8_runner *rn, struct chip8_machine *m, uint64_t max_cycles, struct chip8_run_result *r);
+
+/**
+ * Runs up to count cycles through the given engine, with no input applied;
+ * the building block of chip8_run_with()
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {enum chip8_engine} engine The engine to execute with
+ * @param {struct chip8_jit*} jit The block cache of the machine; only used by CHIP8_ENGINE_JIT
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution, as chip8_run_switch() reports it
+ */
+int chip8_run_engine(struct chip8_machine *m, enum chip8_engine engine, struct chip8_jit *jit, uint64_t count);
+
+/**
+ * Gets a printable name for the given halt reason
+ * @param {enum chip8_halt} halt The halt reason
+ * @return {const char *} The name of the halt reason
+ */
+const char* chip8_halt_name(enum chip8_halt halt);
+
+/**
+ * Gets a printable name for the given engine
+ * @param {enum chip8_engine} engine The engine
+ * @return {const char *} The name of the engine
+ */
+const char* chip8_engine_name(enum chip8_engine engine);
+
+/**
+ * Looks up an engine by its printable name
+ * @param {const char *} name The name of the engine
+ * @return {int} The engine, or -1 when no engine has that name
+ */
+int chip8_engine_parse(const char *name);
+
+#endif /* __chip8_runner_h_ */
@@ -0,0 +1,85 @@
+#include "scheduler.h"
+
+#define NS_PER_SECOND   1000000000ULL
+
+uint64_t chip8_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+void chip8_sleep(uint64_t ns) {
+    struct timespec ts = { (time_t)(ns / NS_PER_SECOND), (long)(ns % NS_PER_SECOND) };
+    nanosleep(&ts, NULL);
+}
+
+void chip8_scheduler_init(struct chip8_scheduler *s, double speed, uint64_t now) {
+    memset(s, 0, sizeof(struct chip8_scheduler));
+    s->speed = speed;
+    s->max_ticks = CHIP8_MAX_CATCH_UP;
+    s->last = now;
+}
+
+uint32_t chip8_scheduler_due(struct chip8_scheduler *s, uint64_t now) {
+    if (s->speed <= CHIP8_SPEED_UNCAPPED) {
+        s->ticks += s->max_ticks;
+        return s->max_ticks;
+    }
+
+    s->owed += (double)(now - s->last) * CHIP8_TIMER_HZ * s->speed / NS_PER_SECOND;
+    s->last = now;
+
+    // a host that stalled for longer than the catch-up window loses the rest
+    if (s->owed > s->max_ticks) {
+        s->dropped += (uint64_t)(s->owed - s->max_ticks);
+        s->owed -= (uint64_t)(s->owed - s->max_ticks);
+    }
+
+    uint32_t due = (uint32_t)s->owed;
+    s->owed -= due;
+    s->ticks += due;
+
+    return due;
+}
+
+uint64_t chip8_scheduler_wait(const struct chip8_scheduler *s, uint64_t now) {
+    if (s->speed <= CHIP8_SPEED_UNCAPPED) {
+        return 0;
+    }
+
+    double owed = s->owed + (double)(now - s->last) * CHIP8_TIMER_HZ * s->speed / NS_PER_SECOND;
+
+    if (owed >= 1.0) {
+        return 0;
+    }
+
+    return (uint64_t)((1.0 - owed) * NS_PER_SECOND / (CHIP8_TIMER_HZ * s->speed));
+}
+
+int chip8_scheduler_run(struct chip8_machine *m, uint32_t ticks, struct chip8_run_result *r) {
+    uint64_t left = (uint64_t)ticks * m->ipf;
+    uint64_t start = m->cycles;
+
+    r->halt = CHIP8_HALT_CYCLES;
+    r->status = 0;
+
+    while (left > 0) {
+        chip8_run(m, NULL, left, r);
+        left -= r->cycles;
+
+        if (r->halt == CHIP8_HALT_ERROR) {
+            break;
+        }
+
+        // an idle loop still lets emulated time, and so the timers, run on
+        if (r->halt == CHIP8_HALT_LOOP) {
+            for (; left > 0; left--) {
+                chip8_step(m);
+            }
+        }
+    }
+
+    r->cycles = m->cycles - start;
+
+    return 0;
+}
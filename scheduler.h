@@ -0,0 +1,77 @@
+#ifndef __chip8_scheduler_h_
+
+#define __chip8_scheduler_h_
+
+#include "machine.h"
+#include "runner.h"
+
+/* speed of a scheduler that never waits on the host clock */
+#define CHIP8_SPEED_UNCAPPED    0.0
+
+/* ticks a scheduler catches up on in one go before it gives up on the rest */
+#define CHIP8_MAX_CATCH_UP      (CHIP8_TIMER_HZ / 4)
+
+/**
+ * Paces emulation against the host clock in 60 Hz timer ticks
+ *
+ * The machine runs ipf instructions per tick (see chip8_set_ipf()), so emulated
+ * time only depends on how many ticks the scheduler hands out. When the host
+ * falls behind, the missed ticks are run back to back in one batch; beyond
+ * max_ticks they are dropped so that a stall does not turn into a fast-forward.
+ */
+struct chip8_scheduler {
+    double speed;                    /* emulated seconds per host second; CHIP8_SPEED_UNCAPPED runs flat out */
+    uint32_t max_ticks;              /* most ticks handed out by one update */
+    uint64_t last;                   /* host time of the last update, in nanoseconds */
+    double owed;                     /* ticks due but not handed out yet */
+    uint64_t ticks;                  /* ticks handed out */
+    uint64_t dropped;                /* ticks given up on after falling behind */
+};
+
+/**
+ * Reads the host's monotonic clock
+ * @return {uint64_t} The current host time in nanoseconds
+ */
+uint64_t chip8_now(void);
+
+/**
+ * Sleeps the calling thread
+ * @param {uint64_t} ns The number of nanoseconds to sleep for
+ */
+void chip8_sleep(uint64_t ns);
+
+/**
+ * Initialises a scheduler, starting its clock now
+ * @param {struct chip8_scheduler*} s The scheduler to initialise
+ * @param {double} speed The emulation speed; 1.0 is real time, CHIP8_SPEED_UNCAPPED is unpaced
+ * @param {uint64_t} now The current host time, from chip8_now()
+ */
+void chip8_scheduler_init(struct chip8_scheduler *s, double speed, uint64_t now);
+
+/**
+ * Hands out the timer ticks that came due since the last update
+ * @param {struct chip8_scheduler*} s The scheduler to update
+ * @param {uint64_t} now The current host time, from chip8_now()
+ * @return {uint32_t} The number of ticks to run now
+ */
+uint32_t chip8_scheduler_due(struct chip8_scheduler *s, uint64_t now);
+
+/**
+ * Measures how long until the next tick comes due
+ * @param {const struct chip8_scheduler*} s The scheduler to query
+ * @param {uint64_t} now The current host time, from chip8_now()
+ * @return {uint64_t} The number of nanoseconds to wait, 0 when a tick is due
+ */
+uint64_t chip8_scheduler_wait(const struct chip8_scheduler *s, uint64_t now);
+
+/**
+ * Runs the machine for whole timer ticks through the default engine. A program
+ * that halts on a self-jump keeps spinning on it until the ticks are used up.
+ * @param {struct chip8_machine*} m The machine to run
+ * @param {uint32_t} ticks The number of ticks to run
+ * @param {struct chip8_run_result*} r Receives the outcome of the run
+ * @return {int} The outcome of the execution
+ */
+int chip8_scheduler_run(struct chip8_machine *m, uint32_t ticks, struct chip8_run_result *r);
+
+#endif /* __chip8_scheduler_h_ */
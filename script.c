@@ -0,0 +1,109 @@
+#include "script.h"
+
+/**
+ * Parses the state field of a script line
+ * @param {const char *} state The textual state
+ * @return {int} 1 for down, 0 for up, -1 when unrecognised
+ */
+static int chip8_script_state(const char *state) {
+    if (strcmp(state, "down") == 0 || strcmp(state, "1") == 0) {
+        return 1;
+    }
+
+    if (strcmp(state, "up") == 0 || strcmp(state, "0") == 0) {
+        return 0;
+    }
+
+    return -1;
+}
+
+struct chip8_script* chip8_script_load(const char *path) {
+    FILE *f = fopen(path, "r");
+
+    if (!f) {
+        return NULL;
+    }
+
+    struct chip8_script *s = calloc(1, sizeof(struct chip8_script));
+
+    if (s == NULL) {
+        fclose(f);
+        return NULL;
+    }
+
+    size_t capacity = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), f)) {
+        char *comment = strchr(line, '#');
+        if (comment) {
+            *comment = '\0';
+        }
+
+        unsigned long long cycle;
+        unsigned int key;
+        char state[16];
+
+        if (sscanf(line, "%llu %x %15s", &cycle, &key, state) != 3) {
+            continue;
+        }
+
+        int down = chip8_script_state(state);
+        if (key > 0xF || down < 0) {
+            continue;
+        }
+
+        if (s->count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            struct chip8_script_event *events = realloc(s->events, capacity * sizeof(struct chip8_script_event));
+
+            if (events == NULL) {
+                fclose(f);
+                chip8_script_destroy(&s);
+                return NULL;
+            }
+
+            s->events = events;
+        }
+
+        // keep the list ordered so that application is a single forward scan
+        size_t at = s->count;
+        while (at > 0 && s->events[at - 1].cycle > cycle) {
+            s->events[at] = s->events[at - 1];
+            at--;
+        }
+
+        s->events[at].cycle = cycle;
+        s->events[at].key = key;
+        s->events[at].down = down;
+        s->count++;
+    }
+
+    fclose(f);
+
+    return s;
+}
+
+int chip8_script_destroy(struct chip8_script **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    free((*p)->events);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+size_t chip8_script_apply(const struct chip8_script *s, size_t cursor, struct chip8_machine *m) {
+    if (s == NULL) {
+        return cursor;
+    }
+
+    while (cursor < s->count && s->events[cursor].cycle <= m->cycles) {
+        m->key[s->events[cursor].key] = s->events[cursor].down;
+        cursor++;
+    }
+
+    return cursor;
+}
@@ -0,0 +1,51 @@
+#ifndef __chip8_script_h_
+
+#define __chip8_script_h_
+
+#include "machine.h"
+
+/**
+ * A single key transition within an input script
+ */
+struct chip8_script_event {
+    uint64_t cycle;                  /* cycle at which the transition applies */
+    uint8_t key;                     /* key index (0x0 - 0xF) */
+    uint8_t down;                    /* 1 when pressed, 0 when released */
+};
+
+/**
+ * Input script; an ordered list of key transitions
+ */
+struct chip8_script {
+    struct chip8_script_event *events; /* events ordered by cycle */
+    size_t count;                    /* number of events */
+};
+
+/**
+ * Loads an input script from a text file
+ *
+ * Each non-empty line holds "<cycle> <key> <state>", where key is a hex digit
+ * and state is "down"/"up" (or 1/0). Anything after a '#' is ignored.
+ *
+ * @param {const char *} path The path to the script to load
+ * @return {struct chip8_script*} The loaded script, NULL on failure
+ */
+struct chip8_script* chip8_script_load(const char *path);
+
+/**
+ * Destroys the given input script
+ * @param {struct chip8_script**} p The script to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_script_destroy(struct chip8_script **p);
+
+/**
+ * Applies every event due at or before the machine's current cycle
+ * @param {const struct chip8_script*} s The script to apply
+ * @param {size_t} cursor The index of the next event to apply
+ * @param {struct chip8_machine*} m The machine to apply the events to
+ * @return {size_t} The index of the next pending event
+ */
+size_t chip8_script_apply(const struct chip8_script *s, size_t cursor, struct chip8_machine *m);
+
+#endif /* __chip8_script_h_ */
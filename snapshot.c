@@ -0,0 +1,220 @@
+#include "snapshot.h"
+
+/* the display is stored in a page of its own, after the memory pages */
+#define SNAPSHOT_DISPLAY    CHIP8_PAGES
+
+_Static_assert(sizeof(((struct chip8_machine*)0)->display) == CHIP8_PAGE_SIZE,
+               "the display fits in a single page");
+
+/**
+ * Page of memory shared between snapshots
+ */
+struct chip8_page {
+    uint32_t refs;                   /* number of snapshots holding the page */
+    uint8_t data[CHIP8_PAGE_SIZE];   /* page contents */
+};
+
+struct chip8_snapshot {
+    struct chip8_page *pages[CHIP8_PAGES + 1]; /* memory pages, then the display */
+    struct chip8_allocator allocator; /* of the machine; holds the snapshot and its pages */
+
+    uint8_t v[16];
+    uint16_t i;
+    uint16_t pc;
+    uint16_t stack[16];
+    uint16_t sp;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint16_t ipf;
+    uint8_t quirks;
+    uint16_t tick_left;
+    uint8_t key[16];
+    uint8_t draw_flag;
+    uint8_t beep_flag;
+    uint64_t cycles;
+    uint32_t rng;
+};
+
+/**
+ * Allocates a page holding a copy of the given data
+ * @param {const struct chip8_allocator*} a The allocator to take the page from
+ * @param {const uint8_t *} data The contents of the page
+ * @return {struct chip8_page*} The new page, NULL on failure
+ */
+static struct chip8_page* page_create(const struct chip8_allocator *a, const uint8_t *data) {
+    struct chip8_page *p = (struct chip8_page*)a->alloc(a->ctx, sizeof(struct chip8_page));
+
+    if (p == NULL) {
+        return NULL;
+    }
+
+    p->refs = 1;
+    memcpy(p->data, data, CHIP8_PAGE_SIZE);
+
+    return p;
+}
+
+/**
+ * Drops one reference to a page, freeing it with the last
+ * @param {const struct chip8_allocator*} a The allocator the page came from
+ * @param {struct chip8_page*} p The page to release
+ */
+static void page_release(const struct chip8_allocator *a, struct chip8_page *p) {
+    if (p != NULL && --p->refs == 0) {
+        a->release(a->ctx, p);
+    }
+}
+
+/**
+ * Takes the page from the base snapshot, or copies it when there is none
+ * @param {const struct chip8_allocator*} a The allocator to take a copy from
+ * @param {struct chip8_page*} shared The page held by the base, or NULL
+ * @param {const uint8_t *} data The current contents of the page
+ * @return {struct chip8_page*} The page for the new snapshot, NULL on failure
+ */
+static struct chip8_page* page_acquire(const struct chip8_allocator *a, struct chip8_page *shared, const uint8_t *data) {
+    if (shared != NULL) {
+        shared->refs++;
+        return shared;
+    }
+
+    return page_create(a, data);
+}
+
+struct chip8_snapshot* chip8_snapshot_take(struct chip8_machine *m, const struct chip8_snapshot *base) {
+    struct chip8_snapshot *s = (struct chip8_snapshot*)m->allocator.alloc(m->allocator.ctx, sizeof(struct chip8_snapshot));
+
+    if (s == NULL) {
+        return NULL;
+    }
+
+    memset(s, 0, sizeof(struct chip8_snapshot));
+    s->allocator = m->allocator;
+
+    // only the pages written since the base need a copy of their own
+    for (int p = 0; p < CHIP8_PAGES; p++) {
+        int clean = base != NULL && !(m->dirty_pages & (1u << p));
+
+        s->pages[p] = page_acquire(&s->allocator, clean ? base->pages[p] : NULL, m->memory + p * CHIP8_PAGE_SIZE);
+
+        if (s->pages[p] == NULL) {
+            chip8_snapshot_release(&s);
+            return NULL;
+        }
+    }
+
+    // drawing is not tracked, but the display is small enough to compare
+    const uint8_t *display = (const uint8_t*)m->display;
+    int same = base != NULL && memcmp(base->pages[SNAPSHOT_DISPLAY]->data, display, CHIP8_PAGE_SIZE) == 0;
+
+    s->pages[SNAPSHOT_DISPLAY] = page_acquire(&s->allocator, same ? base->pages[SNAPSHOT_DISPLAY] : NULL, display);
+
+    if (s->pages[SNAPSHOT_DISPLAY] == NULL) {
+        chip8_snapshot_release(&s);
+        return NULL;
+    }
+
+    memcpy(s->v, m->v, sizeof(s->v));
+    s->i = m->i;
+    s->pc = m->pc;
+    memcpy(s->stack, m->stack, sizeof(s->stack));
+    s->sp = m->sp;
+    s->delay_timer = m->delay_timer;
+    s->sound_timer = m->sound_timer;
+    s->ipf = m->ipf;
+    s->quirks = m->quirks;
+    s->tick_left = m->tick_left;
+    memcpy(s->key, m->key, sizeof(s->key));
+    s->draw_flag = m->draw_flag;
+    s->beep_flag = m->beep_flag;
+    s->cycles = m->cycles;
+    s->rng = m->rng;
+
+    // the machine is now in sync with the new snapshot
+    m->dirty_pages = 0;
+
+    return s;
+}
+
+int chip8_snapshot_restore(struct chip8_machine *m, const struct chip8_snapshot *s, const struct chip8_snapshot *base) {
+    if (m == NULL || s == NULL) {
+        return -1;
+    }
+
+    int rewritten = 0;
+
+    // pages the machine has not written still hold whatever the base holds
+    for (int p = 0; p < CHIP8_PAGES; p++) {
+        int clean = base != NULL && !(m->dirty_pages & (1u << p));
+
+        if (clean && base->pages[p] == s->pages[p]) {
+            continue;
+        }
+
+        memcpy(m->memory + p * CHIP8_PAGE_SIZE, s->pages[p]->data, CHIP8_PAGE_SIZE);
+        rewritten |= 1 << p;
+    }
+
+    // the frontend only redraws the rows that differ
+    const uint8_t *display = s->pages[SNAPSHOT_DISPLAY]->data;
+
+    for (int y = 0; y < VIDEO_HEIGHT; y++) {
+        uint64_t row;
+        memcpy(&row, display + y * sizeof(row), sizeof(row));
+
+        m->dirty_rows |= (uint32_t)(m->display[y] != row) << y;
+        m->display[y] = row;
+    }
+
+    memcpy(m->v, s->v, sizeof(s->v));
+    m->i = s->i;
+    m->pc = s->pc;
+    memcpy(m->stack, s->stack, sizeof(s->stack));
+    m->sp = s->sp;
+    m->delay_timer = s->delay_timer;
+    m->sound_timer = s->sound_timer;
+    m->ipf = s->ipf;
+    m->quirks = s->quirks;
+    m->tick_left = s->tick_left;
+    memcpy(m->key, s->key, sizeof(s->key));
+    m->draw_flag = s->draw_flag;
+    m->beep_flag = s->beep_flag;
+    m->cycles = s->cycles;
+    m->rng = s->rng;
+
+    m->dirty_pages = 0;
+    m->touched_pages |= rewritten;
+
+    return rewritten;
+}
+
+int chip8_snapshot_release(struct chip8_snapshot **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    for (int i = 0; i <= CHIP8_PAGES; i++) {
+        page_release(&(*p)->allocator, (*p)->pages[i]);
+    }
+
+    struct chip8_allocator a = (*p)->allocator;
+    a.release(a.ctx, *p);
+    *p = NULL;
+    return 0;
+}
+
+uint64_t chip8_snapshot_cycles(const struct chip8_snapshot *s) {
+    return s->cycles;
+}
+
+size_t chip8_snapshot_bytes(const struct chip8_snapshot *s) {
+    size_t bytes = sizeof(struct chip8_snapshot);
+
+    for (int i = 0; i <= CHIP8_PAGES; i++) {
+        if (s->pages[i]->refs == 1) {
+            bytes += sizeof(struct chip8_page);
+        }
+    }
+
+    return bytes;
+}
@@ -0,0 +1,72 @@
+#ifndef __chip8_snapshot_h_
+
+#define __chip8_snapshot_h_
+
+#include "machine.h"
+
+/**
+ * Saved machine state
+ *
+ * Memory is held in CHIP8_PAGE_SIZE pages that are shared, reference counted,
+ * between snapshots; a page is only copied when the machine wrote to it since
+ * the snapshot it was last taken from or restored to (its base). The display is
+ * held in one more page, shared whenever it did not change. Registers, timers,
+ * keys and the random number generator are copied outright.
+ *
+ * Snapshots are immutable once taken and may be restored any number of times.
+ * Reference counts are not atomic: snapshots sharing pages belong to one thread.
+ * A snapshot and its pages come from the allocator of the machine it was taken
+ * of, so snapshots sharing pages must come from machines sharing an allocator.
+ */
+struct chip8_snapshot;
+
+/**
+ * Takes a snapshot of the machine
+ *
+ * When base is given, the machine must not have been loaded or restored from
+ * anything else since base was taken from or restored into it; only the pages
+ * written since (m->dirty_pages) are copied. Without a base every page is copied.
+ *
+ * @param {struct chip8_machine*} m The machine to take the snapshot of
+ * @param {const struct chip8_snapshot*} base The snapshot the machine was last synced with, or NULL
+ * @return {struct chip8_snapshot*} The new snapshot, NULL on failure
+ */
+struct chip8_snapshot* chip8_snapshot_take(struct chip8_machine *m, const struct chip8_snapshot *base);
+
+/**
+ * Restores the machine to the state held in a snapshot
+ *
+ * The same rule for base applies as in chip8_snapshot_take(); pages the machine
+ * still shares with the snapshot through base are not copied. Any block cache of
+ * the machine must drop the pages reported as rewritten.
+ *
+ * @param {struct chip8_machine*} m The machine to restore
+ * @param {const struct chip8_snapshot*} s The snapshot to restore
+ * @param {const struct chip8_snapshot*} base The snapshot the machine was last synced with, or NULL
+ * @return {int} A bitmask of the memory pages rewritten, negative on failure
+ */
+int chip8_snapshot_restore(struct chip8_machine *m, const struct chip8_snapshot *s, const struct chip8_snapshot *base);
+
+/**
+ * Releases the given snapshot, freeing the pages no other snapshot shares
+ * @param {struct chip8_snapshot**} p The snapshot to release
+ * @return {int} The outcome of the execution
+ */
+int chip8_snapshot_release(struct chip8_snapshot **p);
+
+/**
+ * Reads the cycle count of the machine at the time of the snapshot
+ * @param {const struct chip8_snapshot*} s The snapshot to read
+ * @return {uint64_t} The number of cycles the machine had performed
+ */
+uint64_t chip8_snapshot_cycles(const struct chip8_snapshot *s);
+
+/**
+ * Counts the memory held by a snapshot alone; pages shared with other
+ * snapshots are not counted
+ * @param {const struct chip8_snapshot*} s The snapshot to measure
+ * @return {size_t} The number of bytes that releasing the snapshot would free
+ */
+size_t chip8_snapshot_bytes(const struct chip8_snapshot *s);
+
+#endif /* __chip8_snapshot_h_ */
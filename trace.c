@@ -0,0 +1,579 @@
+#include <pthread.h>
+#include <sched.h>
+#include "trace.h"
+#include "scheduler.h"
+
+/* how long the flusher sleeps when the ring is empty */
+#define TRACE_IDLE_NS       200000
+
+/* worst case block: two varint lengths, then a byte of flags per pair of
+   records and every word of every record behind its byte mask */
+#define TRACE_MAX_BLOCK     (20 + CHIP8_TRACE_CHUNK / 2 + CHIP8_TRACE_CHUNK * 4 * 9 + 1)
+
+/* slack after a block read in, so a damaged one is never decoded past the buffer */
+#define TRACE_BLOCK_SLACK   (1 + 2 * 4 * 9)
+
+/**
+ * The parts of a record predicted from the one before it; kept apart so a
+ * block is coded with them in registers
+ */
+struct trace_last {
+    uint64_t cycle;
+    uint64_t v[2];
+    uint16_t pc;
+    uint16_t i;
+    uint8_t sp;
+};
+
+/**
+ * Predicts each record from the one before it; the writer and the reader
+ * each keep one and feed it the same records. Loops run the same code over
+ * and over, so the address that followed an address last time and the
+ * opcode last seen at an address are nearly always right, leaving little
+ * more than the registers an instruction changed.
+ */
+struct trace_model {
+    struct trace_last last;          /* the last record seen */
+    uint16_t next_pc[0x1000];        /* address that followed each address last time */
+    uint16_t opcode[0x1000];         /* opcode last seen at each address */
+};
+
+struct trace_flusher {
+    FILE *f;
+    pthread_t thread;
+    atomic_int stop;
+    int finished;                    /* the thread was joined and the file closed */
+    int error;                       /* writing the file failed */
+    atomic_uint_fast64_t bytes;
+    struct trace_model model;
+    uint8_t block[TRACE_MAX_BLOCK];
+};
+
+struct chip8_trace_reader {
+    FILE *f;
+    struct trace_model model;
+    struct chip8_trace_record records[CHIP8_TRACE_CHUNK]; /* the current block */
+    size_t count;
+    size_t next;
+    uint8_t block[TRACE_MAX_BLOCK + TRACE_BLOCK_SLACK];
+};
+
+static void trace_model_init(struct trace_model *md) {
+    memset(md, 0, sizeof(struct trace_model));
+
+    for (int a = 0; a < 0x1000; a++) {
+        md->next_pc[a] = (uint16_t)(a + 2);
+    }
+}
+
+/**
+ * XORs a record with its prediction from the one before it, then learns it.
+ * The residual is four words: the cycle, the other scalars packed together,
+ * and the registers.
+ * @param {struct trace_model*} md The model to predict with
+ * @param {struct trace_last*} last The record before, which becomes this one
+ * @param {const struct chip8_trace_record*} r The record
+ * @param {uint64_t *} res Receives the residual
+ */
+static inline void trace_model_encode(struct trace_model *md, struct trace_last *last, const struct chip8_trace_record *r,
+                                      uint64_t *res) {
+    uint64_t v[2];
+    memcpy(v, r->v, sizeof(v));
+
+    uint16_t pc = r->pc ^ md->next_pc[last->pc & 0xFFF];
+    uint16_t opcode = r->opcode ^ md->opcode[r->pc & 0xFFF];
+
+    res[0] = r->cycle ^ (last->cycle + 1);
+    res[1] = pc | (uint64_t)opcode << 16 | (uint64_t)(r->i ^ last->i) << 32 |
+             (uint64_t)(r->sp ^ last->sp) << 48 | (uint64_t)r->flags << 56;
+    res[2] = v[0] ^ last->v[0];
+    res[3] = v[1] ^ last->v[1];
+
+    md->next_pc[last->pc & 0xFFF] = r->pc;
+    md->opcode[r->pc & 0xFFF] = r->opcode;
+    last->cycle = r->cycle;
+    last->pc = r->pc;
+    last->i = r->i;
+    last->sp = r->sp;
+    last->v[0] = v[0];
+    last->v[1] = v[1];
+}
+
+/**
+ * Turns a residual back into its record, then learns it
+ * @param {struct trace_model*} md The model to predict with
+ * @param {struct trace_last*} last The record before, which becomes this one
+ * @param {const uint64_t *} res The residual
+ * @param {struct chip8_trace_record*} r Receives the record
+ */
+static inline void trace_model_decode(struct trace_model *md, struct trace_last *last, const uint64_t *res,
+                                      struct chip8_trace_record *r) {
+    uint64_t v[2] = { res[2] ^ last->v[0], res[3] ^ last->v[1] };
+    uint16_t pc = (uint16_t)res[1] ^ md->next_pc[last->pc & 0xFFF];
+
+    r->cycle = res[0] ^ (last->cycle + 1);
+    r->pc = pc;
+    r->opcode = (uint16_t)(res[1] >> 16) ^ md->opcode[pc & 0xFFF];
+    r->i = (uint16_t)(res[1] >> 32) ^ last->i;
+    r->sp = (uint8_t)(res[1] >> 48) ^ last->sp;
+    r->flags = (uint8_t)(res[1] >> 56);
+    memcpy(r->v, v, sizeof(v));
+
+    md->next_pc[last->pc & 0xFFF] = pc;
+    md->opcode[pc & 0xFFF] = r->opcode;
+    last->cycle = r->cycle;
+    last->pc = pc;
+    last->i = r->i;
+    last->sp = r->sp;
+    last->v[0] = v[0];
+    last->v[1] = v[1];
+}
+
+/**
+ * Codes a non-zero word as a mask of its non-zero bytes followed by them
+ */
+static uint8_t* trace_put_word(uint8_t *out, uint64_t w) {
+    uint8_t *mask = out++;
+    uint8_t m = 0;
+
+    while (w != 0) {
+        int b = __builtin_ctzll(w) >> 3;
+
+        m |= 1 << b;
+        *out++ = (uint8_t)(w >> (b * 8));
+        w &= ~((uint64_t)0xFF << (b * 8));
+    }
+
+    *mask = m;
+    return out;
+}
+
+static const uint8_t* trace_get_word(const uint8_t *in, uint64_t *w) {
+    uint8_t m = *in++;
+    uint64_t v = 0;
+
+    for (int b = 0; b < 8; b++) {
+        if (m & (1 << b)) {
+            v |= (uint64_t)*in++ << (b * 8);
+        }
+    }
+
+    *w = v;
+    return in;
+}
+
+/**
+ * Codes a run of records: for every pair, a byte holding a nibble per record
+ * with a bit for each non-zero word of its residual, then those words
+ * @return {size_t} The number of bytes written to out
+ */
+static size_t trace_encode(struct trace_model *md, const struct chip8_trace_record *records, size_t count, uint8_t *out) {
+    uint8_t *o = out;
+    uint8_t *flags = NULL;
+
+    struct trace_last last = md->last;
+
+    for (size_t k = 0; k < count; k++) {
+        uint64_t res[4];
+        uint8_t nibble = 0;
+
+        trace_model_encode(md, &last, &records[k], res);
+
+        if (!(k & 1)) {
+            flags = o++;
+            *flags = 0;
+        }
+
+        for (int w = 0; w < 4; w++) {
+            if (res[w] != 0) {
+                nibble |= 1 << w;
+                o = trace_put_word(o, res[w]);
+            }
+        }
+
+        *flags |= nibble << (k & 1 ? 4 : 0);
+    }
+
+    md->last = last;
+    return o - out;
+}
+
+/**
+ * Decodes a run of records coded by trace_encode()
+ * @return {int} The outcome of the execution; -1 when the block does not hold them
+ */
+static int trace_decode(struct trace_model *md, const uint8_t *in, size_t length, struct chip8_trace_record *records,
+                        size_t count) {
+    const uint8_t *end = in + length;
+    struct trace_last last = md->last;
+    uint8_t flags = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        uint64_t res[4];
+
+        if (!(k & 1)) {
+            flags = *in++;
+        }
+
+        uint8_t nibble = k & 1 ? flags >> 4 : flags & 0xF;
+
+        for (int w = 0; w < 4; w++) {
+            res[w] = 0;
+
+            if (nibble & (1 << w)) {
+                in = trace_get_word(in, &res[w]);
+            }
+        }
+
+        // the block is followed by enough slack for one pair to overrun it
+        if (in > end) {
+            return -1;
+        }
+
+        trace_model_decode(md, &last, res, &records[k]);
+    }
+
+    md->last = last;
+    return in == end ? 0 : -1;
+}
+
+static uint8_t* trace_put_varint(uint8_t *out, uint64_t n) {
+    while (n >= 0x80) {
+        *out++ = (uint8_t)(n | 0x80);
+        n >>= 7;
+    }
+
+    *out++ = (uint8_t)n;
+    return out;
+}
+
+/**
+ * Reads a varint off the file
+ * @return {int} 1 when read, 0 at the end of the file, -1 when it overflows
+ */
+static int trace_get_varint(FILE *f, uint64_t *n) {
+    uint64_t v = 0;
+    int c;
+
+    for (int shift = 0; ; shift += 7) {
+        if (shift > 63) {
+            return -1;
+        }
+
+        if ((c = fgetc(f)) == EOF) {
+            return 0;
+        }
+
+        v |= (uint64_t)(c & 0x7F) << shift;
+
+        if (!(c & 0x80)) {
+            break;
+        }
+    }
+
+    *n = v;
+    return 1;
+}
+
+/**
+ * Compresses one run of records out to the file as a block
+ */
+static void trace_write_block(struct trace_flusher *fl, const struct chip8_trace_record *records, size_t count) {
+    // the lengths go in front of the records they count, so leave room for them
+    uint8_t *data = fl->block + 20;
+    size_t length = trace_encode(&fl->model, records, count, data);
+
+    uint8_t lengths[20];
+    uint8_t *end = trace_put_varint(trace_put_varint(lengths, count), length);
+    size_t prefix = end - lengths;
+
+    memcpy(data - prefix, lengths, prefix);
+
+    if (!fl->error && fwrite(data - prefix, prefix + length, 1, fl->f) != 1) {
+        fl->error = 1;
+    }
+
+    atomic_fetch_add_explicit(&fl->bytes, prefix + length, memory_order_relaxed);
+}
+
+static void* trace_flush_main(void *arg) {
+    struct chip8_trace *t = (struct chip8_trace*)arg;
+    struct trace_flusher *fl = t->flusher;
+    uint64_t flushed = 0;
+
+    for (;;) {
+        // once stopped, nothing more is published after what is read here
+        int stop = atomic_load_explicit(&fl->stop, memory_order_acquire);
+        uint64_t published = atomic_load_explicit(&t->published, memory_order_acquire);
+
+        if (published == flushed) {
+            if (stop) {
+                break;
+            }
+
+            chip8_sleep(TRACE_IDLE_NS);
+            continue;
+        }
+
+        uint64_t at = flushed & t->mask;
+        uint64_t count = published - flushed;
+
+        if (count > CHIP8_TRACE_CHUNK) {
+            count = CHIP8_TRACE_CHUNK;
+        }
+
+        if (count > t->mask + 1 - at) {
+            count = t->mask + 1 - at;
+        }
+
+        trace_write_block(fl, &t->ring[at], count);
+
+        flushed += count;
+        atomic_store_explicit(&t->flushed, flushed, memory_order_release);
+    }
+
+    return NULL;
+}
+
+struct chip8_trace* chip8_trace_create(const char *path, size_t records) {
+    size_t size = CHIP8_TRACE_CHUNK;
+
+    if (records == 0) {
+        records = CHIP8_TRACE_DEFAULT_RING;
+    }
+
+    while (size < records && size < ((size_t)1 << 40)) {
+        size <<= 1;
+    }
+
+    struct chip8_trace *t = aligned_alloc(64, sizeof(struct chip8_trace));
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    memset(t, 0, sizeof(struct chip8_trace));
+    atomic_init(&t->published, 0);
+    atomic_init(&t->flushed, 0);
+
+    t->ring = aligned_alloc(64, size * sizeof(struct chip8_trace_record));
+    t->flusher = malloc(sizeof(struct trace_flusher));
+    t->mask = size - 1;
+    t->limit = size;
+
+    if (t->ring == NULL || t->flusher == NULL) {
+        free(t->ring);
+        free(t->flusher);
+        free(t);
+        return NULL;
+    }
+
+    struct trace_flusher *fl = t->flusher;
+
+    memset(fl, 0, sizeof(struct trace_flusher));
+    atomic_init(&fl->stop, 0);
+    atomic_init(&fl->bytes, CHIP8_TRACE_HEADER);
+    trace_model_init(&fl->model);
+
+    uint8_t header[CHIP8_TRACE_HEADER] = {
+        CHIP8_TRACE_MAGIC[0], CHIP8_TRACE_MAGIC[1], CHIP8_TRACE_MAGIC[2], CHIP8_TRACE_MAGIC[3],
+        CHIP8_TRACE_VERSION, sizeof(struct chip8_trace_record), 0, 0
+    };
+
+    if ((fl->f = fopen(path, "wb")) == NULL || fwrite(header, sizeof(header), 1, fl->f) != 1 ||
+        pthread_create(&fl->thread, NULL, trace_flush_main, t) != 0) {
+        if (fl->f) {
+            fclose(fl->f);
+        }
+
+        free(t->ring);
+        free(t->flusher);
+        free(t);
+        return NULL;
+    }
+
+    return t;
+}
+
+int chip8_trace_finish(struct chip8_trace *t) {
+    if (t == NULL) {
+        return -1;
+    }
+
+    struct trace_flusher *fl = t->flusher;
+
+    if (!fl->finished) {
+        if (t->machine != NULL) {
+            chip8_trace_attach(t->machine, NULL);
+        }
+
+        atomic_store_explicit(&t->published, t->head, memory_order_release);
+        atomic_store_explicit(&fl->stop, 1, memory_order_release);
+        pthread_join(fl->thread, NULL);
+
+        if (fclose(fl->f) != 0) {
+            fl->error = 1;
+        }
+
+        fl->finished = 1;
+    }
+
+    return fl->error ? -1 : 0;
+}
+
+int chip8_trace_destroy(struct chip8_trace **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    chip8_trace_finish(*p);
+
+    free((*p)->ring);
+    free((*p)->flusher);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+#ifdef CHIP8_TRACE
+/**
+ * Closes off what a machine recorded with the state it was left in
+ */
+static void trace_end(struct chip8_trace *t, const struct chip8_machine *m) {
+    uint16_t opcode = m->pc < 0xFFF ? m->memory[m->pc] << 8 | m->memory[m->pc + 1] : 0;
+
+    chip8_trace_hit(t, m, m->cycles + 1, opcode);
+    t->ring[(t->head - 1) & t->mask].flags = CHIP8_TRACE_END;
+
+    atomic_store_explicit(&t->published, t->head, memory_order_release);
+}
+#endif
+
+int chip8_trace_attach(struct chip8_machine *m, struct chip8_trace *t) {
+#ifdef CHIP8_TRACE
+    if (m == NULL || (t != NULL && (t->flusher->finished || (t->machine != NULL && t->machine != m)))) {
+        return -1;
+    }
+
+    if (m->trace != NULL) {
+        trace_end(m->trace, m);
+        m->trace->machine = NULL;
+    }
+
+    m->trace = t;
+
+    if (t != NULL) {
+        t->machine = m;
+    }
+
+    return 0;
+#else
+    (void)m;
+    (void)t;
+    return -1;
+#endif
+}
+
+void chip8_trace_stats(const struct chip8_trace *t, struct chip8_trace_stats *st) {
+    st->records = atomic_load_explicit(&t->flushed, memory_order_acquire);
+    st->bytes = atomic_load_explicit(&t->flusher->bytes, memory_order_relaxed);
+    st->stalls = t->stalls;
+}
+
+void chip8_trace_wait(struct chip8_trace *t) {
+    // the flusher can only make room once it sees everything written so far
+    atomic_store_explicit(&t->published, t->head, memory_order_release);
+
+    for (int waited = 0; ; waited = 1) {
+        t->limit = atomic_load_explicit(&t->flushed, memory_order_acquire) + t->mask + 1;
+
+        if (t->head != t->limit) {
+            t->stalls += waited;
+            return;
+        }
+
+        sched_yield();
+    }
+}
+
+struct chip8_trace_reader* chip8_trace_reader_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        return NULL;
+    }
+
+    uint8_t header[CHIP8_TRACE_HEADER];
+    struct chip8_trace_reader *r = NULL;
+
+    if (fread(header, sizeof(header), 1, f) != 1 || memcmp(header, CHIP8_TRACE_MAGIC, 4) != 0 ||
+        header[4] != CHIP8_TRACE_VERSION || header[5] != sizeof(struct chip8_trace_record) ||
+        (r = malloc(sizeof(struct chip8_trace_reader))) == NULL) {
+        fclose(f);
+        return NULL;
+    }
+
+    r->f = f;
+    r->count = 0;
+    r->next = 0;
+    trace_model_init(&r->model);
+
+    return r;
+}
+
+/**
+ * Reads the next block of records
+ * @return {int} 1 when read, 0 at the end of the trace, -1 when the file is damaged
+ */
+static int trace_read_block(struct chip8_trace_reader *r) {
+    uint64_t count, length;
+    int rc;
+
+    if ((rc = trace_get_varint(r->f, &count)) <= 0 || (rc = trace_get_varint(r->f, &length)) <= 0) {
+        return rc;
+    }
+
+    if (count == 0 || count > CHIP8_TRACE_CHUNK || length > TRACE_MAX_BLOCK - 20) {
+        return -1;
+    }
+
+    // a block cut short ends the trace, as a writer killed mid-write leaves it
+    if (length > 0 && fread(r->block, length, 1, r->f) != 1) {
+        return 0;
+    }
+
+    memset(r->block + length, 0, TRACE_BLOCK_SLACK);
+
+    if (trace_decode(&r->model, r->block, length, r->records, count) < 0) {
+        return -1;
+    }
+
+    r->count = count;
+    r->next = 0;
+
+    return 1;
+}
+
+int chip8_trace_reader_next(struct chip8_trace_reader *r, struct chip8_trace_record *rec) {
+    if (r->next == r->count) {
+        int rc = trace_read_block(r);
+
+        if (rc <= 0) {
+            return rc;
+        }
+    }
+
+    *rec = r->records[r->next++];
+    return 1;
+}
+
+int chip8_trace_reader_close(struct chip8_trace_reader **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    fclose((*p)->f);
+    free(*p);
+    *p = NULL;
+    return 0;
+}
@@ -0,0 +1,185 @@
+#ifndef __chip8_trace_h_
+
+#define __chip8_trace_h_
+
+#include <stdatomic.h>
+#include "machine.h"
+
+#define CHIP8_TRACE_MAGIC       "C8TR"
+#define CHIP8_TRACE_VERSION     1
+#define CHIP8_TRACE_HEADER      8
+
+/* records published and compressed together; a power of two */
+#define CHIP8_TRACE_CHUNK       4096
+
+/* ring size used when the caller asks for none, in records; 2 MB stays in cache */
+#define CHIP8_TRACE_DEFAULT_RING (1 << 16)
+
+/* flags of a record */
+#define CHIP8_TRACE_END         0x01 /* the state the machine was left in; nothing executed */
+
+/**
+ * One executed instruction and the state it started from
+ *
+ * What an instruction changed is the difference to the record after it, as
+ * long as that record's cycle follows on; a trace detached from its machine
+ * closes with a CHIP8_TRACE_END record for that reason. Memory is only ever
+ * written by FX33 and FX55, whose bytes follow from I and the registers.
+ */
+struct chip8_trace_record {
+    uint64_t cycle;                  /* cycle count after the instruction's fetch */
+    uint16_t pc;                     /* address of the instruction */
+    uint16_t opcode;
+    uint16_t i;                      /* index register before the instruction */
+    uint8_t sp;                      /* stack pointer before the instruction */
+    uint8_t flags;                   /* CHIP8_TRACE_ bits */
+    uint8_t v[16];                   /* general registers before the instruction */
+};
+
+_Static_assert(sizeof(struct chip8_trace_record) == 32, "trace records are 32 bytes");
+
+/**
+ * Execution trace; a lock-free ring of records between the thread running a
+ * machine and a flusher thread that compresses them out to a file
+ *
+ * The machine's thread writes records into the ring and publishes them a
+ * chunk at a time with a single release store, so the cache line the flusher
+ * polls is touched once per CHIP8_TRACE_CHUNK instructions. When the ring is
+ * full the machine waits for the flusher rather than drop records.
+ *
+ * The file holds a CHIP8_TRACE_HEADER byte header (magic, version, record
+ * size) and then one block per chunk: the record count and the encoded
+ * length as varints, then the records. Each is XORed with a prediction made
+ * from the record before it, and only the non-zero bytes of what is left are
+ * kept, behind a bit per word and a byte mask per non-zero word. Records are
+ * stored in the byte order of the host that wrote them.
+ *
+ * Instructions are only recorded in builds configured with CHIP8_TRACE;
+ * without it the hooks compile to nothing and chip8_trace_attach() fails.
+ * The lanes engine records only the instructions it steps one machine at a
+ * time. A trace is fed by one machine at a time.
+ */
+struct chip8_trace {
+    struct chip8_trace_record *ring;
+    uint64_t mask;                   /* ring size in records, less one */
+    uint64_t head;                   /* records written; the machine's thread only */
+    uint64_t limit;                  /* head may not reach this before the flusher moves on */
+    uint64_t stalls;                 /* times the machine waited on a full ring */
+    struct chip8_machine *machine;   /* the machine attached, if any */
+
+    _Alignas(64) atomic_uint_fast64_t published; /* records the flusher may take */
+    _Alignas(64) atomic_uint_fast64_t flushed;   /* records the flusher is done with */
+
+    struct trace_flusher *flusher;   /* owned by the flusher thread until it stops */
+};
+
+/**
+ * Totals of a trace
+ */
+struct chip8_trace_stats {
+    uint64_t records;                /* records written out */
+    uint64_t bytes;                  /* bytes written to the file, header included */
+    uint64_t stalls;                 /* times the machine waited on a full ring */
+};
+
+/**
+ * Creates a trace writing to the given file and starts its flusher thread
+ * @param {const char *} path The path of the file to write
+ * @param {size_t} records The size of the ring in records, rounded up to a whole number of chunks and a power of two; 0 for the default
+ * @return {struct chip8_trace*} The newly created trace, NULL on failure
+ */
+struct chip8_trace* chip8_trace_create(const char *path, size_t records);
+
+/**
+ * Detaches the trace from its machine, writes out everything recorded and
+ * stops the flusher; the totals are final once this returns
+ * @param {struct chip8_trace*} t The trace to finish
+ * @return {int} The outcome of the execution; -1 when writing the file failed
+ */
+int chip8_trace_finish(struct chip8_trace *t);
+
+/**
+ * Finishes and destroys the given trace
+ * @param {struct chip8_trace**} p The trace to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_trace_destroy(struct chip8_trace **p);
+
+/**
+ * Starts recording the instructions a machine executes into a trace. The
+ * trace the machine recorded into before, if any, is closed off with a
+ * CHIP8_TRACE_END record.
+ * @param {struct chip8_machine*} m The machine to trace
+ * @param {struct chip8_trace*} t The trace to record into, NULL to stop
+ * @return {int} The outcome of the execution; -1 in builds without CHIP8_TRACE
+ */
+int chip8_trace_attach(struct chip8_machine *m, struct chip8_trace *t);
+
+/**
+ * Gets the totals of a trace
+ * @param {const struct chip8_trace*} t The trace to read
+ * @param {struct chip8_trace_stats*} st Receives the totals
+ */
+void chip8_trace_stats(const struct chip8_trace *t, struct chip8_trace_stats *st);
+
+/**
+ * Waits for the flusher to make room in a full ring
+ * @param {struct chip8_trace*} t The trace to wait on
+ */
+void chip8_trace_wait(struct chip8_trace *t);
+
+/**
+ * Records one instruction about to execute
+ * @param {struct chip8_trace*} t The trace to record into
+ * @param {const struct chip8_machine*} m The machine executing it
+ * @param {uint64_t} cycle The cycle count after the instruction's fetch
+ * @param {uint16_t} opcode The instruction
+ */
+static inline void chip8_trace_hit(struct chip8_trace *t, const struct chip8_machine *m, uint64_t cycle, uint16_t opcode) {
+    if (t->head == t->limit) {
+        chip8_trace_wait(t);
+    }
+
+    struct chip8_trace_record *r = &t->ring[t->head & t->mask];
+
+    r->cycle = cycle;
+    r->pc = m->pc;
+    r->opcode = opcode;
+    r->i = m->i;
+    r->sp = (uint8_t)m->sp;
+    r->flags = 0;
+    memcpy(r->v, m->v, sizeof(r->v));
+
+    if ((++t->head & (CHIP8_TRACE_CHUNK - 1)) == 0) {
+        atomic_store_explicit(&t->published, t->head, memory_order_release);
+    }
+}
+
+/**
+ * Reader of a trace file
+ */
+struct chip8_trace_reader;
+
+/**
+ * Opens a trace file for reading
+ * @param {const char *} path The path of the trace
+ * @return {struct chip8_trace_reader*} The reader, NULL when the file is no trace
+ */
+struct chip8_trace_reader* chip8_trace_reader_open(const char *path);
+
+/**
+ * Reads the next record of a trace
+ * @param {struct chip8_trace_reader*} r The reader to read from
+ * @param {struct chip8_trace_record*} rec Receives the record
+ * @return {int} 1 when a record was read, 0 at the end of the trace, -1 when the file is damaged
+ */
+int chip8_trace_reader_next(struct chip8_trace_reader *r, struct chip8_trace_record *rec);
+
+/**
+ * Closes the given trace reader
+ * @param {struct chip8_trace_reader**} p The reader to close
+ * @return {int} The outcome of the execution
+ */
+int chip8_trace_reader_close(struct chip8_trace_reader **p);
+
+#endif /* __chip8_trace_h_ */
@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "trace.h"
+#include "decode.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-f cycle] [-n count] trace\n", name);
+    fprintf(stderr, "  -f cycle    start at the first instruction at or after this cycle (default 0)\n");
+    fprintf(stderr, "  -n count    print at most this many instructions (default: all)\n");
+    fprintf(stderr, "Prints one line per instruction: the cycle, address, opcode and disassembly, then\n");
+    fprintf(stderr, "the registers it changed and the memory it wrote.\n");
+}
+
+/**
+ * Prints what the instruction of a record did; the registers come from the
+ * record after it, the memory writes from the instruction itself
+ * @param {const struct chip8_trace_record*} r The record of the instruction
+ * @param {const struct chip8_trace_record*} next The record after it, NULL when it does not follow on
+ */
+static void print_changes(const struct chip8_trace_record *r, const struct chip8_trace_record *next) {
+    uint8_t x = (r->opcode >> 8) & 0xF;
+
+    if (next != NULL) {
+        for (int v = 0; v < 16; v++) {
+            if (next->v[v] != r->v[v]) {
+                printf(" V%X=%02X", v, next->v[v]);
+            }
+        }
+
+        if (next->i != r->i) {
+            printf(" I=%03X", next->i);
+        }
+
+        if (next->sp != r->sp) {
+            printf(" SP=%X", next->sp);
+        }
+    }
+
+    if ((r->opcode & 0xF0FF) == 0xF033) {
+        printf(" [%03X]=%02X %02X %02X", r->i, r->v[x] / 100, r->v[x] / 10 % 10, r->v[x] % 10);
+    } else if ((r->opcode & 0xF0FF) == 0xF055) {
+        printf(" [%03X]=", r->i);
+
+        for (int v = 0; v <= x; v++) {
+            printf("%s%02X", v ? " " : "", r->v[v]);
+        }
+    } else if (next == NULL) {
+        printf(" ...");
+    }
+}
+
+static void print_record(const struct chip8_trace_record *r, const struct chip8_trace_record *next) {
+    char text[32];
+
+    chip8_disassemble(r->opcode, text, sizeof(text));
+    printf("%12" PRIu64 "  %03X  %04X  %-16s", r->cycle, r->pc, r->opcode, text);
+
+    // an instruction's changes only show when the next record carries on from it
+    print_changes(r, next && next->cycle == r->cycle + 1 ? next : NULL);
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t first = 0;
+    uint64_t limit = UINT64_MAX;
+    int a = 1;
+
+    for (; a < argc && argv[a][0] == '-'; a++) {
+        if (a + 1 >= argc) {
+            usage(argv[0]);
+            return 2;
+        }
+
+        if (strcmp(argv[a], "-f") == 0) {
+            first = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-n") == 0) {
+            limit = strtoull(argv[++a], NULL, 0);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (a + 1 != argc) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_trace_reader *r = chip8_trace_reader_open(argv[a]);
+    if (r == NULL) {
+        fprintf(stderr, "unable to read trace %s\n", argv[a]);
+        return 1;
+    }
+
+    struct chip8_trace_record cur, next;
+    uint64_t printed = 0;
+    int rc = chip8_trace_reader_next(r, &cur);
+
+    while (rc > 0 && printed < limit) {
+        rc = chip8_trace_reader_next(r, &next);
+
+        if (cur.cycle >= first) {
+            if (cur.flags & CHIP8_TRACE_END) {
+                printf("%12" PRIu64 "  %03X  end of trace\n", cur.cycle, cur.pc);
+            } else {
+                print_record(&cur, rc > 0 ? &next : NULL);
+                printed++;
+            }
+        }
+
+        if (rc <= 0) {
+            break;
+        }
+
+        cur = next;
+    }
+
+    chip8_trace_reader_close(&r);
+
+    if (rc < 0) {
+        fprintf(stderr, "trace %s is damaged\n", argv[a]);
+        return 1;
+    }
+
+    return 0;
+}
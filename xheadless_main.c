@@ -0,0 +1,141 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include "xmachine.h"
+#include "script.h"
+#include "dispatch.h"
+#include "scheduler.h"
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [-c cycles] [-i script] [-q quirks] [-s seed] [-f ipf] [-d] rom\n", name);
+    fprintf(stderr, "  -c cycles   maximum number of cycles to run (default 1000000)\n");
+    fprintf(stderr, "  -i script   input script of \"<cycle> <key> <down|up>\" lines\n");
+    fprintf(stderr, "  -q quirks   quirk profile: modern, vip, chip48, schip or xochip (default %s)\n", chip8_quirks_name(CHIP8_QUIRKS_XOCHIP));
+    fprintf(stderr, "  -s seed     random number generator seed (default: from the clock)\n");
+    fprintf(stderr, "  -f ipf      instructions per 60 Hz timer tick (default %d)\n", CHIP8_DEFAULT_IPF);
+    fprintf(stderr, "  -d          dump the final display, one character per colour\n");
+}
+
+static void dump_display(const struct chip8_xmachine *x) {
+    static const char colours[] = ".#+@";
+
+    for (int y = 0; y < XVIDEO_HEIGHT; y++) {
+        for (int px = 0; px < XVIDEO_WIDTH; px++) {
+            putchar(colours[chip8_xdisplay_pixel(x, px, y)]);
+        }
+        putchar('\n');
+    }
+}
+
+/**
+ * Runs the machine up to max_cycles, applying the key transitions of the
+ * script at their cycles
+ * @return {int} The outcome of the execution
+ */
+static int run_script(struct chip8_xmachine *x, const struct chip8_script *s, uint64_t max_cycles) {
+    size_t next = 0;
+    int rc = 0;
+
+    while (rc == 0 && x->cycles < max_cycles) {
+        uint64_t until = max_cycles;
+
+        for (; s && next < s->count && s->events[next].cycle <= x->cycles; next++) {
+            x->key[s->events[next].key & 0xF] = s->events[next].down;
+        }
+
+        if (s && next < s->count && s->events[next].cycle < until) {
+            until = s->events[next].cycle;
+        }
+
+        rc = chip8_xrun(x, until - x->cycles);
+    }
+
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    uint64_t max_cycles = 1000000;
+    const char *script_path = NULL;
+    const char *rom_path = NULL;
+    int quirks = CHIP8_QUIRKS_XOCHIP;
+    int dump = 0;
+    uint16_t ipf = CHIP8_DEFAULT_IPF;
+    int seeded = 0;
+    uint32_t seed = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-c") == 0 && a + 1 < argc) {
+            max_cycles = strtoull(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-i") == 0 && a + 1 < argc) {
+            script_path = argv[++a];
+        } else if (strcmp(argv[a], "-q") == 0 && a + 1 < argc) {
+            if ((quirks = chip8_quirks_parse(argv[++a])) < 0) {
+                usage(argv[0]);
+                return 2;
+            }
+        } else if (strcmp(argv[a], "-s") == 0 && a + 1 < argc) {
+            seed = strtoul(argv[++a], NULL, 0);
+            seeded = 1;
+        } else if (strcmp(argv[a], "-f") == 0 && a + 1 < argc) {
+            ipf = (uint16_t)strtoul(argv[++a], NULL, 0);
+        } else if (strcmp(argv[a], "-d") == 0) {
+            dump = 1;
+        } else if (argv[a][0] != '-' && rom_path == NULL) {
+            rom_path = argv[a];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (rom_path == NULL || ipf == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct chip8_xmachine *x = chip8_xmachine_create(quirks);
+    if (x == NULL || !chip8_xload(x, rom_path)) {
+        fprintf(stderr, "unable to load %s\n", rom_path);
+        chip8_xmachine_destroy(&x);
+        return 1;
+    }
+
+    x->ipf = x->tick_left = ipf;
+
+    if (seeded) {
+        chip8_xseed(x, seed);
+    }
+
+    struct chip8_script *s = NULL;
+    if (script_path && (s = chip8_script_load(script_path)) == NULL) {
+        fprintf(stderr, "unable to load script %s\n", script_path);
+        chip8_xmachine_destroy(&x);
+        return 1;
+    }
+
+    uint64_t start = chip8_now();
+    int rc = run_script(x, s, max_cycles);
+    double seconds = (chip8_now() - start) / 1e9;
+
+    printf("halt: %s\n", rc == CHIP8_RUN_EXIT ? "exit" : rc == CHIP8_RUN_LOOP ? "loop" : rc < 0 ? "error" : "cycles");
+    printf("status: %d\n", rc < 0 ? rc : 0);
+    printf("cycles: %" PRIu64 "\n", x->cycles);
+    printf("pc: %04X i: %04X sp: %d hires: %d planes: %d\n", x->pc, x->i, x->sp, x->hires, x->planes);
+
+    printf("v:");
+    for (int i = 0; i < 16; i++) {
+        printf(" %02X", x->v[i]);
+    }
+    printf("\n");
+
+    printf("frame: %016" PRIx64 "\n", chip8_xdisplay_hash(x));
+    fprintf(stderr, "%.1f MIPS\n", seconds > 0 ? x->cycles / seconds / 1e6 : 0.0);
+
+    if (dump) {
+        dump_display(x);
+    }
+
+    chip8_script_destroy(&s);
+    chip8_xmachine_destroy(&x);
+
+    return rc < 0 ? 1 : 0;
+}
@@ -0,0 +1,731 @@
+#include "xmachine.h"
+#include "machine_ops.h"
+#include "dispatch.h"
+
+/* the small font, shared with the base machine; loaded at 0x000 */
+extern uint8_t font_data[];
+
+/* the large 8x10 font of SUPER-CHIP, with XO-CHIP's A - F; loaded at CHIP8_XBIG_FONT */
+static const uint8_t big_font_data[] = {
+    0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+    0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+    0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+    0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+    0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+    0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+    0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+    0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+    0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+    0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, // B
+    0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C, // C
+    0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, // E
+    0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+
+struct chip8_xmachine* chip8_xmachine_create(enum chip8_quirks q) {
+    struct chip8_xmachine *x = malloc(sizeof(struct chip8_xmachine));
+
+    if (x == NULL) {
+        return NULL;
+    }
+
+    chip8_xmachine_init(x, q);
+    chip8_xseed(x, (uint32_t)clock());
+
+    return x;
+}
+
+void chip8_xmachine_init(struct chip8_xmachine *x, enum chip8_quirks q) {
+    memset(x, 0, sizeof(struct chip8_xmachine));
+    memcpy(x->memory, font_data, 80);
+    memcpy(x->memory + CHIP8_XBIG_FONT, big_font_data, sizeof(big_font_data));
+    x->ipf = CHIP8_DEFAULT_IPF;
+    x->tick_left = CHIP8_DEFAULT_IPF;
+    x->quirks = (unsigned)q < CHIP8_QUIRKS_COUNT ? q : CHIP8_QUIRKS_MODERN;
+    x->planes = 0x1;
+    x->dirty_rows = UINT64_MAX;
+
+    chip8_xseed(x, 0);
+}
+
+int chip8_xmachine_destroy(struct chip8_xmachine **p) {
+    if (p == NULL || *p == NULL) {
+        return -1;
+    }
+
+    free(*p);
+    *p = NULL;
+    return 0;
+}
+
+void chip8_xseed(struct chip8_xmachine *x, uint32_t seed) {
+    // xorshift state must never be zero
+    x->rng = seed ? seed : 0x9E3779B9;
+}
+
+int chip8_xload(struct chip8_xmachine *x, const char *path) {
+    FILE *f = fopen(path, "rb");
+
+    if (!f) {
+        return 0;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long fsize = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if (fsize <= 0 || fsize > CHIP8_XPROGRAM_MAX || fread(x->memory + CHIP8_PROGRAM_START, fsize, 1, f) != 1) {
+        fclose(f);
+        return 0;
+    }
+
+    fclose(f);
+
+    x->pc = CHIP8_PROGRAM_START;
+    return 1;
+}
+
+int chip8_xload_memory(struct chip8_xmachine *x, const uint8_t *data, size_t size) {
+    if (size > CHIP8_XPROGRAM_MAX) {
+        return 0;
+    }
+
+    memcpy(x->memory + CHIP8_PROGRAM_START, data, size);
+    x->pc = CHIP8_PROGRAM_START;
+    return 1;
+}
+
+/**
+ * Reads the big-endian word at an address, wrapping at the end of memory
+ */
+static inline uint16_t xmachine_word(const struct chip8_xmachine *x, uint16_t addr) {
+    return x->memory[addr] << 8 | x->memory[(uint16_t)(addr + 1)];
+}
+
+/**
+ * Progresses the cycle count, and the timers once every ipf cycles
+ */
+static inline void xmachine_cycle(struct chip8_xmachine *x) {
+    if (--x->tick_left == 0) {
+        x->tick_left = x->ipf;
+
+        if (x->delay_timer > 0) {
+            x->delay_timer --;
+        }
+
+        if (x->sound_timer > 0) {
+            x->sound_timer --;
+
+            if (x->sound_timer == 0) {
+                x->beep_flag = 1;
+            }
+        }
+    }
+
+    x->cycles ++;
+}
+
+/**
+ * Advances the random number generator of the machine (xorshift32)
+ */
+static inline uint32_t xmachine_random(struct chip8_xmachine *x) {
+    uint32_t r = x->rng;
+
+    r ^= r << 13;
+    r ^= r >> 17;
+    r ^= r << 5;
+
+    return x->rng = r;
+}
+
+/**
+ * Moves past a skip instruction; a taken skip steps over the whole of a
+ * following F000 NNNN
+ * @param {int} taken Non-zero when the condition of the skip holds
+ */
+static inline void xmachine_skip(struct chip8_xmachine *x, int taken) {
+    x->pc += 2;
+
+    if (taken) {
+        x->pc += xmachine_word(x, x->pc) == 0xF000 ? 4 : 2;
+    }
+}
+
+/**
+ * Doubles every pixel of a sprite byte, for drawing in low resolution
+ * @param {uint8_t} b The sprite byte
+ * @return {uint16_t} The byte with every bit repeated
+ */
+static inline uint16_t xmachine_double(uint8_t b) {
+    uint32_t v = b;
+
+    v = (v | v << 4) & 0x0F0F;
+    v = (v | v << 2) & 0x3333;
+    v = (v | v << 1) & 0x5555;
+
+    return v | v << 1;
+}
+
+/**
+ * Expands one row of sprite data into display pixels, the leftmost in the top bit
+ * @param {uint16_t} line The sprite row, 8 or 16 pixels
+ * @param {int} wide Non-zero for a 16-pixel row
+ * @param {int} lores Non-zero to double every pixel
+ * @return {uint64_t} The pixels
+ */
+static inline uint64_t xmachine_sprite_row(uint16_t line, int wide, int lores) {
+    if (!lores) {
+        return (uint64_t)line << (wide ? 48 : 56);
+    }
+
+    if (wide) {
+        return ((uint64_t)xmachine_double(line >> 8) << 16 | xmachine_double(line & 0xFF)) << 32;
+    }
+
+    return (uint64_t)xmachine_double(line) << 48;
+}
+
+/**
+ * XORs the rows of one plane's sprite data onto a display plane; wide and
+ * lores are constants at every call, so each combination gets its own loop
+ * @return {uint64_t} The pixels that were already set
+ */
+static CHIP8_SPECIALISE uint64_t xmachine_blit(const struct chip8_xmachine *x, uint64_t (*plane)[CHIP8_XROW_WORDS],
+                                               uint16_t addr, int px, int py, int height, uint64_t spill,
+                                               const int wide, const int lores) {
+    int w = px >> 6, s = px & 63;
+    uint64_t hit = 0;
+
+    for (int yy = 0; yy < height; yy++) {
+        uint16_t at = addr + (yy >> lores) * (wide + 1);
+        uint64_t bits = xmachine_sprite_row(wide ? xmachine_word(x, at) : x->memory[at], wide, lores);
+        uint64_t head = bits >> s;
+        uint64_t tail = (bits << 1 << (63 - s)) & spill;
+        uint64_t *row = plane[(py + yy) & (XVIDEO_HEIGHT - 1)];
+
+        hit |= (row[w] & head) | (row[w ^ 1] & tail);
+        row[w] ^= head;
+        row[w ^ 1] ^= tail;
+    }
+
+    return hit;
+}
+
+/**
+ * Draws a sprite on every selected plane, DXYN with 16x16 sprites for N = 0.
+ * Each sprite row is shifted into the word holding its left edge, the rest
+ * spilling into the other word of the row: the right word, or past the right
+ * edge the left one when the sprite wraps around.
+ * @return {int} The outcome of the execution
+ */
+static inline int xmachine_draw(struct chip8_xmachine *x, uint16_t opcode, const unsigned quirks) {
+    int wide = OP_N(opcode) == 0;
+    int rows = wide ? 16 : OP_N(opcode);
+    int lores = !x->hires;
+    int px = (x->v[OP_X(opcode)] & ((XVIDEO_WIDTH - 1) >> lores)) << lores;
+    int py = (x->v[OP_Y(opcode)] & ((XVIDEO_HEIGHT - 1) >> lores)) << lores;
+    int height = rows << lores;
+    uint16_t addr = x->i;
+    uint64_t hit = 0;
+
+    // the spill is lost when clipping past the right edge
+    uint64_t spill = px < 64 || !(quirks & CHIP8_QUIRK_CLIP) ? UINT64_MAX : 0;
+
+    if ((quirks & CHIP8_QUIRK_CLIP) && height > XVIDEO_HEIGHT - py) {
+        height = XVIDEO_HEIGHT - py;
+    }
+
+    // the sprite data of each selected plane follows that of the one before
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        if (!(x->planes & (1 << p))) {
+            continue;
+        }
+
+        switch (wide << 1 | lores) {
+            case 0: hit |= xmachine_blit(x, x->display[p], addr, px, py, height, spill, 0, 0); break;
+            case 1: hit |= xmachine_blit(x, x->display[p], addr, px, py, height, spill, 0, 1); break;
+            case 2: hit |= xmachine_blit(x, x->display[p], addr, px, py, height, spill, 1, 0); break;
+            case 3: hit |= xmachine_blit(x, x->display[p], addr, px, py, height, spill, 1, 1); break;
+        }
+
+        addr += rows * (wide + 1);
+    }
+
+    // a whole sprite covers at most 32 rows, so a rotated mask marks them all
+    uint64_t touched = (1ULL << height) - 1;
+    x->dirty_rows |= touched << py | touched >> ((XVIDEO_HEIGHT - py) & (XVIDEO_HEIGHT - 1));
+
+    x->v[0xF] = hit != 0;
+    x->draw_flag = 1;
+    x->pc += 2;
+    return 0;
+}
+
+/**
+ * Scrolls the selected planes down (positive) or up (negative) by whole rows
+ * @param {int} n The rows of the 128x64 display to scroll by
+ */
+static void xmachine_scroll_vertical(struct chip8_xmachine *x, int n) {
+    size_t row = sizeof(x->display[0][0]);
+    int count = n < 0 ? -n : n;
+
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        if (!(x->planes & (1 << p))) {
+            continue;
+        }
+
+        uint64_t (*d)[CHIP8_XROW_WORDS] = x->display[p];
+
+        if (n > 0) {
+            memmove(d[count], d[0], (XVIDEO_HEIGHT - count) * row);
+            memset(d[0], 0, count * row);
+        } else {
+            memmove(d[0], d[count], (XVIDEO_HEIGHT - count) * row);
+            memset(d[XVIDEO_HEIGHT - count], 0, count * row);
+        }
+    }
+
+    x->dirty_rows = UINT64_MAX;
+    x->draw_flag = 1;
+}
+
+/**
+ * Scrolls the selected planes right (positive) or left (negative), shifting
+ * each row across its pair of words
+ * @param {int} n The columns of the 128x64 display to scroll by (1 - 63)
+ */
+static void xmachine_scroll_horizontal(struct chip8_xmachine *x, int n) {
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        if (!(x->planes & (1 << p))) {
+            continue;
+        }
+
+        for (int y = 0; y < XVIDEO_HEIGHT; y++) {
+            uint64_t *r = x->display[p][y];
+
+            if (n > 0) {
+                r[1] = r[1] >> n | r[0] << (64 - n);
+                r[0] >>= n;
+            } else {
+                r[0] = r[0] << -n | r[1] >> (64 + n);
+                r[1] <<= -n;
+            }
+        }
+    }
+
+    x->dirty_rows = UINT64_MAX;
+    x->draw_flag = 1;
+}
+
+/**
+ * Clears the given planes of the display
+ * @param {uint8_t} planes The planes to clear, one bit each
+ */
+static void xmachine_clear(struct chip8_xmachine *x, uint8_t planes) {
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        if (planes & (1 << p)) {
+            memset(x->display[p], 0, sizeof(x->display[p]));
+        }
+    }
+
+    x->dirty_rows = UINT64_MAX;
+    x->draw_flag = 1;
+}
+
+/**
+ * Executes the given opcode under one quirk profile; quirks is always a
+ * constant, so the quirk tests fold away in each copy
+ * @param {struct chip8_xmachine*} x The machine to execute the opcode on
+ * @param {uint16_t} opcode The opcode to execute
+ * @param {unsigned} quirks The CHIP8_QUIRK_ flags of the profile
+ * @return {int} The outcome of the execution
+ */
+static CHIP8_SPECIALISE int xmachine_execute(struct chip8_xmachine *x, uint16_t opcode, const unsigned quirks) {
+    // isolate the nibbles
+    uint8_t n    = OP_N(opcode);
+    uint8_t vx   = OP_X(opcode);
+    uint8_t vy   = OP_Y(opcode);
+    uint8_t nn   = OP_NN(opcode);
+    uint16_t nnn = OP_NNN(opcode);
+    int scale    = x->hires ? 1 : 2;
+
+    switch (opcode >> 12) {
+        case 0x0:
+            if (vx != 0) {
+                // call RCA 1802 program at address nnn; not implemented
+                return -2;
+            }
+
+            if ((nn & 0xF0) == 0xC0) { // scroll down n rows (scd n)
+                xmachine_scroll_vertical(x, n * scale);
+            } else if ((nn & 0xF0) == 0xD0) { // scroll up n rows (scu n)
+                xmachine_scroll_vertical(x, -n * scale);
+            } else if (nn == 0xE0) { // clear the selected planes (cls)
+                xmachine_clear(x, x->planes);
+            } else if (nn == 0xEE) { // return from subroutine (ret)
+                x->pc = x->stack[x->sp & 0xF];
+                x->sp--;
+            } else if (nn == 0xFB) { // scroll right 4 columns (scr)
+                xmachine_scroll_horizontal(x, 4 * scale);
+            } else if (nn == 0xFC) { // scroll left 4 columns (scl)
+                xmachine_scroll_horizontal(x, -4 * scale);
+            } else if (nn == 0xFD) { // exit the interpreter (exit)
+                return CHIP8_RUN_EXIT;
+            } else if (nn == 0xFE || nn == 0xFF) { // low (low) or high (high) resolution
+                x->hires = nn == 0xFF;
+                xmachine_clear(x, 0x3);
+            } else {
+                return -2;
+            }
+
+            x->pc += 2;
+            break;
+
+        case 0x1: // jump to address nnn (jp N)
+            x->pc = nnn;
+            break;
+
+        case 0x2: // call subroutine at address nnn (call N)
+            // the stack wraps around rather than running off the machine
+            x->sp++;
+            x->stack[x->sp & 0xF] = x->pc;
+            x->pc = nnn;
+            break;
+
+        case 0x3: // skip next instruction if Vx == nn (se Vx, byte)
+            xmachine_skip(x, x->v[vx] == nn);
+            break;
+
+        case 0x4: // skip next instruction if Vx != nn (sne Vx, byte)
+            xmachine_skip(x, x->v[vx] != nn);
+            break;
+
+        case 0x5:
+            if (n == 0x2 || n == 0x3) {
+                // store (save Vx - Vy) or load (load Vx - Vy) a range of registers at I, in either order
+                int step = vx <= vy ? 1 : -1;
+                int count = (vx <= vy ? vy - vx : vx - vy) + 1;
+
+                for (int k = 0; k < count; k++) {
+                    uint8_t *mem = &x->memory[(uint16_t)(x->i + k)];
+                    uint8_t *reg = &x->v[vx + k * step];
+
+                    if (n == 0x2) {
+                        *mem = *reg;
+                    } else {
+                        *reg = *mem;
+                    }
+                }
+
+                x->pc += 2;
+            } else { // skip next instruction if Vx == Vy (se Vx, Vy)
+                xmachine_skip(x, x->v[vx] == x->v[vy]);
+            }
+            break;
+
+        case 0x6: // set Vx = nn (ld Vx, byte)
+            x->v[vx] = nn;
+            x->pc += 2;
+            break;
+
+        case 0x7: // set Vx = Vx + nn (add Vx, byte)
+            x->v[vx] += nn;
+            x->pc += 2;
+            break;
+
+        case 0x8:
+            switch (n) {
+                case 0x0: // set Vx = Vy (ld Vx, Vy)
+                    x->v[vx] = x->v[vy];
+                    break;
+
+                case 0x1: // set Vx = Vx | Vy (or Vx, Vy)
+                    x->v[vx] |= x->v[vy];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        x->v[0xF] = 0;
+                    }
+                    break;
+
+                case 0x2: // set Vx = Vx & Vy (and Vx, Vy)
+                    x->v[vx] &= x->v[vy];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        x->v[0xF] = 0;
+                    }
+                    break;
+
+                case 0x3: // set Vx = Vx ^ Vy (xor Vx, Vy)
+                    x->v[vx] ^= x->v[vy];
+                    if (quirks & CHIP8_QUIRK_VF_RESET) {
+                        x->v[0xF] = 0;
+                    }
+                    break;
+
+                case 0x4: { // set Vx = Vx + Vy, set VF = carry (add Vx, Vy)
+                    uint8_t carry = x->v[vx] + x->v[vy] > 0xFF;
+                    x->v[0xF] = carry;
+                    x->v[vx] += x->v[vy];
+                    break;
+                }
+
+                case 0x5: { // set Vx = Vx - Vy, set VF = NOT borrow (sub Vx, Vy)
+                    uint8_t not_borrow = x->v[vx] > x->v[vy];
+                    x->v[0xF] = not_borrow;
+                    x->v[vx] -= x->v[vy];
+                    break;
+                }
+
+                case 0x6: // set Vx = Vx >> 1 (shr Vx {, Vy})
+                    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+                        uint8_t src = x->v[vy];
+                        x->v[vx] = src >> 1;
+                        x->v[0xF] = src & 0x1;
+                    } else {
+                        x->v[0xF] = x->v[vx] & 0x1;
+                        x->v[vx] >>= 1;
+                    }
+                    break;
+
+                case 0x7: { // set Vx = Vy - Vx, set VF = NOT borrow (subn Vx, Vy)
+                    uint8_t not_borrow = x->v[vy] > x->v[vx];
+                    x->v[0xF] = not_borrow;
+                    x->v[vx] = x->v[vy] - x->v[vx];
+                    break;
+                }
+
+                case 0xE: // set Vx = Vx << 1 (shl Vx {, Vy})
+                    if (quirks & CHIP8_QUIRK_SHIFT_VY) {
+                        uint8_t src = x->v[vy];
+                        x->v[vx] = src << 1;
+                        x->v[0xF] = src >> 7;
+                    } else {
+                        x->v[0xF] = x->v[vx] >> 7;
+                        x->v[vx] <<= 1;
+                    }
+                    break;
+
+                default:
+                    // unknown opcode
+                    return -1;
+            }
+
+            x->pc += 2;
+            break;
+
+        case 0x9: // skip next instruction if Vx != Vy (sne Vx, Vy)
+            xmachine_skip(x, x->v[vx] != x->v[vy]);
+            break;
+
+        case 0xA: // set I = nnn (ld I, addr)
+            x->i = nnn;
+            x->pc += 2;
+            break;
+
+        case 0xB: // jump to address nnn + V0 (jp V0, addr), or to xnn + Vx
+            x->pc = nnn + x->v[quirks & CHIP8_QUIRK_JUMP_VX ? vx : 0];
+            break;
+
+        case 0xC: // set Vx = random byte AND nn (rnd Vx, byte)
+            x->v[vx] = (xmachine_random(x) % 0xFF) & nn;
+            x->pc += 2;
+            break;
+
+        case 0xD: // draw a sprite at (Vx, Vy) on the selected planes, set VF = collision (drw Vx, Vy, nibble)
+            return xmachine_draw(x, opcode, quirks);
+
+        case 0xE:
+            switch (nn) {
+                case 0x9E: // skip next instruction if key with the value of Vx is pressed (skp Vx)
+                    xmachine_skip(x, x->key[x->v[vx] & 0xF] == 1);
+                    break;
+
+                case 0xA1: // skip next instruction if key with the value of Vx is not pressed (sknp Vx)
+                    xmachine_skip(x, x->key[x->v[vx] & 0xF] == 0);
+                    break;
+
+                default:
+                    // unknown opcode
+                    return -1;
+            }
+            break;
+
+        case 0xF:
+            switch (nn) {
+                case 0x00: // set I = the 16-bit address that follows (ld I, long addr)
+                    if (vx != 0) {
+                        return -1;
+                    }
+                    x->i = xmachine_word(x, x->pc + 2);
+                    x->pc += 4;
+                    return 0;
+
+                case 0x01: // select the planes drawn, cleared and scrolled (plane n)
+                    x->planes = vx & 0x3;
+                    break;
+
+                case 0x02: // load the 16-byte audio pattern at I (audio)
+                    if (vx != 0) {
+                        return -1;
+                    }
+                    for (int k = 0; k < 16; k++) {
+                        x->pattern[k] = x->memory[(uint16_t)(x->i + k)];
+                    }
+                    break;
+
+                case 0x07: // set Vx = delay timer value (ld Vx, DT)
+                    x->v[vx] = x->delay_timer;
+                    break;
+
+                case 0x0A: // wait for a key press, store the value of the key in Vx (ld Vx, K)
+                    for (int k = 0; k < 16; k++) {
+                        if (x->key[k] == 1) {
+                            x->v[vx] = k;
+                            x->pc += 2;
+                            break;
+                        }
+                    }
+                    return 0;
+
+                case 0x15: // set delay timer = Vx (ld DT, Vx)
+                    x->delay_timer = x->v[vx];
+                    break;
+
+                case 0x18: // set sound timer = Vx (ld ST, Vx)
+                    x->sound_timer = x->v[vx];
+                    x->beep_flag = 1;
+                    break;
+
+                case 0x1E: // set I = I + Vx (add I, Vx)
+                    x->i += x->v[vx];
+                    break;
+
+                case 0x29: // set I = location of small sprite for digit Vx (ld F, Vx)
+                    x->i = x->v[vx] * 5;
+                    break;
+
+                case 0x30: // set I = location of large sprite for digit Vx (ld HF, Vx)
+                    x->i = CHIP8_XBIG_FONT + (x->v[vx] & 0xF) * 10;
+                    break;
+
+                case 0x33: // store BCD representation of Vx at I, I+1 and I+2 (ld B, Vx)
+                    x->memory[x->i] = x->v[vx] / 100;
+                    x->memory[(uint16_t)(x->i + 1)] = (x->v[vx] / 10) % 10;
+                    x->memory[(uint16_t)(x->i + 2)] = x->v[vx] % 10;
+                    break;
+
+                case 0x3A: // set the audio pitch = Vx (pitch Vx)
+                    x->pitch = x->v[vx];
+                    break;
+
+                case 0x55: // store registers V0 through Vx in memory starting at location I (ld [I], Vx)
+                    for (int k = 0; k <= vx; k++) {
+                        x->memory[(uint16_t)(x->i + k)] = x->v[k];
+                    }
+                    x->i += chip8_quirk_load_i(opcode, quirks);
+                    break;
+
+                case 0x65: // read registers V0 through Vx from memory starting at location I (ld Vx, [I])
+                    for (int k = 0; k <= vx; k++) {
+                        x->v[k] = x->memory[(uint16_t)(x->i + k)];
+                    }
+                    x->i += chip8_quirk_load_i(opcode, quirks);
+                    break;
+
+                case 0x75: // store V0 through Vx in the flag registers (ld R, Vx)
+                    memcpy(x->flags, x->v, vx + 1);
+                    break;
+
+                case 0x85: // read V0 through Vx from the flag registers (ld Vx, R)
+                    memcpy(x->v, x->flags, vx + 1);
+                    break;
+
+                default:
+                    // unknown opcode
+                    return -1;
+            }
+
+            x->pc += 2;
+            break;
+    }
+
+    return 0;
+}
+
+/**
+ * Runs up to count cycles under one quirk profile
+ * @return {int} The outcome of the execution
+ */
+static CHIP8_SPECIALISE int xmachine_run(struct chip8_xmachine *x, uint64_t count, const unsigned quirks) {
+    for (uint64_t c = 0; c < count; c++) {
+        uint16_t opcode = xmachine_word(x, x->pc);
+        int self_jump = (opcode & 0xF000) == 0x1000 && (opcode & 0x0FFF) == x->pc;
+
+        xmachine_cycle(x);
+
+        int rc = xmachine_execute(x, opcode, quirks);
+
+        if (rc != 0) {
+            return rc;
+        }
+
+        if (self_jump) {
+            return CHIP8_RUN_LOOP;
+        }
+    }
+
+    return 0;
+}
+
+int chip8_xstep(struct chip8_xmachine *x) {
+    uint16_t opcode = xmachine_word(x, x->pc);
+
+    xmachine_cycle(x);
+
+#define CHIP8_XEXECUTE_CASE(id, name, flags) case id: return xmachine_execute(x, opcode, flags);
+    switch (x->quirks) {
+        CHIP8_PROFILES(CHIP8_XEXECUTE_CASE)
+        default:
+            return -1;
+    }
+#undef CHIP8_XEXECUTE_CASE
+}
+
+int chip8_xrun(struct chip8_xmachine *x, uint64_t count) {
+#define CHIP8_XRUN_CASE(id, name, flags) case id: return xmachine_run(x, count, flags);
+    switch (x->quirks) {
+        CHIP8_PROFILES(CHIP8_XRUN_CASE)
+        default:
+            return -1;
+    }
+#undef CHIP8_XRUN_CASE
+}
+
+int chip8_xdisplay_pixel(const struct chip8_xmachine *x, int px, int py) {
+    int colour = 0;
+
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        colour |= (int)((x->display[p][py][px >> 6] >> (63 - (px & 63))) & 1) << p;
+    }
+
+    return colour;
+}
+
+uint64_t chip8_xdisplay_hash(const struct chip8_xmachine *x) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    // hash the rows left to right so the result does not depend on byte order
+    for (int p = 0; p < CHIP8_XPLANES; p++) {
+        for (int y = 0; y < XVIDEO_HEIGHT; y++) {
+            for (int w = 0; w < CHIP8_XROW_WORDS; w++) {
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    hash ^= (x->display[p][y][w] >> shift) & 0xFF;
+                    hash *= 0x100000001B3ULL;
+                }
+            }
+        }
+    }
+
+    return hash;
+}
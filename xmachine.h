@@ -0,0 +1,147 @@
+#ifndef __chip8_xmachine_h_
+
+#define __chip8_xmachine_h_
+
+#include "machine.h"
+
+/*
+ * Extended machine for SUPER-CHIP and XO-CHIP programs: a 128x64 display of
+ * two bitplanes, 16x16 sprites, scrolling and a 64 KB address space.
+ *
+ * Each display row of a plane is packed into two 64-bit words, x = 0 in the
+ * top bit of the first. Sprites are shifted into place and XORed onto a row a
+ * word at a time, and scrolls move whole words, so drawing in high resolution
+ * costs about what it does on the base machine. In low resolution every pixel
+ * is drawn as a 2x2 block of the same display.
+ */
+
+#define XVIDEO_WIDTH        128
+#define XVIDEO_HEIGHT       64
+#define CHIP8_XPLANES       2
+#define CHIP8_XROW_WORDS    (XVIDEO_WIDTH / 64)
+
+_Static_assert(XVIDEO_HEIGHT == 64, "dirty display rows are tracked in a uint64_t");
+
+/* XO-CHIP addresses 64 KB; programs load at 0x200 and may fill the rest */
+#define CHIP8_XMEMORY       0x10000
+#define CHIP8_XPROGRAM_MAX  (CHIP8_XMEMORY - CHIP8_PROGRAM_START)
+
+/* the large SUPER-CHIP font follows the small one in memory */
+#define CHIP8_XBIG_FONT     0x50
+
+/* returned by the run loop when the program exits with 00FD */
+#define CHIP8_RUN_EXIT      2
+
+/**
+ * Extended chip8 machine structure
+ */
+struct chip8_xmachine {
+    uint8_t memory[CHIP8_XMEMORY];   /* 64k block of memory */
+    uint8_t v[16];                   /* 16 general registers */
+    uint16_t i;                      /* index register */
+    uint16_t pc;                     /* program counter */
+    uint16_t stack[16];              /* machine stack */
+    uint16_t sp;                     /* stack pointer */
+    uint8_t delay_timer;             /* delay counter */
+    uint8_t sound_timer;             /* sound beep timer */
+    uint16_t ipf;                    /* instructions per 60 Hz timer tick */
+    uint16_t tick_left;              /* instructions left until the next timer tick */
+    uint8_t quirks;                  /* quirk profile, enum chip8_quirks */
+    uint8_t hires;                   /* 128x64 mode (00FF); low resolution (00FE) doubles every pixel */
+    uint8_t planes;                  /* bitplanes drawn, cleared and scrolled (FN01), one bit each */
+    uint8_t key[16];                 /* key states */
+    uint8_t flags[16];               /* persistent flag registers of FX75/FX85 */
+    uint8_t pattern[16];             /* XO-CHIP audio pattern (F002) */
+    uint8_t pitch;                   /* XO-CHIP audio pitch (FX3A) */
+
+    /* display memory; one row per pair of words, x = 0 in the top bit of the first */
+    uint64_t display[CHIP8_XPLANES][XVIDEO_HEIGHT][CHIP8_XROW_WORDS];
+
+    uint8_t draw_flag;               /* determines if the screen needs to be redrawn */
+    uint64_t dirty_rows;             /* display rows changed since the frontend last drew, one bit each */
+    uint8_t beep_flag;               /* determines if the beep needs to be played */
+
+    uint64_t cycles;                 /* number of execution cycles performed */
+    uint32_t rng;                    /* random number generator state */
+};
+
+/**
+ * Creates a new extended machine
+ * @param {enum chip8_quirks} q The quirk profile the machine executes under
+ * @return {struct chip8_xmachine*} The newly created machine
+ */
+struct chip8_xmachine* chip8_xmachine_create(enum chip8_quirks q);
+
+/**
+ * Initialises an extended machine in place to the state a new machine starts
+ * in: low resolution, the first plane selected, the fonts loaded
+ * @param {struct chip8_xmachine*} x The machine to initialise
+ * @param {enum chip8_quirks} q The quirk profile the machine executes under
+ */
+void chip8_xmachine_init(struct chip8_xmachine *x, enum chip8_quirks q);
+
+/**
+ * Destroys the given extended machine
+ * @param {struct chip8_xmachine**} p The machine to destroy
+ * @return {int} The outcome of the execution
+ */
+int chip8_xmachine_destroy(struct chip8_xmachine **p);
+
+/**
+ * Seeds the random number generator of the given machine
+ * @param {struct chip8_xmachine*} x The machine to seed
+ * @param {uint32_t} seed The seed; equal seeds give equal random sequences
+ */
+void chip8_xseed(struct chip8_xmachine *x, uint32_t seed);
+
+/**
+ * Loads a program into the extended machine
+ * @param {struct chip8_xmachine*} x The machine to load the program into
+ * @param {const char *} path The path to the program to load
+ * @return {int} The outcome of the execution
+ */
+int chip8_xload(struct chip8_xmachine *x, const char *path);
+
+/**
+ * Loads a program held in memory into the extended machine
+ * @param {struct chip8_xmachine*} x The machine to load the program into
+ * @param {const uint8_t *} data The program image
+ * @param {size_t} size The size of the program image
+ * @return {int} The outcome of the execution
+ */
+int chip8_xload_memory(struct chip8_xmachine *x, const uint8_t *data, size_t size);
+
+/**
+ * Performs one execution cycle on the extended machine
+ * @param {struct chip8_xmachine*} x The machine to progress step execution
+ * @return {int} The outcome of the execution; CHIP8_RUN_EXIT once the program exited
+ */
+int chip8_xstep(struct chip8_xmachine *x);
+
+/**
+ * Runs up to count cycles, specialised for the machine's quirk profile. Stops
+ * after a failing opcode, a jump onto itself (CHIP8_RUN_LOOP) or 00FD
+ * (CHIP8_RUN_EXIT), as chip8_run_switch() does.
+ * @param {struct chip8_xmachine*} x The machine to run
+ * @param {uint64_t} count The maximum number of cycles to run
+ * @return {int} The outcome of the execution
+ */
+int chip8_xrun(struct chip8_xmachine *x, uint64_t count);
+
+/**
+ * Reads a single pixel of the display
+ * @param {const struct chip8_xmachine*} x The machine to read the display of
+ * @param {int} px The column of the pixel (0 - 127)
+ * @param {int} py The row of the pixel (0 - 63)
+ * @return {int} The colour of the pixel; bit n is set in plane n
+ */
+int chip8_xdisplay_pixel(const struct chip8_xmachine *x, int px, int py);
+
+/**
+ * Computes a hash of the current display contents, every plane included
+ * @param {const struct chip8_xmachine*} x The machine to hash the display of
+ * @return {uint64_t} The FNV-1a hash of the display memory
+ */
+uint64_t chip8_xdisplay_hash(const struct chip8_xmachine *x);
+
+#endif /* __chip8_xmachine_h_ */